@@ -57,6 +57,22 @@ class PowersOfTenCache {
   static void GetCachedPowerForDecimalExponent(int requested_exponent,
                                                DiyFp* power,
                                                int* found_exponent);
+
+  // Every power of ten in this range is also cached with a 128-bit
+  // significand.
+  static const int kMinPreciseDecimalExponent;
+  static const int kMaxPreciseDecimalExponent;
+
+  // Returns the 128 most significant bits of 10^decimal_exponent, rounded
+  // down, in *high and *low. The most significant bit of *high is set, so
+  //   10^decimal_exponent ~= (high * 2^64 + low) * 2^(e - 127)
+  // with e = floor(decimal_exponent * log2(10)).
+  // The given decimal_exponent must satisfy
+  //   kMinPreciseDecimalExponent <= decimal_exponent, and
+  //   decimal_exponent <= kMaxPreciseDecimalExponent.
+  static void GetPreciseCachedPowerForDecimalExponent(int decimal_exponent,
+                                                      uint64_t* high,
+                                                      uint64_t* low);
 };
 
 }  // namespace double_conversion
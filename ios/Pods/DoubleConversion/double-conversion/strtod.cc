@@ -381,6 +381,160 @@ static bool DiyFpStrtod(Vector<const char> buffer,
 }
 
 
+// Returns the 128 bit product of a and b in *high and *low.
+static void Multiply128(uint64_t a, uint64_t b,
+                        uint64_t* high, uint64_t* low) {
+#if defined(__SIZEOF_INT128__)
+  __extension__ typedef unsigned __int128 uint128_t;
+  uint128_t product = static_cast<uint128_t>(a) * b;
+  *high = static_cast<uint64_t>(product >> 64);
+  *low = static_cast<uint64_t>(product);
+#else
+  const uint64_t kM32 = 0xFFFFFFFFU;
+  uint64_t a_high = a >> 32;
+  uint64_t a_low = a & kM32;
+  uint64_t b_high = b >> 32;
+  uint64_t b_low = b & kM32;
+  uint64_t low_low = a_low * b_low;
+  uint64_t low_high = a_low * b_high;
+  uint64_t high_low = a_high * b_low;
+  uint64_t high_high = a_high * b_high;
+  uint64_t middle = (low_low >> 32) + (low_high & kM32) + (high_low & kM32);
+  *high = high_high + (low_high >> 32) + (high_low >> 32) + (middle >> 32);
+  *low = (middle << 32) | (low_low & kM32);
+#endif
+}
+
+
+static int CountLeadingZeros(uint64_t x) {
+  ASSERT(x != 0);
+#if defined(__GNUC__)
+  return __builtin_clzll(x);
+#else
+  const uint64_t kTopBit = UINT64_2PART_C(0x80000000, 00000000);
+  int count = 0;
+  while ((x & kTopBit) == 0) {
+    x <<= 1;
+    count++;
+  }
+  return count;
+#endif
+}
+
+
+// Computes significand*10^exponent with the Eisel-Lemire algorithm: the
+// normalized significand is multiplied with the 128 most significant bits of
+// 10^exponent, which is precise enough to round the product correctly unless
+// it lies very close to the half-way point between two doubles.
+// Returns false, without touching *result, in that case and if the result
+// would be a denormal or infinity. The caller then has to fall back to a
+// slower algorithm.
+static bool EiselLemireStrtod(uint64_t significand,
+                              int exponent,
+                              double* result) {
+  ASSERT(significand != 0);
+  if (exponent < PowersOfTenCache::kMinPreciseDecimalExponent ||
+      exponent > PowersOfTenCache::kMaxPreciseDecimalExponent) {
+    return false;
+  }
+  uint64_t power_high;
+  uint64_t power_low;
+  PowersOfTenCache::GetPreciseCachedPowerForDecimalExponent(exponent,
+                                                            &power_high,
+                                                            &power_low);
+  int leading_zeros = CountLeadingZeros(significand);
+  significand <<= leading_zeros;
+  // 217706 / 2^16 ~= log2(10), and (217706 * exponent) >> 16 equals
+  // floor(exponent * log2(10)) for all exponents in the table.
+  const int kExponentBias = 0x3FF;
+  int biased_exponent =
+      ((217706 * exponent) >> 16) + 64 + kExponentBias - leading_zeros;
+
+  uint64_t product_high;
+  uint64_t product_low;
+  Multiply128(significand, power_high, &product_high, &product_low);
+  // The power of ten was rounded down, so the exact product may be larger by
+  // up to significand*2^-64 (in units of product_low). That only matters if
+  // it could carry into the bits of product_high that are kept, in which
+  // case we take the low half of the power into account too.
+  const uint64_t kRoundingBitsMask = 0x1FF;
+  if ((product_high & kRoundingBitsMask) == kRoundingBitsMask &&
+      product_low + significand < product_low) {
+    uint64_t low_high;
+    uint64_t low_low;
+    Multiply128(significand, power_low, &low_high, &low_low);
+    uint64_t merged_high = product_high;
+    uint64_t merged_low = product_low + low_high;
+    if (merged_low < product_low) merged_high++;
+    if ((merged_high & kRoundingBitsMask) == kRoundingBitsMask &&
+        merged_low + 1 == 0 &&
+        low_low + significand < low_low) {
+      // Still too imprecise.
+      return false;
+    }
+    product_high = merged_high;
+    product_low = merged_low;
+  }
+
+  // Keep 54 bits, one more than the significand of a double, for rounding.
+  int top_bit = static_cast<int>(product_high >> 63);
+  uint64_t result_significand = product_high >> (top_bit + 9);
+  biased_exponent -= 1 ^ top_bit;
+
+  if (product_low == 0 && (product_high & kRoundingBitsMask) == 0 &&
+      (result_significand & 3) == 1) {
+    // The product may lie exactly half-way between two doubles, and the
+    // rounding below would not round it to even.
+    return false;
+  }
+
+  // Round to 53 bits.
+  result_significand += result_significand & 1;
+  result_significand >>= 1;
+  if ((result_significand >> Double::kSignificandSize) != 0) {
+    result_significand >>= 1;
+    biased_exponent++;
+  }
+  if (biased_exponent <= 0 || biased_exponent >= 0x7FF) {
+    // Denormal or infinity.
+    return false;
+  }
+  uint64_t d64 =
+      (static_cast<uint64_t>(biased_exponent) <<
+       Double::kPhysicalSignificandSize) |
+      (result_significand & Double::kSignificandMask);
+  *result = Double(d64).value();
+  return true;
+}
+
+
+// Reads the buffer into a uint64 and runs the Eisel-Lemire algorithm on it.
+// If the buffer has more digits than fit into a uint64 then the input lies
+// strictly between two values that do fit, and the result is only accepted
+// if both of them round to the same double.
+static bool EiselLemireStrtod(Vector<const char> trimmed,
+                              int exponent,
+                              double* result) {
+  int read_digits;
+  uint64_t significand = ReadUint64(trimmed, &read_digits);
+  exponent += trimmed.length() - read_digits;
+  if (read_digits == trimmed.length()) {
+    return EiselLemireStrtod(significand, exponent, result);
+  }
+  // The trimmed buffer does not end in '0', so the dropped digits are
+  // not all zero. ReadUint64 stops early enough for significand + 1 to fit.
+  double lower;
+  double upper;
+  if (EiselLemireStrtod(significand, exponent, &lower) &&
+      EiselLemireStrtod(significand + 1, exponent, &upper) &&
+      lower == upper) {
+    *result = lower;
+    return true;
+  }
+  return false;
+}
+
+
 // Returns
 //   - -1 if buffer*10^exponent < diy_fp.
 //   -  0 if buffer*10^exponent == diy_fp.
@@ -435,7 +589,11 @@ static bool ComputeGuess(Vector<const char> trimmed, int exponent,
     return true;
   }
 
+  // Eisel-Lemire is exact whenever it succeeds, and it fails rarely, even for
+  // inputs with more than 17 digits that DiyFpStrtod often cannot decide.
+  // DiyFpStrtod still provides the guess for the bignum comparison otherwise.
   if (DoubleStrtod(trimmed, exponent, guess) ||
+      EiselLemireStrtod(trimmed, exponent, guess) ||
       DiyFpStrtod(trimmed, exponent, guess)) {
     return true;
   }
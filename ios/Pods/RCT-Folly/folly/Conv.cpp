@@ -17,6 +17,10 @@
 #include <folly/Conv.h>
 
 #include <array>
+#include <cmath>
+#include <cstring>
+
+#include <fmt/format.h>
 
 namespace folly {
 namespace detail {
@@ -462,6 +466,83 @@ template Expected<float, ConversionCode> str_to_floating<float>(
 template Expected<double, ConversionCode> str_to_floating<double>(
     StringPiece* src) noexcept;
 
+namespace {
+
+// Lays out the decimal significand and exponent of a nonzero finite value
+// the way DoubleToStringConverter::ToShortest does with the flags, symbols
+// and kConvMaxDecimalInShortest* bounds used by toAppend.
+template <typename T>
+size_t toShortestImpl(T value, char* buffer) {
+  char* out = buffer;
+  if (std::isnan(value)) {
+    std::memcpy(out, "NaN", 3);
+    return 3;
+  }
+  if (std::signbit(value)) {
+    *out++ = '-';
+    value = -value;
+  }
+  if (std::isinf(value)) {
+    std::memcpy(out, "Infinity", 8);
+    return size_t(out + 8 - buffer);
+  }
+  if (value == 0) {
+    *out++ = '0';
+    return size_t(out - buffer);
+  }
+
+  auto decimal = fmt::internal::dragonbox::to_decimal(value);
+  char digits[20];
+  const int length = int(to_ascii_decimal(digits, decimal.significand));
+  const int decimalPoint = length + decimal.exponent;
+  const int exponent = decimalPoint - 1;
+  if (kConvMaxDecimalInShortestLow <= exponent &&
+      exponent < kConvMaxDecimalInShortestHigh) {
+    if (decimalPoint <= 0) {
+      *out++ = '0';
+      *out++ = '.';
+      std::memset(out, '0', size_t(-decimalPoint));
+      out += -decimalPoint;
+      std::memcpy(out, digits, size_t(length));
+      out += length;
+    } else if (decimalPoint >= length) {
+      std::memcpy(out, digits, size_t(length));
+      out += length;
+      std::memset(out, '0', size_t(decimalPoint - length));
+      out += decimalPoint - length;
+    } else {
+      std::memcpy(out, digits, size_t(decimalPoint));
+      out += decimalPoint;
+      *out++ = '.';
+      std::memcpy(out, digits + decimalPoint, size_t(length - decimalPoint));
+      out += length - decimalPoint;
+    }
+  } else {
+    *out++ = digits[0];
+    if (length != 1) {
+      *out++ = '.';
+      std::memcpy(out, digits + 1, size_t(length - 1));
+      out += length - 1;
+    }
+    *out++ = 'E';
+    if (exponent < 0) {
+      *out++ = '-';
+    }
+    out += to_ascii_decimal(out, out + 3, uint64_t(std::abs(exponent)));
+  }
+  return size_t(out - buffer);
+}
+
+} // namespace
+
+size_t toShortest(double value, char* buffer) {
+  return toShortestImpl(value, buffer);
+}
+
+size_t toShortestSingle(float value, char* buffer) {
+  return toShortestImpl(value, buffer);
+}
+
 /**
  * This class takes care of additional processing needed for signed values,
  * like leading sign character and overflow checks.
@@ -618,6 +618,18 @@ estimateSpaceNeeded(Src value) {
 namespace detail {
 constexpr int kConvMaxDecimalInShortestLow = -6;
 constexpr int kConvMaxDecimalInShortestHigh = 21;
+
+// Enough for any output of toShortest, e.g. -0.0000012345678901234567.
+constexpr size_t kConvMaxShortestLength = 32;
+
+/**
+ * Writes the shortest representation of value that reads back as value,
+ * exactly as DoubleToStringConverter::ToShortest (ToShortestSingle) with
+ * the options of toAppend below would, and returns its length. The digits
+ * come from fmt's Dragonbox implementation, which needs no bignum fallback.
+ */
+size_t toShortest(double value, char* buffer);
+size_t toShortestSingle(float value, char* buffer);
 } // namespace detail
 
 /** Wrapper around DoubleToStringConverter **/
@@ -630,6 +642,16 @@ toAppend(
     double_conversion::DoubleToStringConverter::DtoaMode mode,
     unsigned int numDigits) {
   using namespace double_conversion;
+  if (mode == DoubleToStringConverter::SHORTEST) {
+    char buffer[detail::kConvMaxShortestLength];
+    result->append(buffer, detail::toShortest(double(value), buffer));
+    return;
+  }
+  if (mode == DoubleToStringConverter::SHORTEST_SINGLE) {
+    char buffer[detail::kConvMaxShortestLength];
+    result->append(buffer, detail::toShortestSingle(float(value), buffer));
+    return;
+  }
   DoubleToStringConverter conv(
       DoubleToStringConverter::NO_FLAGS,
       "Infinity",
@@ -640,14 +662,8 @@ toAppend(
       6, // max leading padding zeros
       1); // max trailing padding zeros
   char buffer[256];
-  StringBuilder builder(buffer, sizeof(buffer));
+  double_conversion::StringBuilder builder(buffer, sizeof(buffer));
   switch (mode) {
-    case DoubleToStringConverter::SHORTEST:
-      conv.ToShortest(value, &builder);
-      break;
-    case DoubleToStringConverter::SHORTEST_SINGLE:
-      conv.ToShortestSingle(static_cast<float>(value), &builder);
-      break;
     case DoubleToStringConverter::FIXED:
       conv.ToFixed(value, int(numDigits), &builder);
       break;
@@ -65,8 +65,41 @@ namespace folly {
 #define FBSTRING_DISABLE_SSO false
 #endif
 
+// Define FOLLY_FBSTRING_ALLOC_STATS to 1 to have fbstring count, per thread,
+// the heap buffers it allocates and the ones it grows through smartRealloc.
+// Taking fbstringAllocStats() before and after building a string gives the
+// number of (re)allocations that string cost. Off by default, since the
+// counters sit on every allocating path.
+#ifndef FOLLY_FBSTRING_ALLOC_STATS
+#define FOLLY_FBSTRING_ALLOC_STATS 0
+#endif
+
+struct FBStringAllocStats {
+  size_t allocations = 0;
+  size_t reallocations = 0;
+};
+
 namespace fbstring_detail {
 
+#if FOLLY_FBSTRING_ALLOC_STATS
+inline FBStringAllocStats& allocStats() {
+  static thread_local FBStringAllocStats stats;
+  return stats;
+}
+#endif
+
+inline void noteAllocation() {
+#if FOLLY_FBSTRING_ALLOC_STATS
+  ++allocStats().allocations;
+#endif
+}
+
+inline void noteReallocation() {
+#if FOLLY_FBSTRING_ALLOC_STATS
+  ++allocStats().reallocations;
+#endif
+}
+
 template <class InIt, class OutIt>
 inline std::pair<InIt, OutIt> copy_n(
     InIt b, typename std::iterator_traits<InIt>::difference_type n, OutIt d) {
@@ -130,6 +163,18 @@ inline void podMove(const Pod* b, const Pod* e, Pod* d) {
 }
 } // namespace fbstring_detail
 
+/**
+ * Returns the calling thread's fbstring allocation counters. Always zero
+ * unless FOLLY_FBSTRING_ALLOC_STATS is enabled.
+ */
+inline FBStringAllocStats fbstringAllocStats() {
+#if FOLLY_FBSTRING_ALLOC_STATS
+  return fbstring_detail::allocStats();
+#else
+  return {};
+#endif
+}
+
 /**
  * Defines a special acquisition method for constructing fbstring
  * objects. AcquireMallocatedString means that the user passes a
@@ -485,6 +530,7 @@ class fbstring_core {
       const size_t allocSize =
           goodMallocSize(getDataOffset() + (*size + 1) * sizeof(Char));
       auto result = static_cast<RefCounted*>(checkedMalloc(allocSize));
+      fbstring_detail::noteAllocation();
       result->refCount_.store(1, std::memory_order_release);
       *size = (allocSize - getDataOffset()) / sizeof(Char) - 1;
       return result;
@@ -514,6 +560,7 @@ class fbstring_core {
           getDataOffset() + (currentSize + 1) * sizeof(Char),
           getDataOffset() + (currentCapacity + 1) * sizeof(Char),
           allocNewCapacity));
+      fbstring_detail::noteReallocation();
       assert(result->refCount_.load(std::memory_order_acquire) == 1);
       *newCapacity = (allocNewCapacity - getDataOffset()) / sizeof(Char) - 1;
       return result;
@@ -632,6 +679,7 @@ FOLLY_NOINLINE inline void fbstring_core<Char>::copyMedium(
   // one extra Char for the null terminator.
   auto const allocSize = goodMallocSize((1 + rhs.ml_.size_) * sizeof(Char));
   ml_.data_ = static_cast<Char*>(checkedMalloc(allocSize));
+  fbstring_detail::noteAllocation();
   // Also copies terminator.
   fbstring_detail::podCopy(
       rhs.ml_.data_, rhs.ml_.data_ + rhs.ml_.size_ + 1, ml_.data_);
@@ -703,6 +751,7 @@ FOLLY_NOINLINE inline void fbstring_core<Char>::initMedium(
   // allocate one extra Char for the terminating null.
   auto const allocSize = goodMallocSize((1 + size) * sizeof(Char));
   ml_.data_ = static_cast<Char*>(checkedMalloc(allocSize));
+  fbstring_detail::noteAllocation();
   if (FOLLY_LIKELY(size > 0)) {
     fbstring_detail::podCopy(data, data + size, ml_.data_);
   }
@@ -790,6 +839,7 @@ FOLLY_NOINLINE inline void fbstring_core<Char>::reserveMedium(
         (ml_.size_ + 1) * sizeof(Char),
         (ml_.capacity() + 1) * sizeof(Char),
         capacityBytes));
+    fbstring_detail::noteReallocation();
     ml_.setCapacity(capacityBytes / sizeof(Char) - 1, Category::isMedium);
   } else {
     // Conversion from medium to large string
@@ -818,6 +868,7 @@ FOLLY_NOINLINE inline void fbstring_core<Char>::reserveSmall(
     auto const allocSizeBytes =
         goodMallocSize((1 + minCapacity) * sizeof(Char));
     auto const pData = static_cast<Char*>(checkedMalloc(allocSizeBytes));
+    fbstring_detail::noteAllocation();
     auto const size = smallSize();
     // Also copies terminator.
     fbstring_detail::podCopy(small_, small_ + size + 1, pData);
@@ -0,0 +1,30 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/detail/StreamVByteDetail.h>
+
+namespace folly {
+namespace detail {
+
+// Both tables are built at compile time; see StreamVByteTables.
+constexpr StreamVByteTables<uint32_t> kStreamVByteTables32{};
+constexpr StreamVByteTables<uint64_t> kStreamVByteTables64{};
+
+const StreamVByteTables<uint32_t> streamVByteTables32 = kStreamVByteTables32;
+const StreamVByteTables<uint64_t> streamVByteTables64 = kStreamVByteTables64;
+
+} // namespace detail
+} // namespace folly
@@ -0,0 +1,496 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include <glog/logging.h>
+
+#include <folly/Portability.h>
+#include <folly/Range.h>
+#include <folly/detail/StreamVByteDetail.h>
+#include <folly/lang/Bits.h>
+#include <folly/portability/Builtins.h>
+
+#if FOLLY_SSE >= 2
+#include <emmintrin.h>
+#endif
+
+#if FOLLY_SSSE >= 3
+#include <immintrin.h>
+#define FOLLY_STREAM_VBYTE_SIMD 1
+#elif FOLLY_NEON && FOLLY_AARCH64
+#include <arm_neon.h>
+#define FOLLY_STREAM_VBYTE_SIMD 1
+#else
+#define FOLLY_STREAM_VBYTE_SIMD 0
+#endif
+
+#if FOLLY_STREAM_VBYTE_SIMD && defined(__AVX2__)
+#define FOLLY_STREAM_VBYTE_AVX2 1
+#else
+#define FOLLY_STREAM_VBYTE_AVX2 0
+#endif
+
+namespace folly {
+
+/**
+ * StreamVByte encoding for 32-bit and 64-bit values.
+ *
+ * Like GroupVarint, every value is stored in 1-4 (or 1-8) bytes, but the
+ * lengths are kept in a separate control stream in front of the data
+ * instead of being interleaved with it:
+ *
+ *   [control bytes: ceil(n / kGroupSize)][data bytes]
+ *
+ * A control byte holds the lengths of one group of four 32-bit values (two
+ * bits each) or two 64-bit values (four bits each), so the data for a
+ * group always fits in 16 bytes and can be scattered into place with a
+ * single byte shuffle (pshufb on x86, tbl on aarch64). With AVX2, two
+ * groups are decoded per shuffle.
+ *
+ * Unlike GroupVarint, decode() never reads past the end of the encoded
+ * stream; the last few groups are decoded with scalar code instead.
+ * encode() needs maxSize(n) bytes of output space, but only writes
+ * encodedSize() of them.
+ *
+ * The delta variants store differences between consecutive values (for
+ * sorted inputs such as posting lists); the zigzag variants map signed
+ * values of small magnitude to small unsigned values.
+ *
+ * This implementation assumes little-endian, just like GroupVarint.
+ */
+template <typename T>
+class StreamVByte {
+  static_assert(
+      std::is_same<T, uint32_t>::value || std::is_same<T, uint64_t>::value,
+      "StreamVByte supports uint32_t and uint64_t");
+  static_assert(kIsLittleEndian, "StreamVByte assumes little-endian");
+
+  typedef detail::StreamVByteTraits<T> Traits;
+
+ public:
+  typedef T type;
+  typedef typename std::make_signed<T>::type signed_type;
+
+  /**
+   * Number of values described by one control byte.
+   */
+  enum : uint32_t { kGroupSize = Traits::kGroupSize };
+
+  /**
+   * Size of the control stream for n values.
+   */
+  static size_t controlSize(size_t n) {
+    return (n + kGroupSize - 1) / kGroupSize;
+  }
+
+  /**
+   * Maximum encoded size for n values.
+   */
+  static size_t maxSize(size_t n) { return controlSize(n) + n * sizeof(type); }
+
+  /**
+   * Given a pointer to the beginning of a stream of n encoded values, return
+   * the number of bytes used by the encoding.
+   */
+  static size_t encodedSize(const char* p, size_t n) {
+    const auto& tables = detail::streamVByteTables<type>();
+    auto ctrl = reinterpret_cast<const uint8_t*>(p);
+    size_t groups = n / kGroupSize;
+    size_t size = controlSize(n);
+    for (size_t g = 0; g < groups; ++g) {
+      size += tables.length[ctrl[g]];
+    }
+    if (size_t tail = n % kGroupSize) {
+      // Keys for the missing values of the last group are zero (one byte).
+      size += tables.length[ctrl[groups]] - (kGroupSize - tail);
+    }
+    return size;
+  }
+
+  /**
+   * Encode n values from src into the buffer pointed-to by p, which must
+   * have at least maxSize(n) bytes available. Return the number of bytes
+   * written.
+   */
+  static size_t encode(char* p, const type* src, size_t n) {
+    auto ctrl = reinterpret_cast<uint8_t*>(p);
+    char* data = p + controlSize(n);
+    encodeGroups(ctrl, data, src, n);
+    return size_t(data - p);
+  }
+
+  /**
+   * Decode n values from the buffer pointed-to by p into dest, and return
+   * the number of bytes consumed.
+   */
+  static size_t decode(const char* p, type* dest, size_t n) {
+    auto ctrl = reinterpret_cast<const uint8_t*>(p);
+    const char* data = p + controlSize(n);
+    decodeGroups(ctrl, data, dest, n, 0);
+    return size_t(data - p);
+  }
+
+  /**
+   * Like encode(), but store the difference of each value from its
+   * predecessor (base for the first value). Values are expected to be
+   * non-decreasing; otherwise the differences wrap around and take the
+   * maximum size.
+   */
+  static size_t
+  encodeDelta(char* p, const type* src, size_t n, type base = 0) {
+    auto ctrl = reinterpret_cast<uint8_t*>(p);
+    char* data = p + controlSize(n);
+    type tmp[kChunkSize];
+    for (size_t i = 0; i < n; i += kChunkSize) {
+      size_t m = std::min<size_t>(kChunkSize, n - i);
+      for (size_t j = 0; j < m; ++j) {
+        tmp[j] = src[i + j] - base;
+        base = src[i + j];
+      }
+      encodeGroups(ctrl, data, tmp, m);
+    }
+    return size_t(data - p);
+  }
+
+  /**
+   * Decode a stream written by encodeDelta() with the same base.
+   */
+  static size_t
+  decodeDelta(const char* p, type* dest, size_t n, type base = 0) {
+    auto ctrl = reinterpret_cast<const uint8_t*>(p);
+    const char* data = p + controlSize(n);
+    for (size_t i = 0; i < n; i += kChunkSize) {
+      size_t m = std::min<size_t>(kChunkSize, n - i);
+      decodeGroups(ctrl, data, dest + i, m, n - i - m);
+      base = prefixSum(dest + i, m, base);
+    }
+    return size_t(data - p);
+  }
+
+  /**
+   * Like encode(), but for signed values, which are zigzag-encoded first so
+   * that values of small magnitude take few bytes.
+   */
+  static size_t encodeZigZag(char* p, const signed_type* src, size_t n) {
+    auto ctrl = reinterpret_cast<uint8_t*>(p);
+    char* data = p + controlSize(n);
+    type tmp[kChunkSize];
+    for (size_t i = 0; i < n; i += kChunkSize) {
+      size_t m = std::min<size_t>(kChunkSize, n - i);
+      for (size_t j = 0; j < m; ++j) {
+        tmp[j] = zigzag(src[i + j]);
+      }
+      encodeGroups(ctrl, data, tmp, m);
+    }
+    return size_t(data - p);
+  }
+
+  /**
+   * Decode a stream written by encodeZigZag().
+   */
+  static size_t decodeZigZag(const char* p, signed_type* dest, size_t n) {
+    auto ctrl = reinterpret_cast<const uint8_t*>(p);
+    const char* data = p + controlSize(n);
+    type tmp[kChunkSize];
+    for (size_t i = 0; i < n; i += kChunkSize) {
+      size_t m = std::min<size_t>(kChunkSize, n - i);
+      decodeGroups(ctrl, data, tmp, m, n - i - m);
+      for (size_t j = 0; j < m; ++j) {
+        dest[i + j] = unzigzag(tmp[j]);
+      }
+    }
+    return size_t(data - p);
+  }
+
+ private:
+  template <typename>
+  friend class StreamVByteDecoder;
+
+  // Transforms (delta, zigzag) are applied in chunks of this many values,
+  // a multiple of kGroupSize, so that they stay in L1.
+  enum : uint32_t { kChunkSize = 64 };
+
+  // A group uses at least kGroupSize bytes, so a 16-byte load at the start
+  // of a group stays within the stream if this many full groups follow it.
+  enum : uint32_t { kTrailGroups = 16 / kGroupSize - 1 };
+
+  static size_t length(uint8_t k, size_t i) {
+    return ((k >> (i * Traits::kKeyBits)) & (sizeof(type) - 1)) + 1;
+  }
+
+  static type zigzag(signed_type x) {
+    return (type(x) << 1) ^ type(x >> (sizeof(type) * 8 - 1));
+  }
+
+  static signed_type unzigzag(type x) {
+    return signed_type((x >> 1) ^ (type(0) - (x & 1)));
+  }
+
+  static char* encodeGroupScalar(
+      uint8_t* ctrl, char* data, const type* src, size_t count) {
+    uint8_t k = 0;
+    for (size_t i = 0; i < count; ++i) {
+      uint8_t ki = valueKey(src[i]);
+      k |= uint8_t(ki << (i * Traits::kKeyBits));
+      std::memcpy(data, &src[i], ki + 1);
+      data += ki + 1;
+    }
+    *ctrl = k;
+    return data;
+  }
+
+  static const char* decodeGroupScalar(
+      uint8_t k, const char* data, type* dest, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+      size_t len = length(k, i);
+      dest[i] = len == sizeof(type) ? loadUnaligned<type>(data)
+                                    : partialLoadUnaligned<type>(data, len);
+      data += len;
+    }
+    return data;
+  }
+
+  static uint8_t valueKey(type x) {
+    // findLastSet(x | 1) is the number of significant bits, at least 1.
+    return uint8_t((findLastSet(x | 1) - 1) / 8);
+  }
+
+  /**
+   * Encode n values, advancing the control and data cursors. Only the last
+   * call for a stream may pass a count that is not a multiple of
+   * kGroupSize.
+   */
+  static void
+  encodeGroups(uint8_t*& ctrl, char*& data, const type* src, size_t n) {
+    size_t groups = n / kGroupSize;
+    size_t g = 0;
+#if FOLLY_STREAM_VBYTE_SIMD
+    // Every full group reserves 16 bytes in maxSize(), so a full 16-byte
+    // store is always within the output buffer.
+    const auto& tables = detail::streamVByteTables<type>();
+    for (; g < groups; ++g) {
+      const type* s = src + g * kGroupSize;
+      uint8_t k = 0;
+      for (size_t i = 0; i < kGroupSize; ++i) {
+        k |= uint8_t(valueKey(s[i]) << (i * Traits::kKeyBits));
+      }
+      ctrl[g] = k;
+#if FOLLY_SSSE >= 3
+      __m128i val = _mm_loadu_si128((const __m128i*)s);
+      __m128i mask = _mm_load_si128((const __m128i*)tables.encodeMask[k]);
+      _mm_storeu_si128((__m128i*)data, _mm_shuffle_epi8(val, mask));
+#else
+      uint8x16_t val = vld1q_u8(reinterpret_cast<const uint8_t*>(s));
+      uint8x16_t mask = vld1q_u8(tables.encodeMask[k]);
+      vst1q_u8(reinterpret_cast<uint8_t*>(data), vqtbl1q_u8(val, mask));
+#endif
+      data += tables.length[k];
+    }
+#endif
+    for (; g < groups; ++g) {
+      data =
+          encodeGroupScalar(ctrl + g, data, src + g * kGroupSize, kGroupSize);
+    }
+    if (size_t tail = n % kGroupSize) {
+      data = encodeGroupScalar(ctrl + g, data, src + g * kGroupSize, tail);
+      ++g;
+    }
+    ctrl += g;
+  }
+
+  /**
+   * Decode n values, advancing the control and data cursors. trailing is
+   * the number of values in the stream after these n; it is only used to
+   * decide how far the vectorized loop may read ahead.
+   */
+  static void decodeGroups(
+      const uint8_t*& ctrl,
+      const char*& data,
+      type* dest,
+      size_t n,
+      size_t trailing) {
+    size_t groups = n / kGroupSize;
+    size_t g = 0;
+#if FOLLY_STREAM_VBYTE_SIMD
+    const auto& tables = detail::streamVByteTables<type>();
+    size_t total = (n + trailing) / kGroupSize;
+    size_t simdGroups =
+        std::min(groups, total > kTrailGroups ? total - kTrailGroups : 0);
+#if FOLLY_STREAM_VBYTE_AVX2
+    for (; g + 2 <= simdGroups; g += 2) {
+      uint8_t k0 = ctrl[g];
+      uint8_t k1 = ctrl[g + 1];
+      __m256i val = _mm256_inserti128_si256(
+          _mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)data)),
+          _mm_loadu_si128((const __m128i*)(data + tables.length[k0])),
+          1);
+      __m256i mask = _mm256_inserti128_si256(
+          _mm256_castsi128_si256(
+              _mm_load_si128((const __m128i*)tables.decodeMask[k0])),
+          _mm_load_si128((const __m128i*)tables.decodeMask[k1]),
+          1);
+      _mm256_storeu_si256(
+          (__m256i*)(dest + g * kGroupSize), _mm256_shuffle_epi8(val, mask));
+      data += tables.length[k0] + tables.length[k1];
+    }
+#endif
+    for (; g < simdGroups; ++g) {
+      uint8_t k = ctrl[g];
+#if FOLLY_SSSE >= 3
+      __m128i val = _mm_loadu_si128((const __m128i*)data);
+      __m128i mask = _mm_load_si128((const __m128i*)tables.decodeMask[k]);
+      _mm_storeu_si128(
+          (__m128i*)(dest + g * kGroupSize), _mm_shuffle_epi8(val, mask));
+#else
+      uint8x16_t val = vld1q_u8(reinterpret_cast<const uint8_t*>(data));
+      uint8x16_t mask = vld1q_u8(tables.decodeMask[k]);
+      vst1q_u8(
+          reinterpret_cast<uint8_t*>(dest + g * kGroupSize),
+          vqtbl1q_u8(val, mask));
+#endif
+      data += tables.length[k];
+    }
+#else
+    (void)trailing;
+#endif
+    for (; g < groups; ++g) {
+      data =
+          decodeGroupScalar(ctrl[g], data, dest + g * kGroupSize, kGroupSize);
+    }
+    if (size_t tail = n % kGroupSize) {
+      data = decodeGroupScalar(ctrl[g], data, dest + g * kGroupSize, tail);
+      ++g;
+    }
+    ctrl += g;
+  }
+
+  /**
+   * Replace dest[0..n) by its running sum starting at base, and return the
+   * last sum.
+   */
+  static type prefixSum(type* dest, size_t n, type base) {
+    size_t i = 0;
+    if (sizeof(type) == 4) {
+#if FOLLY_SSE >= 2
+      __m128i carry = _mm_set1_epi32(int32_t(base));
+      for (; i + 4 <= n; i += 4) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(dest + i));
+        x = _mm_add_epi32(x, _mm_slli_si128(x, 4));
+        x = _mm_add_epi32(x, _mm_slli_si128(x, 8));
+        x = _mm_add_epi32(x, carry);
+        _mm_storeu_si128((__m128i*)(dest + i), x);
+        carry = _mm_shuffle_epi32(x, 0xff);
+      }
+      if (i > 0) {
+        base = dest[i - 1];
+      }
+#elif FOLLY_NEON && FOLLY_AARCH64
+      auto p = reinterpret_cast<uint32_t*>(dest);
+      uint32x4_t zero = vdupq_n_u32(0);
+      uint32x4_t carry = vdupq_n_u32(uint32_t(base));
+      for (; i + 4 <= n; i += 4) {
+        uint32x4_t x = vld1q_u32(p + i);
+        x = vaddq_u32(x, vextq_u32(zero, x, 3));
+        x = vaddq_u32(x, vextq_u32(zero, x, 2));
+        x = vaddq_u32(x, carry);
+        vst1q_u32(p + i, x);
+        carry = vdupq_laneq_u32(x, 3);
+      }
+      if (i > 0) {
+        base = dest[i - 1];
+      }
+#endif
+    }
+    for (; i < n; ++i) {
+      base += dest[i];
+      dest[i] = base;
+    }
+    return base;
+  }
+};
+
+typedef StreamVByte<uint32_t> StreamVByte32;
+typedef StreamVByte<uint64_t> StreamVByte64;
+
+/**
+ * Bulk decoder over a StreamVByte-encoded block of a known number of
+ * values. Decodes whole groups straight into caller-provided buffers, so
+ * a large block can be consumed in cache-sized pieces.
+ */
+template <typename T>
+class StreamVByteDecoder {
+ public:
+  typedef StreamVByte<T> Base;
+  typedef T type;
+
+  StreamVByteDecoder() = default;
+
+  StreamVByteDecoder(StringPiece data, size_t count) { reset(data, count); }
+
+  void reset(StringPiece data, size_t count) {
+    ctrl_ = reinterpret_cast<const uint8_t*>(data.data());
+    data_ = data.data() + Base::controlSize(count);
+    end_ = data.end();
+    remaining_ = count;
+    DCHECK_LE(data_, end_);
+  }
+
+  /**
+   * Number of values not yet decoded.
+   */
+  size_t remaining() const { return remaining_; }
+
+  /**
+   * Decode up to maxCount values into dest, and return the number of values
+   * decoded (0 once the block is exhausted). Unless this finishes the
+   * block, the count is rounded down to whole groups, so maxCount must be
+   * at least Base::kGroupSize.
+   */
+  size_t next(type* dest, size_t maxCount) {
+    size_t n = std::min(maxCount, remaining_);
+    if (n < remaining_) {
+      DCHECK_GE(maxCount, size_t(Base::kGroupSize));
+      n -= n % Base::kGroupSize;
+    }
+    Base::decodeGroups(ctrl_, data_, dest, n, remaining_ - n);
+    remaining_ -= n;
+    DCHECK_LE(data_, end_);
+    return n;
+  }
+
+  StringPiece rest() const {
+    // This is only valid once the whole block has been decoded
+    CHECK(remaining_ == 0);
+    return StringPiece(data_, end_);
+  }
+
+ private:
+  const uint8_t* ctrl_{nullptr};
+  const char* data_{nullptr};
+  const char* end_{nullptr};
+  size_t remaining_{0};
+};
+
+typedef StreamVByteDecoder<uint32_t> StreamVByte32Decoder;
+typedef StreamVByteDecoder<uint64_t> StreamVByte64Decoder;
+
+} // namespace folly
@@ -0,0 +1,220 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// StringBuilder collects the pieces of a string and materializes them with
+// a single, exactly-sized allocation.
+//
+// Chains like a + b + c, or a loop of append() calls on an fbstring, grow
+// the destination by 1.5x through smartRealloc as they go, so a 200 byte
+// string typically costs three or four (re)allocations and leaves slack
+// capacity behind. A builder accumulates the fragments instead, then
+// reserves exactly the final size in the destination and copies each
+// fragment once:
+//
+//   StringBuilder sb;
+//   sb.append(key).append(": ").append(value);
+//   fbstring s = sb.str();          // one malloc, or none if it fits SSO
+//   sb.appendTo(existing);          // reserve exactly, then append
+//
+// Copied fragments live in a scratch buffer owned by the builder; clear()
+// keeps that buffer, so a builder reused across many strings stops
+// allocating once it has seen the largest one. appendRef() records a view
+// without copying it, which saves a copy for large pieces whose storage is
+// guaranteed to outlive the builder.
+//
+// Enable FOLLY_FBSTRING_ALLOC_STATS to count the (re)allocations fbstring
+// performs; scratchGrowths() reports the builder's own.
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <folly/FBString.h>
+#include <folly/Range.h>
+
+namespace folly {
+
+template <class Char>
+class BasicStringBuilder {
+ public:
+  using value_type = Char;
+  using size_type = std::size_t;
+  using piece_type = Range<const Char*>;
+
+  BasicStringBuilder() = default;
+
+  /**
+   * Preallocate scratch space for n copied characters.
+   */
+  explicit BasicStringBuilder(size_type n) { reserve(n); }
+
+  /**
+   * Total number of characters appended so far.
+   */
+  size_type size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  /**
+   * Number of times the scratch buffer had to grow. Zero for a builder
+   * that was reserved large enough, or reused for strings no longer than
+   * the ones it has already built.
+   */
+  size_type scratchGrowths() const { return scratchGrowths_; }
+
+  void reserve(size_type n) {
+    if (n > scratch_.capacity()) {
+      scratch_.reserve(n);
+      ++scratchGrowths_;
+    }
+  }
+
+  /**
+   * Forget all fragments but keep the scratch buffer for reuse.
+   */
+  void clear() {
+    scratch_.clear();
+    fragments_.clear();
+    size_ = 0;
+  }
+
+  BasicStringBuilder& append(const Char* s, size_type n) {
+    if (n == 0) {
+      return *this;
+    }
+    const size_type offset = scratch_.size();
+    countGrowth(n);
+    scratch_.insert(scratch_.end(), s, s + n);
+    // Consecutive copies are adjacent in the scratch buffer, so they extend
+    // the previous fragment rather than adding one.
+    if (!fragments_.empty() && fragments_.back().ref == nullptr &&
+        fragments_.back().offset + fragments_.back().size == offset) {
+      fragments_.back().size += n;
+    } else {
+      fragments_.push_back(Fragment{nullptr, offset, n});
+    }
+    size_ += n;
+    return *this;
+  }
+
+  BasicStringBuilder& append(piece_type s) {
+    return append(s.data(), s.size());
+  }
+
+  BasicStringBuilder& append(const Char* s) {
+    return append(s, std::char_traits<Char>::length(s));
+  }
+
+  template <class Traits, class Alloc>
+  BasicStringBuilder& append(const std::basic_string<Char, Traits, Alloc>& s) {
+    return append(s.data(), s.size());
+  }
+
+  template <class Traits, class Alloc, class Storage>
+  BasicStringBuilder& append(
+      const basic_fbstring<Char, Traits, Alloc, Storage>& s) {
+    return append(s.data(), s.size());
+  }
+
+  BasicStringBuilder& append(size_type n, Char c) {
+    if (n == 0) {
+      return *this;
+    }
+    append(&c, 1);
+    if (n > 1) {
+      countGrowth(n - 1);
+      scratch_.insert(scratch_.end(), n - 1, c);
+      fragments_.back().size += n - 1;
+      size_ += n - 1;
+    }
+    return *this;
+  }
+
+  void push_back(Char c) { append(&c, 1); }
+
+  template <class T>
+  BasicStringBuilder& operator+=(const T& s) {
+    return append(s);
+  }
+
+  BasicStringBuilder& operator+=(Char c) {
+    push_back(c);
+    return *this;
+  }
+
+  /**
+   * Append s without copying it. The referenced characters must stay valid
+   * and unchanged until the builder is cleared or destroyed.
+   */
+  BasicStringBuilder& appendRef(piece_type s) {
+    if (!s.empty()) {
+      fragments_.push_back(Fragment{s.data(), 0, s.size()});
+      size_ += s.size();
+    }
+    return *this;
+  }
+
+  /**
+   * Append the built string to out, after reserving exactly the capacity
+   * the result needs. out grows at most once, however many fragments there
+   * are.
+   */
+  template <class String>
+  void appendTo(String& out) const {
+    out.reserve(out.size() + size_);
+    for (const auto& f : fragments_) {
+      out.append(f.ref ? f.ref : scratch_.data() + f.offset, f.size);
+    }
+  }
+
+  /**
+   * Materialize the built string as a String (fbstring by default; any
+   * type with reserve() and append(const Char*, size_t) works, including
+   * std::string).
+   */
+  template <class String = basic_fbstring<Char>>
+  String str() const {
+    String out;
+    appendTo(out);
+    return out;
+  }
+
+ private:
+  void countGrowth(size_type n) {
+    if (scratch_.size() + n > scratch_.capacity()) {
+      ++scratchGrowths_;
+    }
+  }
+
+  // A piece of the result: either ref[0, size) for appendRef() fragments,
+  // or scratch_[offset, offset + size) for copied ones. Copied fragments
+  // are stored as offsets because growing scratch_ moves it.
+  struct Fragment {
+    const Char* ref;
+    size_type offset;
+    size_type size;
+  };
+
+  std::vector<Char> scratch_;
+  std::vector<Fragment> fragments_;
+  size_type size_ = 0;
+  size_type scratchGrowths_ = 0;
+};
+
+typedef BasicStringBuilder<char> StringBuilder;
+
+} // namespace folly
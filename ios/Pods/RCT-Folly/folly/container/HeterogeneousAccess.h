@@ -23,6 +23,15 @@
 #include <folly/Traits.h>
 #include <folly/container/HeterogeneousAccess-fwd.h>
 #include <folly/hash/Hash.h>
+#include <folly/hash/WyHash.h>
+
+// When FOLLY_F14_WYHASH_STRINGS is 1, HeterogeneousAccessHash (and so the
+// default hasher of F14 containers) hashes string keys with hash::WyHash
+// instead of std::hash. This is much faster for short keys, but changes
+// iteration order relative to the default build.
+#ifndef FOLLY_F14_WYHASH_STRINGS
+#define FOLLY_F14_WYHASH_STRINGS 0
+#endif
 
 namespace folly {
 
@@ -110,7 +119,10 @@ struct TransparentRangeHash {
   }
 
   static std::size_t hashImpl(StringPiece piece) {
-#if defined(_GLIBCXX_STRING)
+#if FOLLY_F14_WYHASH_STRINGS
+    return static_cast<std::size_t>(
+        hash::WyHash::Hash64(piece.data(), piece.size(), 0));
+#elif defined(_GLIBCXX_STRING)
     return std::_Hash_impl::hash(piece.begin(), piece.size());
 #elif defined(_LIBCPP_STRING)
     return std::__do_string_hash(piece.begin(), piece.end());
@@ -135,7 +147,9 @@ struct TransparentRangeHash {
   // of std::hash<std::string> then we should consider using it all of
   // the time.
   std::size_t operator()(std::string const& str) const {
-#if defined(_GLIBCXX_STRING) || defined(_LIBCPP_STRING)
+#if FOLLY_F14_WYHASH_STRINGS
+    return hashImpl(StringPiece{str});
+#elif defined(_GLIBCXX_STRING) || defined(_LIBCPP_STRING)
     return std::hash<std::string>{}(str);
 #else
     return hasher<StringPiece>{}(str);
@@ -166,6 +180,22 @@ using EligibleForHeterogeneousInsert = Conjunction<
 
 } // namespace detail
 
+// folly::WyStringHash is a transparent, avalanching hasher for anything
+// convertible to StringPiece, built on hash::WyHash. Pass it as the Hasher
+// of an F14 container (together with HeterogeneousAccessEqualTo) to select
+// it for that container only, e.g.
+//
+//   F14FastMap<std::string, int, WyStringHash> map;
+struct WyStringHash {
+  using is_transparent = void;
+  using folly_is_avalanching = std::true_type;
+
+  std::size_t operator()(StringPiece piece) const {
+    return static_cast<std::size_t>(
+        hash::WyHash::Hash64(piece.data(), piece.size(), 0));
+  }
+};
+
 template <typename T>
 struct HeterogeneousAccessEqualTo<
     T,
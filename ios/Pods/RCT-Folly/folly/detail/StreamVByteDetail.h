@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace folly {
+
+template <typename T>
+class StreamVByte;
+
+namespace detail {
+
+template <typename T>
+struct StreamVByteTraits;
+
+template <>
+struct StreamVByteTraits<uint32_t> {
+  enum : uint32_t {
+    kGroupSize = 4,
+    kKeyBits = 2,
+  };
+};
+
+template <>
+struct StreamVByteTraits<uint64_t> {
+  enum : uint32_t {
+    kGroupSize = 2,
+    kKeyBits = 4,
+  };
+};
+
+/**
+ * Shuffle tables for one StreamVByte control byte, indexed by the control
+ * byte itself. Each control byte describes one group of 16 value bytes
+ * (four 32-bit or two 64-bit values); a key of k means k + 1 bytes.
+ *
+ * decodeMask[key] scatters the packed bytes into value lanes, with 0x80
+ * (which both pshufb and tbl turn into zero) for the high bytes.
+ * encodeMask[key] is the inverse and gathers the low bytes of each lane.
+ * length[key] is the number of data bytes used by the group.
+ *
+ * 64-bit keys are nibbles of which only the low three bits are used, so
+ * that every control byte maps to a well-formed group.
+ */
+template <typename T>
+struct StreamVByteTables {
+  using Traits = StreamVByteTraits<T>;
+
+  alignas(16) uint8_t decodeMask[256][16] = {};
+  alignas(16) uint8_t encodeMask[256][16] = {};
+  uint8_t length[256] = {};
+
+  constexpr StreamVByteTables() {
+    constexpr uint32_t keyMask = (1u << Traits::kKeyBits) - 1;
+    for (uint32_t key = 0; key < 256; ++key) {
+      for (uint32_t j = 0; j < 16; ++j) {
+        decodeMask[key][j] = 0x80;
+        encodeMask[key][j] = 0x80;
+      }
+      uint8_t offset = 0;
+      for (uint32_t i = 0; i < Traits::kGroupSize; ++i) {
+        uint32_t k = (key >> (i * Traits::kKeyBits)) & keyMask;
+        uint32_t len = (k & (sizeof(T) - 1)) + 1;
+        for (uint32_t b = 0; b < len; ++b) {
+          decodeMask[key][i * sizeof(T) + b] = uint8_t(offset + b);
+          encodeMask[key][offset + b] = uint8_t(i * sizeof(T) + b);
+        }
+        offset = uint8_t(offset + len);
+      }
+      length[key] = offset;
+    }
+  }
+};
+
+extern const StreamVByteTables<uint32_t> streamVByteTables32;
+extern const StreamVByteTables<uint64_t> streamVByteTables64;
+
+template <typename T>
+inline const StreamVByteTables<T>& streamVByteTables();
+
+template <>
+inline const StreamVByteTables<uint32_t>& streamVByteTables<uint32_t>() {
+  return streamVByteTables32;
+}
+
+template <>
+inline const StreamVByteTables<uint64_t>& streamVByteTables<uint64_t>() {
+  return streamVByteTables64;
+}
+
+} // namespace detail
+} // namespace folly
@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/hash/Checksum.h>
+
+#include <algorithm>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <folly/hash/detail/ChecksumDetail.h>
+
+namespace folly {
+
+namespace {
+
+template <
+    uint32_t (*Crc)(const uint8_t*, size_t, uint32_t),
+    uint32_t (*Combine)(uint32_t, uint32_t, size_t)>
+uint32_t crc_parallel(
+    const uint8_t* data,
+    size_t nbytes,
+    size_t nthreads,
+    uint32_t startingChecksum) {
+  if (nthreads == 0) {
+    nthreads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  nthreads =
+      std::min(nthreads, std::max<size_t>(1, nbytes / kCrcParallelMinChunk));
+  if (nthreads <= 1) {
+    return Crc(data, nbytes, startingChecksum);
+  }
+
+  // Every chunk but the first starts from a zero state so that the partial
+  // results can be merged with *_combine() in any order.
+  size_t chunk = nbytes / nthreads;
+  std::vector<uint32_t> crcs(nthreads);
+  std::vector<std::thread> threads;
+  threads.reserve(nthreads - 1);
+  size_t started = 1;
+  try {
+    for (; started < nthreads; ++started) {
+      size_t i = started;
+      size_t len = i + 1 == nthreads ? nbytes - i * chunk : chunk;
+      threads.emplace_back([&crcs, i, ptr = data + i * chunk, len] {
+        crcs[i] = Crc(ptr, len, 0);
+      });
+    }
+  } catch (const std::system_error&) {
+    // Out of threads: the chunks that did not get one are done below, and
+    // the threads already started are still joined.
+  }
+  crcs[0] = Crc(data, chunk, startingChecksum);
+  for (size_t i = started; i < nthreads; ++i) {
+    size_t len = i + 1 == nthreads ? nbytes - i * chunk : chunk;
+    crcs[i] = Crc(data + i * chunk, len, 0);
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  uint32_t crc = crcs[0];
+  for (size_t i = 1; i < nthreads; ++i) {
+    size_t len = i + 1 == nthreads ? nbytes - i * chunk : chunk;
+    crc = Combine(crc, crcs[i], len);
+  }
+  return crc;
+}
+
+} // namespace
+
+uint32_t crc32c(
+    const uint8_t* data, size_t nbytes, uint32_t startingChecksum) {
+  if (detail::crc32c_hw_supported()) {
+    return detail::crc32c_hw(data, nbytes, startingChecksum);
+  } else {
+    return detail::crc32c_sw(data, nbytes, startingChecksum);
+  }
+}
+
+uint32_t crc32(const uint8_t* data, size_t nbytes, uint32_t startingChecksum) {
+  if (detail::crc32_hw_supported()) {
+    return detail::crc32_hw(data, nbytes, startingChecksum);
+  } else {
+    return detail::crc32_sw(data, nbytes, startingChecksum);
+  }
+}
+
+uint32_t crc32_type(
+    const uint8_t* data, size_t nbytes, uint32_t startingChecksum) {
+  return ~crc32(data, nbytes, startingChecksum);
+}
+
+uint32_t crc32_combine(uint32_t crc1, uint32_t crc2, size_t crc2len) {
+  return detail::crc_shift_sw<detail::kCrc32Poly>(crc1, crc2len) ^ crc2;
+}
+
+uint32_t crc32c_combine(uint32_t crc1, uint32_t crc2, size_t crc2len) {
+  return detail::crc_shift_sw<detail::kCrc32cPoly>(crc1, crc2len) ^ crc2;
+}
+
+uint32_t crc32c_parallel(
+    const uint8_t* data,
+    size_t nbytes,
+    size_t nthreads,
+    uint32_t startingChecksum) {
+  return crc_parallel<crc32c, crc32c_combine>(
+      data, nbytes, nthreads, startingChecksum);
+}
+
+uint32_t crc32_parallel(
+    const uint8_t* data,
+    size_t nbytes,
+    size_t nthreads,
+    uint32_t startingChecksum) {
+  return crc_parallel<crc32, crc32_combine>(
+      data, nbytes, nthreads, startingChecksum);
+}
+
+} // namespace folly
@@ -91,4 +91,30 @@ uint32_t crc32_combine(uint32_t crc1, uint32_t crc2, size_t crc2len);
    polynomial */
 uint32_t crc32c_combine(uint32_t crc1, uint32_t crc2, size_t crc2len);
 
+constexpr size_t kCrcParallelMinChunk = size_t(1) << 20;
+
+/**
+ * Compute the CRC-32C checksum of a large buffer by checksumming disjoint
+ * chunks of it on up to nthreads threads (including the calling thread)
+ * and merging the partial checksums with crc32c_combine(). The result is
+ * identical to crc32c(data, nbytes, startingChecksum).
+ *
+ * Each thread gets at least kCrcParallelMinChunk bytes, so small buffers
+ * are checksummed on the calling thread alone. Passing nthreads == 0 uses
+ * std::thread::hardware_concurrency().
+ */
+uint32_t crc32c_parallel(
+    const uint8_t* data,
+    size_t nbytes,
+    size_t nthreads = 0,
+    uint32_t startingChecksum = ~0U);
+
+/* crc32_parallel is the same as crc32c_parallel, but uses the crc32
+   polynomial */
+uint32_t crc32_parallel(
+    const uint8_t* data,
+    size_t nbytes,
+    size_t nthreads = 0,
+    uint32_t startingChecksum = ~0U);
+
 } // namespace folly
@@ -0,0 +1,293 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// WyHash: a fast 64-bit noncryptographic hash built on the 64x64->128 bit
+// multiply-and-fold ("mum") mixer, following the structure of Wang Yi's
+// wyhash (final version 4, public domain).
+//
+// Keys of up to 16 bytes are hashed with two (possibly overlapping) loads
+// and two multiplies, which makes it several times faster than SpookyHashV2
+// for the short keys that dominate hash table workloads. Long messages run
+// three independent lanes over 48-byte blocks.
+//
+// Hash64 with a given seed returns the same value as wyhash(key, len, seed,
+// _wyp) of the reference wyhash final 4, so it reproduces that version's
+// test vectors. Hash128 and the streaming interface are folly additions;
+// Final64() equals Hash64() of the whole message.
+//
+// Input words are read as little-endian, so big-endian machines compute
+// the same results.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <folly/Likely.h>
+#include <folly/Portability.h>
+#include <folly/lang/Bits.h>
+
+namespace folly {
+namespace hash {
+
+class WyHash {
+ public:
+  //
+  // Hash64: hash a single message in one call, return 64-bit output
+  //
+  static uint64_t Hash64(const void* message, size_t length, uint64_t seed) {
+    auto p = static_cast<const uint8_t*>(message);
+    State s;
+    s.init(seed);
+    uint64_t a, b;
+    if (FOLLY_LIKELY(length <= 16)) {
+      shortInput(p, length, &a, &b);
+    } else {
+      size_t i = length;
+      if (FOLLY_UNLIKELY(i > kBlockSize)) {
+        do {
+          s.block(p);
+          p += kBlockSize;
+          i -= kBlockSize;
+        } while (FOLLY_LIKELY(i > kBlockSize));
+        s.fold();
+      }
+      s.tail(p, i, &a, &b);
+    }
+    return s.finish(a, b, length);
+  }
+
+  //
+  // Hash128: hash a single message in one call, produce 128-bit output.
+  // On input *hash1 is the seed; *hash2 is ignored.
+  //
+  static void Hash128(
+      const void* message, size_t length, uint64_t* hash1, uint64_t* hash2) {
+    WyHash h;
+    h.Init(*hash1);
+    h.Update(message, length);
+    h.Final(hash1, hash2);
+  }
+
+  //
+  // Hash32: hash a single message in one call, produce 32-bit output
+  //
+  static uint32_t Hash32(const void* message, size_t length, uint32_t seed) {
+    return static_cast<uint32_t>(Hash64(message, length, seed));
+  }
+
+  //
+  // Init: initialize the context of a streaming WyHash
+  //
+  void Init(uint64_t seed) {
+    state_.init(seed);
+    length_ = 0;
+    pending_ = 0;
+    folded_ = false;
+  }
+
+  //
+  // Update: add a piece of a message to a WyHash state
+  //
+  void Update(const void* message, size_t length) {
+    auto p = static_cast<const uint8_t*>(message);
+    length_ += length;
+    // A block is only consumed once at least one more byte is known to
+    // follow it, because the one-shot hash handles a final block of
+    // exactly kBlockSize bytes as the tail.
+    if (pending_ + length <= kBlockSize) {
+      std::memcpy(buf_ + kHistory + pending_, p, length);
+      pending_ += length;
+      return;
+    }
+    if (pending_ > 0) {
+      size_t fill = kBlockSize - pending_;
+      std::memcpy(buf_ + kHistory + pending_, p, fill);
+      p += fill;
+      length -= fill;
+      state_.block(buf_ + kHistory);
+      std::memcpy(buf_, buf_ + kHistory + kBlockSize - kHistory, kHistory);
+      pending_ = 0;
+    }
+    if (length > kBlockSize) {
+      do {
+        state_.block(p);
+        p += kBlockSize;
+        length -= kBlockSize;
+      } while (length > kBlockSize);
+      std::memcpy(buf_, p - kHistory, kHistory);
+    }
+    std::memcpy(buf_ + kHistory, p, length);
+    pending_ = length;
+    folded_ = true;
+  }
+
+  //
+  // Final64: compute the 64-bit hash for the current state. The result is
+  // the same as Hash64() of all the pieces concatenated into one message.
+  //
+  // This does not modify the state; you can keep updating it afterward.
+  //
+  uint64_t Final64() const {
+    uint64_t a, b;
+    State s = finalState(&a, &b);
+    return s.finish(a, b, length_);
+  }
+
+  //
+  // Final: compute the 128-bit hash for the current state. The first word
+  // equals Final64(); the second is folded from the same final state with
+  // different constants.
+  //
+  void Final(uint64_t* hash1, uint64_t* hash2) const {
+    uint64_t a, b;
+    State s = finalState(&a, &b);
+    *hash1 = s.finish(a, b, length_);
+    *hash2 = s.finish2(a, b, length_);
+  }
+
+ private:
+  static constexpr size_t kBlockSize = 48;
+  static constexpr size_t kHistory = 16;
+
+  static constexpr uint64_t kSecret0 = 0xa0761d6478bd642fULL;
+  static constexpr uint64_t kSecret1 = 0xe7037ed1a0b428dbULL;
+  static constexpr uint64_t kSecret2 = 0x8ebc6af09c88c6e3ULL;
+  static constexpr uint64_t kSecret3 = 0x589965cc75374cc3ULL;
+
+  static void mum(uint64_t* a, uint64_t* b) {
+#if FOLLY_HAVE_INT128_T || defined(__SIZEOF_INT128__)
+    unsigned __int128 r = *a;
+    r *= *b;
+    *a = static_cast<uint64_t>(r);
+    *b = static_cast<uint64_t>(r >> 64);
+#else
+    uint64_t ha = *a >> 32, hb = *b >> 32;
+    uint64_t la = static_cast<uint32_t>(*a), lb = static_cast<uint32_t>(*b);
+    uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    uint64_t t = rl + (rm0 << 32);
+    uint64_t c = t < rl;
+    uint64_t lo = t + (rm1 << 32);
+    c += lo < t;
+    uint64_t hi = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+    *a = lo;
+    *b = hi;
+#endif
+  }
+
+  static uint64_t mix(uint64_t a, uint64_t b) {
+    mum(&a, &b);
+    return a ^ b;
+  }
+
+  static uint64_t read8(const uint8_t* p) {
+    return Endian::little(loadUnaligned<uint64_t>(p));
+  }
+  static uint64_t read4(const uint8_t* p) {
+    return Endian::little(loadUnaligned<uint32_t>(p));
+  }
+  static uint64_t read3(const uint8_t* p, size_t k) {
+    return (uint64_t(p[0]) << 16) | (uint64_t(p[k >> 1]) << 8) | p[k - 1];
+  }
+
+  static void
+  shortInput(const uint8_t* p, size_t length, uint64_t* a, uint64_t* b) {
+    if (FOLLY_LIKELY(length >= 4)) {
+      size_t mid = (length >> 3) << 2;
+      *a = (read4(p) << 32) | read4(p + mid);
+      *b = (read4(p + length - 4) << 32) | read4(p + length - 4 - mid);
+    } else if (FOLLY_LIKELY(length > 0)) {
+      *a = read3(p, length);
+      *b = 0;
+    } else {
+      *a = *b = 0;
+    }
+  }
+
+  struct State {
+    uint64_t seed;
+    uint64_t see1;
+    uint64_t see2;
+
+    void init(uint64_t s) {
+      seed = s ^ mix(s ^ kSecret0, kSecret1);
+      see1 = seed;
+      see2 = seed;
+    }
+
+    void block(const uint8_t* p) {
+      seed = mix(read8(p) ^ kSecret1, read8(p + 8) ^ seed);
+      see1 = mix(read8(p + 16) ^ kSecret2, read8(p + 24) ^ see1);
+      see2 = mix(read8(p + 32) ^ kSecret3, read8(p + 40) ^ see2);
+    }
+
+    void fold() { seed ^= see1 ^ see2; }
+
+    // Hash the last 1..48 bytes of a message of more than 16 bytes.
+    // p[-16, 0) must be readable if i < 16.
+    void tail(const uint8_t* p, size_t i, uint64_t* a, uint64_t* b) {
+      while (FOLLY_UNLIKELY(i > 16)) {
+        seed = mix(read8(p) ^ kSecret1, read8(p + 8) ^ seed);
+        i -= 16;
+        p += 16;
+      }
+      *a = read8(p + i - 16);
+      *b = read8(p + i - 8);
+    }
+
+    uint64_t finish(uint64_t a, uint64_t b, uint64_t length) const {
+      a ^= kSecret1;
+      b ^= seed;
+      mum(&a, &b);
+      return mix(a ^ kSecret0 ^ length, b ^ kSecret1);
+    }
+
+    uint64_t finish2(uint64_t a, uint64_t b, uint64_t length) const {
+      a ^= kSecret1;
+      b ^= seed;
+      mum(&a, &b);
+      return mix(a ^ kSecret2 ^ length, b ^ kSecret3);
+    }
+  };
+
+  State finalState(uint64_t* a, uint64_t* b) const {
+    State s = state_;
+    const uint8_t* p = buf_ + kHistory;
+    if (!folded_) {
+      if (length_ <= 16) {
+        shortInput(p, pending_, a, b);
+      } else {
+        s.tail(p, pending_, a, b);
+      }
+    } else {
+      s.fold();
+      s.tail(p, pending_, a, b);
+    }
+    return s;
+  }
+
+  State state_;
+  uint64_t length_;
+  size_t pending_;
+  bool folded_;
+  // The last kHistory consumed bytes followed by up to kBlockSize pending
+  // ones, so that the tail can read back across the block boundary.
+  uint8_t buf_[kHistory + kBlockSize];
+};
+
+} // namespace hash
+} // namespace folly
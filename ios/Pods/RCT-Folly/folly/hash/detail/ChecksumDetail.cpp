@@ -0,0 +1,391 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/hash/detail/ChecksumDetail.h>
+
+#include <stdexcept>
+
+#include <folly/CpuId.h>
+#include <folly/Portability.h>
+#include <folly/lang/Bits.h>
+
+#if FOLLY_X64
+#include <immintrin.h>
+#elif FOLLY_AARCH64 && defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+
+namespace folly {
+namespace detail {
+
+namespace {
+
+// Slicing-by-8 lookup tables: tables[0] is the classic byte-at-a-time
+// table, tables[k][b] advances tables[k - 1][b] over one more zero byte.
+template <uint32_t Poly>
+struct crc_sw_tables {
+  uint32_t value[8][256] = {};
+
+  constexpr crc_sw_tables() {
+    for (uint32_t b = 0; b < 256; ++b) {
+      uint32_t crc = b;
+      for (int i = 0; i < 8; ++i) {
+        crc = (crc & 1) ? (crc >> 1) ^ Poly : crc >> 1;
+      }
+      value[0][b] = crc;
+    }
+    for (size_t k = 1; k < 8; ++k) {
+      for (size_t b = 0; b < 256; ++b) {
+        uint32_t prev = value[k - 1][b];
+        value[k][b] = (prev >> 8) ^ value[0][prev & 0xff];
+      }
+    }
+  }
+};
+
+template <uint32_t Poly>
+uint32_t crc_sw(const uint8_t* data, size_t nbytes, uint32_t crc) {
+  static constexpr crc_sw_tables<Poly> tables{};
+  const auto& t = tables.value;
+  while (nbytes >= 8) {
+    auto v = Endian::little(loadUnaligned<uint64_t>(data));
+    uint32_t lo = uint32_t(v) ^ crc;
+    uint32_t hi = uint32_t(v >> 32);
+    crc = t[7][lo & 0xff] ^ t[6][(lo >> 8) & 0xff] ^ t[5][(lo >> 16) & 0xff] ^
+        t[4][lo >> 24] ^ t[3][hi & 0xff] ^ t[2][(hi >> 8) & 0xff] ^
+        t[1][(hi >> 16) & 0xff] ^ t[0][hi >> 24];
+    data += 8;
+    nbytes -= 8;
+  }
+  while (nbytes > 0) {
+    crc = t[0][(crc ^ *data) & 0xff] ^ (crc >> 8);
+    ++data;
+    --nbytes;
+  }
+  return crc;
+}
+
+} // namespace
+
+uint32_t crc32c_sw(
+    const uint8_t* data, size_t nbytes, uint32_t startingChecksum) {
+  return crc_sw<kCrc32cPoly>(data, nbytes, startingChecksum);
+}
+
+uint32_t crc32_sw(
+    const uint8_t* data, size_t nbytes, uint32_t startingChecksum) {
+  return crc_sw<kCrc32Poly>(data, nbytes, startingChecksum);
+}
+
+#if FOLLY_X64 || (FOLLY_AARCH64 && defined(__ARM_FEATURE_CRC32))
+
+#if FOLLY_X64
+#define FOLLY_DETAIL_CRC_TARGET FOLLY_TARGET_ATTRIBUTE("sse4.2")
+#else
+#define FOLLY_DETAIL_CRC_TARGET
+#endif
+
+namespace {
+
+// The CRC instructions have a latency of about three cycles but a
+// throughput of one per cycle, so a single dependency chain leaves most of
+// the unit idle. Checksum three adjacent blocks as independent streams and
+// stitch the partial results together by shifting them over the blocks
+// that follow. Long blocks amortize the two shifts; short blocks keep
+// medium-sized inputs on the interleaved path.
+constexpr size_t kLongBlock = 4096;
+constexpr size_t kShortBlock = 256;
+
+template <uint32_t Poly, size_t Block>
+struct crc_block_shift {
+  // x^(8 * Block): shifts a state over one block in software.
+  static constexpr uint32_t kSw = gf_xpow_sw<Poly>(8 * Block);
+  // x^(8 * Block - 33): the carry-less product with this constant is
+  // reduced by one crc32 instruction, which contributes the other x^33.
+  static constexpr uint32_t kHw = gf_xpow_sw<Poly>(8 * Block - 33);
+};
+
+#if FOLLY_X64
+
+FOLLY_TARGET_ATTRIBUTE("sse4.2,pclmul")
+uint32_t crc32c_shift_pclmul(uint32_t crc, uint32_t k) {
+  auto product = _mm_clmulepi64_si128(
+      _mm_cvtsi32_si128(int32_t(crc)), _mm_cvtsi32_si128(int32_t(k)), 0x00);
+  return uint32_t(_mm_crc32_u64(0, uint64_t(_mm_cvtsi128_si64(product))));
+}
+
+bool has_pclmul() {
+  static const bool supported = CpuId().pclmuldq();
+  return supported;
+}
+
+struct crc32c_insn {
+  static constexpr uint32_t kPoly = kCrc32cPoly;
+
+  FOLLY_DETAIL_CRC_TARGET static uint32_t step(uint32_t crc, uint64_t v) {
+    return uint32_t(_mm_crc32_u64(crc, v));
+  }
+  FOLLY_DETAIL_CRC_TARGET static uint32_t step(uint32_t crc, uint8_t v) {
+    return _mm_crc32_u8(crc, v);
+  }
+  template <size_t Block>
+  static uint32_t shift(uint32_t crc) {
+    using constants = crc_block_shift<kPoly, Block>;
+    return has_pclmul() ? crc32c_shift_pclmul(crc, constants::kHw)
+                        : gf_multiply_sw<kPoly>(constants::kSw, crc);
+  }
+};
+
+#else
+
+struct crc32c_insn {
+  static constexpr uint32_t kPoly = kCrc32cPoly;
+
+  static uint32_t step(uint32_t crc, uint64_t v) { return __crc32cd(crc, v); }
+  static uint32_t step(uint32_t crc, uint8_t v) { return __crc32cb(crc, v); }
+  template <size_t Block>
+  static uint32_t shift(uint32_t crc) {
+    return gf_multiply_sw<kPoly>(crc_block_shift<kPoly, Block>::kSw, crc);
+  }
+};
+
+struct crc32_insn {
+  static constexpr uint32_t kPoly = kCrc32Poly;
+
+  static uint32_t step(uint32_t crc, uint64_t v) { return __crc32d(crc, v); }
+  static uint32_t step(uint32_t crc, uint8_t v) { return __crc32b(crc, v); }
+  template <size_t Block>
+  static uint32_t shift(uint32_t crc) {
+    return gf_multiply_sw<kPoly>(crc_block_shift<kPoly, Block>::kSw, crc);
+  }
+};
+
+#endif
+
+template <class Insn, size_t Block>
+FOLLY_DETAIL_CRC_TARGET uint32_t
+crc_three_way(const uint8_t*& data, size_t& nbytes, uint32_t crc) {
+  while (nbytes >= 3 * Block) {
+    uint32_t c0 = crc;
+    uint32_t c1 = 0;
+    uint32_t c2 = 0;
+    for (size_t i = 0; i < Block; i += 8) {
+      c0 = Insn::step(c0, Endian::little(loadUnaligned<uint64_t>(data + i)));
+      c1 = Insn::step(
+          c1, Endian::little(loadUnaligned<uint64_t>(data + Block + i)));
+      c2 = Insn::step(
+          c2, Endian::little(loadUnaligned<uint64_t>(data + 2 * Block + i)));
+    }
+    crc = Insn::template shift<Block>(c0) ^ c1;
+    crc = Insn::template shift<Block>(crc) ^ c2;
+    data += 3 * Block;
+    nbytes -= 3 * Block;
+  }
+  return crc;
+}
+
+template <class Insn>
+FOLLY_DETAIL_CRC_TARGET uint32_t
+crc_hw(const uint8_t* data, size_t nbytes, uint32_t crc) {
+  while (nbytes > 0 && (reinterpret_cast<uintptr_t>(data) & 7) != 0) {
+    crc = Insn::step(crc, *data);
+    ++data;
+    --nbytes;
+  }
+  crc = crc_three_way<Insn, kLongBlock>(data, nbytes, crc);
+  crc = crc_three_way<Insn, kShortBlock>(data, nbytes, crc);
+  while (nbytes >= 8) {
+    crc = Insn::step(crc, Endian::little(loadUnaligned<uint64_t>(data)));
+    data += 8;
+    nbytes -= 8;
+  }
+  while (nbytes > 0) {
+    crc = Insn::step(crc, *data);
+    ++data;
+    --nbytes;
+  }
+  return crc;
+}
+
+} // namespace
+
+#undef FOLLY_DETAIL_CRC_TARGET
+
+uint32_t crc32c_hw(
+    const uint8_t* data, size_t nbytes, uint32_t startingChecksum) {
+  return crc_hw<crc32c_insn>(data, nbytes, startingChecksum);
+}
+
+#if FOLLY_X64
+
+bool crc32c_hw_supported() {
+  static const bool supported = CpuId().sse42();
+  return supported;
+}
+
+namespace {
+
+// Fold 64 bytes per iteration with PCLMULQDQ and finish with a Barrett
+// reduction; see "Fast CRC Computation for Generic Polynomials Using
+// PCLMULQDQ Instruction" (Gopal et al., Intel, 2009). The constants are
+// the bit-reflected k1..k5, P(x) and mu for the CRC-32 polynomial.
+// Requires nbytes >= 64 and nbytes % 16 == 0.
+FOLLY_TARGET_ATTRIBUTE("sse4.1,pclmul")
+uint32_t crc32_fold_pclmul(const uint8_t* buf, size_t nbytes, uint32_t crc) {
+  alignas(16) static const uint64_t k1k2[] = {0x0154442bd4, 0x01c6e41596};
+  alignas(16) static const uint64_t k3k4[] = {0x01751997d0, 0x00ccaa009e};
+  alignas(16) static const uint64_t k5k0[] = {0x0163cd6124, 0x0000000000};
+  alignas(16) static const uint64_t poly[] = {0x01db710641, 0x01f7011641};
+
+  __m128i x0, x1, x2, x3, x4, x5, x6, x7, x8, y5, y6, y7, y8;
+
+  x1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buf + 0x00));
+  x2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buf + 0x10));
+  x3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buf + 0x20));
+  x4 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buf + 0x30));
+  x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(int32_t(crc)));
+  x0 = _mm_load_si128(reinterpret_cast<const __m128i*>(k1k2));
+  buf += 64;
+  nbytes -= 64;
+
+  // Four independent 128-bit lanes, each folded forward by 512 bits.
+  while (nbytes >= 64) {
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+    x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+    x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+    x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+    x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+    y5 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buf + 0x00));
+    y6 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buf + 0x10));
+    y7 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buf + 0x20));
+    y8 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buf + 0x30));
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), y5);
+    x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), y6);
+    x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), y7);
+    x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), y8);
+    buf += 64;
+    nbytes -= 64;
+  }
+
+  // Fold the four lanes into one.
+  x0 = _mm_load_si128(reinterpret_cast<const __m128i*>(k3k4));
+  for (auto next : {x2, x3, x4}) {
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, next), x5);
+  }
+
+  while (nbytes >= 16) {
+    x2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buf));
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+    buf += 16;
+    nbytes -= 16;
+  }
+
+  // Fold 128 bits down to 64.
+  x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+  x3 = _mm_setr_epi32(~0, 0, ~0, 0);
+  x1 = _mm_srli_si128(x1, 8);
+  x1 = _mm_xor_si128(x1, x2);
+  x0 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(k5k0));
+  x2 = _mm_srli_si128(x1, 4);
+  x1 = _mm_and_si128(x1, x3);
+  x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+  x1 = _mm_xor_si128(x1, x2);
+
+  // Barrett reduction down to 32 bits.
+  x0 = _mm_load_si128(reinterpret_cast<const __m128i*>(poly));
+  x2 = _mm_and_si128(x1, x3);
+  x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+  x2 = _mm_and_si128(x2, x3);
+  x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+  x1 = _mm_xor_si128(x1, x2);
+
+  return uint32_t(_mm_extract_epi32(x1, 1));
+}
+
+} // namespace
+
+uint32_t crc32_hw(
+    const uint8_t* data, size_t nbytes, uint32_t startingChecksum) {
+  uint32_t crc = startingChecksum;
+  if (nbytes >= 64) {
+    size_t folded = nbytes & ~size_t(15);
+    crc = crc32_fold_pclmul(data, folded, crc);
+    data += folded;
+    nbytes -= folded;
+  }
+  return crc32_sw(data, nbytes, crc);
+}
+
+bool crc32_hw_supported() {
+  static const bool supported = [] {
+    CpuId id;
+    return id.sse41() && id.pclmuldq();
+  }();
+  return supported;
+}
+
+#else // FOLLY_AARCH64 && __ARM_FEATURE_CRC32
+
+bool crc32c_hw_supported() {
+  return true;
+}
+
+uint32_t crc32_hw(
+    const uint8_t* data, size_t nbytes, uint32_t startingChecksum) {
+  return crc_hw<crc32_insn>(data, nbytes, startingChecksum);
+}
+
+bool crc32_hw_supported() {
+  return true;
+}
+
+#endif
+
+#else
+
+uint32_t crc32c_hw(
+    const uint8_t* /* data */,
+    size_t /* nbytes */,
+    uint32_t /* startingChecksum */) {
+  throw std::runtime_error("crc32c_hw is not implemented on this platform");
+}
+
+bool crc32c_hw_supported() {
+  return false;
+}
+
+uint32_t crc32_hw(
+    const uint8_t* /* data */,
+    size_t /* nbytes */,
+    uint32_t /* startingChecksum */) {
+  throw std::runtime_error("crc32_hw is not implemented on this platform");
+}
+
+bool crc32_hw_supported() {
+  return false;
+}
+
+#endif
+
+} // namespace detail
+} // namespace folly
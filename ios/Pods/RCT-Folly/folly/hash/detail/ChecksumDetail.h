@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include <cstddef>
+
+namespace folly {
+namespace detail {
+
+// Bit-reflected generator polynomials.
+constexpr uint32_t kCrc32Poly = 0xedb88320;
+constexpr uint32_t kCrc32cPoly = 0x82f63b78;
+
+/**
+ * Multiply two polynomials modulo the bit-reflected CRC polynomial Poly.
+ * In the reflected representation the most significant bit is x^0, so
+ * (1U << 31) is the multiplicative identity and (1U << 30) is x.
+ */
+template <uint32_t Poly>
+constexpr uint32_t gf_multiply_sw(uint32_t a, uint32_t b) {
+  uint32_t m = uint32_t(1) << 31;
+  uint32_t p = 0;
+  while (m != 0) {
+    if (a & m) {
+      p ^= b;
+      if ((a & (m - 1)) == 0) {
+        break;
+      }
+    }
+    m >>= 1;
+    b = (b & 1) ? (b >> 1) ^ Poly : b >> 1;
+  }
+  return p;
+}
+
+/**
+ * Table of x^(2^k) mod Poly, used to raise x to arbitrary powers with one
+ * multiplication per set bit of the exponent.
+ */
+template <uint32_t Poly>
+struct gf_powers_of_x {
+  uint32_t value[64] = {};
+
+  constexpr gf_powers_of_x() {
+    value[0] = uint32_t(1) << 30;
+    for (size_t k = 1; k < 64; ++k) {
+      value[k] = gf_multiply_sw<Poly>(value[k - 1], value[k - 1]);
+    }
+  }
+};
+
+/**
+ * Compute x^n mod Poly.
+ */
+template <uint32_t Poly>
+constexpr uint32_t gf_xpow_sw(uint64_t n) {
+  constexpr gf_powers_of_x<Poly> powers{};
+  uint32_t p = uint32_t(1) << 31;
+  for (size_t k = 0; n != 0; ++k, n >>= 1) {
+    if (n & 1) {
+      p = gf_multiply_sw<Poly>(powers.value[k], p);
+    }
+  }
+  return p;
+}
+
+/**
+ * Advance a CRC state over nbytes zero bytes, i.e. multiply it by
+ * x^(8 * nbytes). This is the core of the *_combine functions.
+ */
+template <uint32_t Poly>
+constexpr uint32_t crc_shift_sw(uint32_t crc, size_t nbytes) {
+  return gf_multiply_sw<Poly>(gf_xpow_sw<Poly>(uint64_t(nbytes) * 8), crc);
+}
+
+/**
+ * Compute a CRC-32C checksum of a buffer using a hardware-accelerated
+ * implementation.
+ *
+ * @note This function is exposed to support special cases where the
+ *       calling code is absolutely certain it ought to invoke a hardware-
+ *       accelerated CRC-32C implementation - unit tests, for example.  For
+ *       all other scenarios, please call crc32c() and let it pick an
+ *       implementation based on the capabilities of the underlying CPU.
+ */
+uint32_t crc32c_hw(
+    const uint8_t* data, size_t nbytes, uint32_t startingChecksum = ~0U);
+
+/**
+ * Check whether a hardware-accelerated CRC-32C implementation is
+ * supported on the current CPU.
+ */
+bool crc32c_hw_supported();
+
+/**
+ * Compute a CRC-32C checksum of a buffer using a portable,
+ * software-only implementation.
+ *
+ * @note This function is exposed to support special cases where the
+ *       calling code is absolutely certain it wants to use the software
+ *       implementation instead of the hardware-accelerated code - unit
+ *       tests, for example.  For all other scenarios, please call crc32c()
+ *       and let it pick an implementation based on the capabilities of
+ *       the underlying CPU.
+ */
+uint32_t crc32c_sw(
+    const uint8_t* data, size_t nbytes, uint32_t startingChecksum = ~0U);
+
+/**
+ * Compute a CRC-32 checksum of a buffer using a hardware-accelerated
+ * implementation: PCLMULQDQ folding on x86-64, the CRC32 instructions
+ * on ARMv8.
+ */
+uint32_t crc32_hw(
+    const uint8_t* data, size_t nbytes, uint32_t startingChecksum = ~0U);
+
+/**
+ * Check whether a hardware-accelerated CRC-32 implementation is
+ * supported on the current CPU.
+ */
+bool crc32_hw_supported();
+
+/**
+ * Compute a CRC-32 checksum of a buffer using a portable,
+ * software-only implementation.
+ */
+uint32_t crc32_sw(
+    const uint8_t* data, size_t nbytes, uint32_t startingChecksum = ~0U);
+
+} // namespace detail
+} // namespace folly
@@ -0,0 +1,244 @@
+//
+// Copyright (c) 2019 Peter Dimov (pdimov at gmail dot com),
+//                    Vinnie Falco (vinnie.falco@gmail.com)
+// Copyright (c) 2020 Krystian Stasiowski (sdkrystian@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/boostorg/json
+//
+
+#ifndef BOOST_JSON_DETAIL_AVX2_HPP
+#define BOOST_JSON_DETAIL_AVX2_HPP
+
+#include <boost/json/detail/config.hpp>
+#include <boost/json/detail/utf8.hpp>
+#include <cstddef>
+#include <immintrin.h>
+#ifdef _MSC_VER
+# include <intrin.h>
+#endif
+
+// The kernels below are compiled for AVX2 even when
+// the rest of the program is not, and must only be
+// called after cpu_has_avx2() returned true.
+#if defined(__GNUC__) || defined(__clang__)
+# define BOOST_JSON_AVX2_TARGET __attribute__((target("avx2")))
+#else
+# define BOOST_JSON_AVX2_TARGET
+#endif
+
+BOOST_JSON_NS_BEGIN
+namespace detail {
+
+// Read without a guard on every call. A scan
+// that runs before the flag is initialized
+// sees false and takes the SSE2 path.
+template<class = void>
+struct avx2_support
+{
+    static bool const value;
+
+    static
+    bool
+    detect() noexcept
+    {
+#if defined(__AVX2__)
+        return true;
+#elif defined(_MSC_VER) && ! defined(__clang__)
+        int r[4];
+        __cpuid(r, 0);
+        if(r[0] < 7)
+            return false;
+        // the OS must save the ymm registers
+        __cpuid(r, 1);
+        if((r[2] & 0x18000000) != 0x18000000 ||
+            (_xgetbv(0) & 6) != 6)
+            return false;
+        __cpuidex(r, 7, 0);
+        return (r[1] & 0x20) != 0;
+#else
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") != 0;
+#endif
+    }
+};
+
+template<class T>
+bool const avx2_support<T>::value = avx2_support<T>::detect();
+
+inline
+bool
+cpu_has_avx2() noexcept
+{
+    return avx2_support<>::value;
+}
+
+BOOST_JSON_AVX2_TARGET
+inline
+int
+find_first_avx2(unsigned m) noexcept
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctz(m);
+#else
+    unsigned long index;
+    _BitScanForward( &index, m );
+    return static_cast<int>(index);
+#endif
+}
+
+// nonzero in every byte which is a quote,
+// backslash, or control character
+BOOST_JSON_AVX2_TARGET
+inline
+__m256i
+find_special_avx2(__m256i v) noexcept
+{
+    __m256i const q1 = _mm256_set1_epi8( '\x22' ); // '"'
+    __m256i const q2 = _mm256_set1_epi8( '\\' );
+    __m256i const q3 = _mm256_set1_epi8( 0x1F );
+
+    __m256i v1 = _mm256_cmpeq_epi8( v, q1 );
+    __m256i v2 = _mm256_cmpeq_epi8( v, q2 );
+    __m256i v3 = _mm256_cmpeq_epi8( _mm256_min_epu8( v, q3 ), v );
+    return _mm256_or_si256( _mm256_or_si256( v1, v2 ), v3 );
+}
+
+// nonzero in every byte which ends or
+// interrupts an invalid utf-8 sequence,
+// given the block that precedes v
+BOOST_JSON_AVX2_TARGET
+inline
+__m256i
+check_utf8_avx2(
+    __m256i v,
+    __m256i prev,
+    unsigned char const* tables) noexcept
+{
+    __m256i const lo = _mm256_set1_epi8( 0x0F );
+    __m256i const t1 = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128( (__m128i const*)tables ) );
+    __m256i const t2 = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128( (__m128i const*)(tables + 16) ) );
+    __m256i const t3 = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128( (__m128i const*)(tables + 32) ) );
+
+    // the last 16 bytes of prev followed
+    // by the first 16 bytes of v
+    __m256i const mid = _mm256_permute2x128_si256( prev, v, 0x21 );
+    __m256i const prev1 = _mm256_alignr_epi8( v, mid, 15 );
+    __m256i const prev2 = _mm256_alignr_epi8( v, mid, 14 );
+    __m256i const prev3 = _mm256_alignr_epi8( v, mid, 13 );
+
+    __m256i e = _mm256_and_si256(
+        _mm256_shuffle_epi8( t1, _mm256_and_si256(
+            _mm256_srli_epi16( prev1, 4 ), lo ) ),
+        _mm256_shuffle_epi8( t2, _mm256_and_si256( prev1, lo ) ) );
+    e = _mm256_and_si256( e,
+        _mm256_shuffle_epi8( t3, _mm256_and_si256(
+            _mm256_srli_epi16( v, 4 ), lo ) ) );
+
+    // the byte after a 3 or 4 byte lead, and
+    // the byte after that for a 4 byte lead,
+    // must be continuations
+    __m256i must23 = _mm256_or_si256(
+        _mm256_subs_epu8( prev2, _mm256_set1_epi8( char(0xE0 - 0x80) ) ),
+        _mm256_subs_epu8( prev3, _mm256_set1_epi8( char(0xF0 - 0x80) ) ) );
+    must23 = _mm256_and_si256( must23, _mm256_set1_epi8( char(0x80) ) );
+    return _mm256_xor_si256( e, must23 );
+}
+
+// nonzero if the block ends with a lead
+// byte whose continuations are in the next
+BOOST_JSON_AVX2_TARGET
+inline
+__m256i
+incomplete_utf8_avx2(__m256i v) noexcept
+{
+    __m256i const m = _mm256_setr_epi8(
+        char(0xFF), char(0xFF), char(0xFF), char(0xFF),
+        char(0xFF), char(0xFF), char(0xFF), char(0xFF),
+        char(0xFF), char(0xFF), char(0xFF), char(0xFF),
+        char(0xFF), char(0xFF), char(0xFF), char(0xFF),
+        char(0xFF), char(0xFF), char(0xFF), char(0xFF),
+        char(0xFF), char(0xFF), char(0xFF), char(0xFF),
+        char(0xFF), char(0xFF), char(0xFF), char(0xFF),
+        char(0xFF), char(0xF0 - 1), char(0xE0 - 1), char(0xC0 - 1));
+    return _mm256_subs_epu8( v, m );
+}
+
+// Validates utf-8 32 bytes at a time. Blocks are
+// checked together with the three bytes before them,
+// so a sequence may straddle two blocks. Anything
+// irregular is left to count_valid_utf8, which
+// resumes at the start of the last sequence.
+BOOST_JSON_AVX2_TARGET
+inline
+const char*
+count_valid_avx2(
+    char const* p,
+    const char* end) noexcept
+{
+    unsigned char const* tables = utf8_nibble_tables();
+    __m256i prev = _mm256_setzero_si256();
+    __m256i incomplete = _mm256_setzero_si256();
+
+    while(end - p >= 32)
+    {
+        __m256i v = _mm256_loadu_si256( (__m256i const*)p );
+        unsigned w = static_cast<unsigned>(
+            _mm256_movemask_epi8( find_special_avx2( v ) ) );
+        unsigned h = static_cast<unsigned>(
+            _mm256_movemask_epi8( v ) );
+        bool const complete =
+            _mm256_testz_si256( incomplete, incomplete ) != 0;
+
+        if( w != 0 )
+        {
+            // the run ends in this block, check
+            // up to and including the special byte
+            unsigned m = w ^ (w - 1);
+            if( (h & m) == 0 && complete )
+                return p + find_first_avx2( w );
+            __m256i e = check_utf8_avx2( v, prev, tables );
+            unsigned bad = ~static_cast<unsigned>( _mm256_movemask_epi8(
+                _mm256_cmpeq_epi8( e, _mm256_setzero_si256() ) ) );
+            if( (bad & m) == 0 )
+                return p + find_first_avx2( w );
+            break;
+        }
+
+        if( h == 0 )
+        {
+            // ascii
+            if( ! complete )
+                break;
+        }
+        else
+        {
+            __m256i e = check_utf8_avx2( v, prev, tables );
+            if( ! _mm256_testz_si256( e, e ) )
+                break;
+            incomplete = incomplete_utf8_avx2( v );
+        }
+
+        prev = v;
+        p += 32;
+    }
+
+    if( ! _mm256_testz_si256( incomplete, incomplete ) )
+    {
+        while( (p[-1] & 0xC0) == 0x80 )
+            --p;
+        --p;
+    }
+
+    return count_valid_utf8( p, end );
+}
+
+} // detail
+BOOST_JSON_NS_END
+
+#endif
@@ -134,6 +134,29 @@
 # endif
 #endif
 
+// AVX2 kernels are compiled for every x86-64 build
+// and selected at runtime, unless the compiler
+// already targets AVX2.
+#if ! defined(BOOST_JSON_NO_AVX2) && \
+    ! defined(BOOST_JSON_USE_AVX2) && \
+    defined(BOOST_JSON_USE_SSE2)
+# if (defined(__x86_64__) && \
+      (defined(__GNUC__) || defined(__clang__))) || \
+     (defined(_M_X64) && defined(_MSC_VER) && \
+      ! defined(__clang__))
+#  define BOOST_JSON_USE_AVX2
+# endif
+#endif
+
+// NEON is part of the AArch64 baseline,
+// so no runtime check is needed.
+#if ! defined(BOOST_JSON_NO_NEON) && \
+    ! defined(BOOST_JSON_USE_NEON)
+# if defined(__aarch64__) || defined(_M_ARM64)
+#  define BOOST_JSON_USE_NEON
+# endif
+#endif
+
 #ifndef BOOST_SYMBOL_VISIBLE
 #define BOOST_SYMBOL_VISIBLE
 #endif
@@ -0,0 +1,285 @@
+//
+// Copyright (c) 2019 Peter Dimov (pdimov at gmail dot com),
+//                    Vinnie Falco (vinnie.falco@gmail.com)
+// Copyright (c) 2020 Krystian Stasiowski (sdkrystian@gmail.com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/boostorg/json
+//
+
+#ifndef BOOST_JSON_DETAIL_NEON_HPP
+#define BOOST_JSON_DETAIL_NEON_HPP
+
+#include <boost/json/detail/config.hpp>
+#include <boost/json/detail/utf8.hpp>
+#include <cstddef>
+#include <cstdint>
+#if defined(_MSC_VER) && ! defined(__clang__)
+# include <arm64_neon.h>
+# include <intrin.h>
+#else
+# include <arm_neon.h>
+#endif
+
+BOOST_JSON_NS_BEGIN
+namespace detail {
+
+// NEON has no movemask, narrowing each 16 bit
+// lane by 4 leaves one nibble per byte instead
+inline
+std::uint64_t
+nibble_mask_neon(uint8x16_t v) noexcept
+{
+    return vget_lane_u64( vreinterpret_u64_u8(
+        vshrn_n_u16( vreinterpretq_u16_u8( v ), 4 ) ), 0 );
+}
+
+inline
+int
+find_first_neon(std::uint64_t m) noexcept
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll( m ) >> 2;
+#else
+    unsigned long index;
+    _BitScanForward64( &index, m );
+    return static_cast<int>(index >> 2);
+#endif
+}
+
+// 0xFF in every byte which is a quote,
+// backslash, or control character
+inline
+uint8x16_t
+find_special_neon(uint8x16_t v) noexcept
+{
+    uint8x16_t v1 = vceqq_u8( v, vdupq_n_u8( '\x22' ) ); // '"'
+    uint8x16_t v2 = vceqq_u8( v, vdupq_n_u8( '\\' ) );
+    uint8x16_t v3 = vcltq_u8( v, vdupq_n_u8( 0x20 ) );
+    return vorrq_u8( vorrq_u8( v1, v2 ), v3 );
+}
+
+// nonzero in every byte which ends or
+// interrupts an invalid utf-8 sequence,
+// given the block that precedes v
+inline
+uint8x16_t
+check_utf8_neon(
+    uint8x16_t v,
+    uint8x16_t prev,
+    uint8x16_t t1,
+    uint8x16_t t2,
+    uint8x16_t t3) noexcept
+{
+    uint8x16_t const prev1 = vextq_u8( prev, v, 15 );
+    uint8x16_t const prev2 = vextq_u8( prev, v, 14 );
+    uint8x16_t const prev3 = vextq_u8( prev, v, 13 );
+
+    uint8x16_t e = vandq_u8(
+        vqtbl1q_u8( t1, vshrq_n_u8( prev1, 4 ) ),
+        vqtbl1q_u8( t2, vandq_u8( prev1, vdupq_n_u8( 0x0F ) ) ) );
+    e = vandq_u8( e, vqtbl1q_u8( t3, vshrq_n_u8( v, 4 ) ) );
+
+    // the byte after a 3 or 4 byte lead, and
+    // the byte after that for a 4 byte lead,
+    // must be continuations
+    uint8x16_t must23 = vorrq_u8(
+        vcgeq_u8( prev2, vdupq_n_u8( 0xE0 ) ),
+        vcgeq_u8( prev3, vdupq_n_u8( 0xF0 ) ) );
+    must23 = vandq_u8( must23, vdupq_n_u8( 0x80 ) );
+    return veorq_u8( e, must23 );
+}
+
+// nonzero if the block ends with a lead
+// byte whose continuations are in the next
+inline
+uint8x16_t
+incomplete_utf8_neon(uint8x16_t v) noexcept
+{
+    static constexpr std::uint8_t m[16] =
+    {
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xF0 - 1, 0xE0 - 1, 0xC0 - 1
+    };
+    return vqsubq_u8( v, vld1q_u8( m ) );
+}
+
+template<bool AllowBadUTF8>
+inline
+const char*
+count_valid_neon(
+    char const* p,
+    const char* end) noexcept
+{
+    while(end - p >= 16)
+    {
+        uint8x16_t v = vld1q_u8( (std::uint8_t const*)p );
+        std::uint64_t w = nibble_mask_neon( find_special_neon( v ) );
+
+        if( w != 0 )
+            return p + find_first_neon( w );
+
+        p += 16;
+    }
+
+    while(p != end)
+    {
+        const unsigned char c = *p;
+        if(c == '\x22' || c == '\\' || c < 0x20)
+            break;
+        ++p;
+    }
+
+    return p;
+}
+
+// Validates utf-8 16 bytes at a time. Blocks are
+// checked together with the three bytes before them,
+// so a sequence may straddle two blocks. Anything
+// irregular is left to count_valid_utf8, which
+// resumes at the start of the last sequence.
+template<>
+inline
+const char*
+count_valid_neon<false>(
+    char const* p,
+    const char* end) noexcept
+{
+    unsigned char const* tables = utf8_nibble_tables();
+    uint8x16_t const t1 = vld1q_u8( tables );
+    uint8x16_t const t2 = vld1q_u8( tables + 16 );
+    uint8x16_t const t3 = vld1q_u8( tables + 32 );
+    uint8x16_t prev = vdupq_n_u8( 0 );
+    uint8x16_t incomplete = vdupq_n_u8( 0 );
+
+    while(end - p >= 16)
+    {
+        uint8x16_t v = vld1q_u8( (std::uint8_t const*)p );
+        std::uint64_t w = nibble_mask_neon( find_special_neon( v ) );
+        std::uint64_t h = nibble_mask_neon(
+            vcgeq_u8( v, vdupq_n_u8( 0x80 ) ) );
+        bool const complete = vmaxvq_u8( incomplete ) == 0;
+
+        if( w != 0 )
+        {
+            // the run ends in this block, check
+            // up to and including the special byte
+            std::uint64_t m = w ^ (w - 1);
+            if( (h & m) == 0 && complete )
+                return p + find_first_neon( w );
+            uint8x16_t e = check_utf8_neon( v, prev, t1, t2, t3 );
+            std::uint64_t bad = nibble_mask_neon( vtstq_u8( e, e ) );
+            if( (bad & m) == 0 )
+                return p + find_first_neon( w );
+            break;
+        }
+
+        if( h == 0 )
+        {
+            // ascii
+            if( ! complete )
+                break;
+        }
+        else
+        {
+            uint8x16_t e = check_utf8_neon( v, prev, t1, t2, t3 );
+            if( vmaxvq_u8( e ) != 0 )
+                break;
+            incomplete = incomplete_utf8_neon( v );
+        }
+
+        prev = v;
+        p += 16;
+    }
+
+    if( vmaxvq_u8( incomplete ) != 0 )
+    {
+        while( (p[-1] & 0xC0) == 0x80 )
+            --p;
+        --p;
+    }
+
+    return count_valid_utf8( p, end );
+}
+
+inline
+size_t
+count_unescaped_neon(
+    char const* s,
+    size_t n) noexcept
+{
+    char const * s0 = s;
+
+    while( n >= 16 )
+    {
+        uint8x16_t v = vld1q_u8( (std::uint8_t const*)s );
+        std::uint64_t w = nibble_mask_neon( find_special_neon( v ) );
+
+        if( w != 0 )
+            return s - s0 + find_first_neon( w );
+
+        s += 16;
+        n -= 16;
+    }
+
+    return s - s0;
+}
+
+// assumes p..p+15 are valid
+inline
+int
+count_digits_neon( char const* p ) noexcept
+{
+    uint8x16_t v = vld1q_u8( (std::uint8_t const*)p );
+    v = vsubq_u8( v, vdupq_n_u8( '0' ) );
+    std::uint64_t m = nibble_mask_neon(
+        vcgtq_u8( v, vdupq_n_u8( 9 ) ) );
+
+    if( m == 0 )
+        return 16;
+    return find_first_neon( m );
+}
+
+inline
+const char*
+count_whitespace_neon(
+    char const* p,
+    const char* end) noexcept
+{
+    uint8x16_t const q1 = vdupq_n_u8( ' ' );
+    uint8x16_t const q2 = vdupq_n_u8( '\n' );
+    uint8x16_t const q3 = vdupq_n_u8( 4 ); // '\t' | 4 == '\r'
+    uint8x16_t const q4 = vdupq_n_u8( '\r' );
+
+    while( end - p >= 16 )
+    {
+        uint8x16_t v0 = vld1q_u8( (std::uint8_t const*)p );
+
+        uint8x16_t w0 = vorrq_u8(
+            vceqq_u8( v0, q1 ),
+            vceqq_u8( v0, q2 ));
+        uint8x16_t w1 = vceqq_u8( vorrq_u8( v0, q3 ), q4 );
+
+        std::uint64_t m = ~nibble_mask_neon( vorrq_u8( w0, w1 ) );
+
+        if( m != 0 )
+            return p + find_first_neon( m );
+
+        p += 16;
+    }
+
+    for(; p != end; ++p)
+    {
+        char const c = *p;
+        if( c != ' ' && c != '\n' && c != '\r' && c != '\t' ) break;
+    }
+
+    return p;
+}
+
+} // detail
+BOOST_JSON_NS_END
+
+#endif
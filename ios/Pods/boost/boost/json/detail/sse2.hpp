@@ -23,6 +23,12 @@
 #  include <intrin.h>
 # endif
 #endif
+#ifdef BOOST_JSON_USE_AVX2
+# include <boost/json/detail/avx2.hpp>
+#endif
+#ifdef BOOST_JSON_USE_NEON
+# include <boost/json/detail/neon.hpp>
+#endif
 
 BOOST_JSON_NS_BEGIN
 namespace detail {
@@ -114,33 +120,30 @@ count_valid<false>(
             m = index;
 #endif
             p += m;
+#ifdef BOOST_JSON_USE_AVX2
+            // non-ascii, validate 32 bytes at a time
+            if((*p & 0x80) && cpu_has_avx2())
+                return count_valid_avx2(p, end);
+#endif
             break;
         }
 
         p += 16;
     }
 
-    while(p != end)
-    {
-        const unsigned char c = *p;
-        if(c == '\x22' || c == '\\' || c < 0x20)
-            break;
-        if(c < 0x80)
-        {
-            ++p;
-            continue;
-        }
-        // validate utf-8
-        uint16_t first = classify_utf8(c & 0x7F);
-        uint8_t len = first & 0xFF;
-        if(BOOST_JSON_UNLIKELY(end - p < len))
-            break;
-        if(BOOST_JSON_UNLIKELY(! is_valid_utf8(p, first)))
-            break;
-        p += len;
-    }
+    return count_valid_utf8(p, end);
+}
 
-    return p;
+#elif defined(BOOST_JSON_USE_NEON)
+
+template<bool AllowBadUTF8>
+inline
+const char*
+count_valid(
+    char const* p,
+    const char* end) noexcept
+{
+    return count_valid_neon<AllowBadUTF8>(p, end);
 }
 
 #else
@@ -169,27 +172,7 @@ count_valid<false>(
     char const* p,
     char const* end) noexcept
 {
-    while(p != end)
-    {
-        const unsigned char c = *p;
-        if(c == '\x22' || c == '\\' || c < 0x20)
-            break;
-        if(c < 0x80)
-        {
-            ++p;
-            continue;
-        }
-        // validate utf-8
-        uint16_t first = classify_utf8(c & 0x7F);
-        uint8_t len = first & 0xFF;
-        if(BOOST_JSON_UNLIKELY(end - p < len))
-            break;
-        if(BOOST_JSON_UNLIKELY(! is_valid_utf8(p, first)))
-            break;
-        p += len;
-    }
-
-    return p;
+    return count_valid_utf8(p, end);
 }
 
 #endif
@@ -246,6 +229,17 @@ count_unescaped(
     return s - s0;
 }
 
+#elif defined(BOOST_JSON_USE_NEON)
+
+inline
+size_t
+count_unescaped(
+    char const* s,
+    size_t n) noexcept
+{
+    return count_unescaped_neon(s, n);
+}
+
 #else
 
 inline
@@ -292,6 +286,14 @@ inline int count_digits( char const* p ) noexcept
     return n;
 }
 
+#elif defined(BOOST_JSON_USE_NEON)
+
+// assumes p..p+15 are valid
+inline int count_digits( char const* p ) noexcept
+{
+    return count_digits_neon( p );
+}
+
 #else
 
 // assumes p..p+15 are valid
@@ -525,6 +527,23 @@ inline std::size_t count_whitespace( char const * p, std::size_t n ) noexcept
 }
 */
 
+#elif defined(BOOST_JSON_USE_NEON)
+
+inline const char* count_whitespace( char const* p, const char* end ) noexcept
+{
+    if( p == end )
+    {
+        return p;
+    }
+
+    if( static_cast<unsigned char>( *p ) > 0x20 )
+    {
+        return p;
+    }
+
+    return count_whitespace_neon( p, end );
+}
+
 #else
 
 inline const char* count_whitespace( char const* p, const char* end ) noexcept
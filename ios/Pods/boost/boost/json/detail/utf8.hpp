@@ -116,6 +116,117 @@ is_valid_utf8(const char* p, uint16_t first)
     }
 }
 
+// Returns the first quote, backslash, control
+// character, or invalid or truncated utf-8
+// sequence in [p, end).
+inline
+const char*
+count_valid_utf8(
+    const char* p,
+    const char* end) noexcept
+{
+    while(p != end)
+    {
+        const unsigned char c = *p;
+        if(c == '\x22' || c == '\\' || c < 0x20)
+            break;
+        if(c < 0x80)
+        {
+            ++p;
+            continue;
+        }
+        // validate utf-8
+        uint16_t first = classify_utf8(c & 0x7F);
+        uint8_t len = first & 0xFF;
+        if(BOOST_JSON_UNLIKELY(end - p < len))
+            break;
+        if(BOOST_JSON_UNLIKELY(! is_valid_utf8(p, first)))
+            break;
+        p += len;
+    }
+    return p;
+}
+
+// Tables for the vectorized validators, from
+// Keiser and Lemire, "Validating UTF-8 In Less
+// Than One Instruction Per Byte" (2021).
+//
+// Each byte is looked up three times: by the
+// high and low nibble of the byte before it,
+// and by its own high nibble. Every bit names
+// one kind of error, and the pair is invalid
+// when all three lookups have that bit set.
+// Missing third and fourth continuation bytes
+// are checked separately, through bit 0x80.
+//
+// [ 0, 16) high nibble of the previous byte
+// [16, 32) low nibble of the previous byte
+// [32, 48) high nibble of the current byte
+inline
+const unsigned char*
+utf8_nibble_tables() noexcept
+{
+    enum : unsigned char
+    {
+        too_short   = 1 << 0, // 11______ 0_______
+                              // 11______ 11______
+        too_long    = 1 << 1, // 0_______ 10______
+        overlong_3  = 1 << 2, // 11100000 100_____
+        too_large   = 1 << 3, // 11110100 1001____
+                              // 11110100 101_____
+                              // 111101__ 1001____ (and above)
+        surrogate   = 1 << 4, // 11101101 101_____
+        overlong_2  = 1 << 5, // 1100000_ 10______
+        too_large_1000 = 1 << 6, // 11110101 1000____ (and above)
+        overlong_4  = 1 << 6, // 11110000 1000____
+        two_conts   = 1 << 7, // 10______ 10______
+        carry = too_short | too_long | two_conts
+    };
+    static constexpr unsigned char tables[48] =
+    {
+        // previous byte, high nibble
+        too_long, too_long, too_long, too_long,
+        too_long, too_long, too_long, too_long,
+        two_conts, two_conts, two_conts, two_conts,
+        too_short | overlong_2,
+        too_short,
+        too_short | overlong_3 | surrogate,
+        too_short | too_large | too_large_1000 | overlong_4,
+
+        // previous byte, low nibble
+        carry | overlong_3 | overlong_2 | overlong_4,
+        carry | overlong_2,
+        carry,
+        carry,
+        carry | too_large,
+        carry | too_large | too_large_1000,
+        carry | too_large | too_large_1000,
+        carry | too_large | too_large_1000,
+        carry | too_large | too_large_1000,
+        carry | too_large | too_large_1000,
+        carry | too_large | too_large_1000,
+        carry | too_large | too_large_1000,
+        carry | too_large | too_large_1000,
+        carry | too_large | too_large_1000 | surrogate,
+        carry | too_large | too_large_1000,
+        carry | too_large | too_large_1000,
+
+        // current byte, high nibble
+        too_short, too_short, too_short, too_short,
+        too_short, too_short, too_short, too_short,
+        too_long | overlong_2 | two_conts |
+            overlong_3 | too_large_1000 | overlong_4,
+        too_long | overlong_2 | two_conts |
+            overlong_3 | too_large,
+        too_long | overlong_2 | two_conts |
+            surrogate | too_large,
+        too_long | overlong_2 | two_conts |
+            surrogate | too_large,
+        too_short, too_short, too_short, too_short
+    };
+    return tables;
+}
+
 class utf8_sequence
 {
     char seq_[4];
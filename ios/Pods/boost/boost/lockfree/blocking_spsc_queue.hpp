@@ -0,0 +1,328 @@
+//  single-producer/single-consumer ringbuffer with optional blocking operations
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef BOOST_LOCKFREE_BLOCKING_SPSC_QUEUE_HPP_INCLUDED
+#define BOOST_LOCKFREE_BLOCKING_SPSC_QUEUE_HPP_INCLUDED
+
+#include <boost/config.hpp>
+
+#if defined(BOOST_NO_CXX11_HDR_ATOMIC) || defined(BOOST_NO_CXX11_HDR_CHRONO) || defined(BOOST_NO_CXX11_VARIADIC_TEMPLATES)
+#error "boost::lockfree::blocking_spsc_queue requires C++11"
+#endif
+
+#include <chrono>
+
+#include <boost/lockfree/spsc_queue.hpp>
+#include <boost/lockfree/detail/eventcount.hpp>
+#include <boost/lockfree/detail/prefix.hpp>
+
+#ifdef BOOST_HAS_PRAGMA_ONCE
+#pragma once
+#endif
+
+namespace boost    {
+namespace lockfree {
+
+/** The blocking_spsc_queue class is a spsc_queue, whose consumer can wait for an element and whose producer can
+ *  wait for free space.
+ *
+ *  push and pop are the same wait-free operations as the ones of spsc_queue, followed by a check whether the
+ *  other thread is blocked. Only then is a system call made to wake it up, so a queue that is neither empty nor
+ *  full does not cause any system calls. wait_pop and wait_push block only while the queue is empty or full.
+ *  On linux they block on a futex, on other platforms on a condition variable.
+ *
+ *  \b Policies: the same as the ones of \ref boost::lockfree::spsc_queue
+ *
+ *  \b Requirements:
+ *  - the requirements of \ref boost::lockfree::spsc_queue
+ *  - C++11
+ *
+ *  \warning All elements have to be pushed and popped through the blocking_spsc_queue, so that waiting threads are
+ *           woken up.
+ * */
+template <typename T, typename ...Options>
+class blocking_spsc_queue
+{
+private:
+#ifndef BOOST_DOXYGEN_INVOKED
+    typedef spsc_queue<T, Options...> queue_type;
+#endif
+
+public:
+    typedef T value_type;
+    typedef typename queue_type::allocator allocator;
+    typedef typename queue_type::size_type size_type;
+
+    /** Constructs a blocking_spsc_queue
+     *
+     *  \pre blocking_spsc_queue must be configured to be sized at compile-time
+     */
+    blocking_spsc_queue(void)
+    {}
+
+    /** Constructs a blocking_spsc_queue for element_count elements
+     *
+     *  \pre blocking_spsc_queue must be configured to be sized at run-time
+     */
+    explicit blocking_spsc_queue(size_type element_count):
+        queue_(element_count)
+    {}
+
+    /** Constructs a blocking_spsc_queue for element_count elements with a custom allocator
+     *
+     *  \pre blocking_spsc_queue must be configured to be sized at run-time
+     */
+    blocking_spsc_queue(size_type element_count, allocator const & alloc):
+        queue_(element_count, alloc)
+    {}
+
+    /** Pushes object t to the ringbuffer.
+     *
+     * \pre only one thread is allowed to push data to the blocking_spsc_queue
+     * \post object will be pushed to the blocking_spsc_queue, unless it is full.
+     * \return true, if the push operation is successful.
+     *
+     * \note Thread-safe and non-blocking. Wait-free, unless the consumer is waiting in wait_pop.
+     * */
+    bool push(T const & t)
+    {
+        if (!queue_.push(t))
+            return false;
+
+        not_empty_.notify();
+        return true;
+    }
+
+    /** Pushes as many objects from the range [begin, end) as there is space.
+     *
+     * \pre only one thread is allowed to push data to the blocking_spsc_queue
+     * \return iterator to the first element, which has not been pushed
+     *
+     * \note Thread-safe and non-blocking. Wait-free, unless the consumer is waiting in wait_pop.
+     */
+    template <typename ConstIterator>
+    ConstIterator push(ConstIterator begin, ConstIterator end)
+    {
+        ConstIterator ret = queue_.push(begin, end);
+        if (ret != begin)
+            not_empty_.notify();
+        return ret;
+    }
+
+    /** Pushes object t to the ringbuffer, waiting for free space while it is full.
+     *
+     * \pre only one thread is allowed to push data to the blocking_spsc_queue
+     * \post object will be pushed to the blocking_spsc_queue
+     *
+     * \note Thread-safe. Blocks while the blocking_spsc_queue is full.
+     * */
+    void wait_push(T const & t)
+    {
+        while (!push(t)) {
+            detail::eventcount::key_type key = not_full_.prepare_wait();
+            if (push(t)) {
+                not_full_.cancel_wait();
+                return;
+            }
+            not_full_.wait(key);
+        }
+    }
+
+    /** Pushes object t to the ringbuffer, waiting for free space for at most the given time.
+     *
+     * \pre only one thread is allowed to push data to the blocking_spsc_queue
+     * \post object will be pushed to the blocking_spsc_queue, unless it stays full until the timeout.
+     * \return true, if the push operation is successful, false on timeout.
+     *
+     * \note Thread-safe. Blocks while the blocking_spsc_queue is full.
+     * */
+    template <typename Rep, typename Period>
+    bool wait_push(T const & t, std::chrono::duration<Rep, Period> const & timeout)
+    {
+        if (push(t))
+            return true;
+
+        const std::chrono::steady_clock::time_point deadline = make_deadline(timeout);
+        for (;;) {
+            detail::eventcount::key_type key = not_full_.prepare_wait();
+            if (push(t)) {
+                not_full_.cancel_wait();
+                return true;
+            }
+            if (!not_full_.wait_until(key, deadline))
+                return push(t);
+            if (push(t))
+                return true;
+        }
+    }
+
+    /** Pops one object from ringbuffer.
+     *
+     * \pre only one thread is allowed to pop data to the blocking_spsc_queue
+     * \post if ringbuffer is not empty, object will be copied to ret.
+     * \return true, if the pop operation is successful, false if ringbuffer was empty.
+     *
+     * \note Thread-safe and non-blocking. Wait-free, unless the producer is waiting in wait_push.
+     */
+    template <typename U>
+    bool pop(U & ret)
+    {
+        if (!queue_.pop(ret))
+            return false;
+
+        not_full_.notify();
+        return true;
+    }
+
+    /** Pops a maximum of size objects from ringbuffer.
+     *
+     * \pre only one thread is allowed to pop data to the blocking_spsc_queue
+     * \return number of popped items
+     *
+     * \note Thread-safe and non-blocking. Wait-free, unless the producer is waiting in wait_push.
+     * */
+    size_type pop(T * ret, size_type size)
+    {
+        size_type count = queue_.pop(ret, size);
+        if (count)
+            not_full_.notify();
+        return count;
+    }
+
+    /** Pops one object from ringbuffer, waiting for one while it is empty.
+     *
+     * \pre only one thread is allowed to pop data to the blocking_spsc_queue
+     * \post object will be copied to ret.
+     *
+     * \note Thread-safe. Blocks while the blocking_spsc_queue is empty.
+     */
+    template <typename U>
+    void wait_pop(U & ret)
+    {
+        while (!pop(ret)) {
+            detail::eventcount::key_type key = not_empty_.prepare_wait();
+            if (pop(ret)) {
+                not_empty_.cancel_wait();
+                return;
+            }
+            not_empty_.wait(key);
+        }
+    }
+
+    /** Pops one object from ringbuffer, waiting for one for at most the given time.
+     *
+     * \pre only one thread is allowed to pop data to the blocking_spsc_queue
+     * \post if an object is available before the timeout, it will be copied to ret.
+     * \return true, if the pop operation is successful, false on timeout.
+     *
+     * \note Thread-safe. Blocks while the blocking_spsc_queue is empty.
+     */
+    template <typename U, typename Rep, typename Period>
+    bool wait_pop(U & ret, std::chrono::duration<Rep, Period> const & timeout)
+    {
+        if (pop(ret))
+            return true;
+
+        const std::chrono::steady_clock::time_point deadline = make_deadline(timeout);
+        for (;;) {
+            detail::eventcount::key_type key = not_empty_.prepare_wait();
+            if (pop(ret)) {
+                not_empty_.cancel_wait();
+                return true;
+            }
+            if (!not_empty_.wait_until(key, deadline))
+                return pop(ret);
+            if (pop(ret))
+                return true;
+        }
+    }
+
+    /** consumes one element via a functor
+     *
+     *  pops one element from the queue and applies the functor on this object
+     *
+     * \returns true, if one element was consumed
+     *
+     * \note Thread-safe and non-blocking, if functor is thread-safe and non-blocking
+     * */
+    template <typename Functor>
+    bool consume_one(Functor & f)
+    {
+        bool success = queue_.consume_one(f);
+        if (success)
+            not_full_.notify();
+        return success;
+    }
+
+    /// \copydoc boost::lockfree::blocking_spsc_queue::consume_one(Functor & rhs)
+    template <typename Functor>
+    bool consume_one(Functor const & f)
+    {
+        bool success = queue_.consume_one(f);
+        if (success)
+            not_full_.notify();
+        return success;
+    }
+
+    /** consumes all elements via a functor
+     *
+     * sequentially pops all elements from the queue and applies the functor on each object
+     *
+     * \returns number of elements that are consumed
+     *
+     * \note Thread-safe and non-blocking, if functor is thread-safe and non-blocking
+     * */
+    template <typename Functor>
+    size_type consume_all(Functor & f)
+    {
+        size_type count = queue_.consume_all(f);
+        if (count)
+            not_full_.notify();
+        return count;
+    }
+
+    /// \copydoc boost::lockfree::blocking_spsc_queue::consume_all(Functor & rhs)
+    template <typename Functor>
+    size_type consume_all(Functor const & f)
+    {
+        size_type count = queue_.consume_all(f);
+        if (count)
+            not_full_.notify();
+        return count;
+    }
+
+    /// \copydoc boost::lockfree::spsc_queue::read_available() const
+    size_type read_available() const
+    {
+        return queue_.read_available();
+    }
+
+    /// \copydoc boost::lockfree::spsc_queue::write_available() const
+    size_type write_available() const
+    {
+        return queue_.write_available();
+    }
+
+private:
+#ifndef BOOST_DOXYGEN_INVOKED
+    template <typename Rep, typename Period>
+    static std::chrono::steady_clock::time_point make_deadline(std::chrono::duration<Rep, Period> const & timeout)
+    {
+        return std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(timeout);
+    }
+
+    queue_type queue_;
+    /* not_empty_ is checked by the producer and not_full_ by the consumer after every operation */
+    detail::eventcount not_empty_;
+    char padding1[BOOST_LOCKFREE_CACHELINE_BYTES];
+    detail::eventcount not_full_;
+#endif
+};
+
+} /* namespace lockfree */
+} /* namespace boost */
+
+#endif /* BOOST_LOCKFREE_BLOCKING_SPSC_QUEUE_HPP_INCLUDED */
@@ -0,0 +1,173 @@
+//  eventcount: lets a thread block until another thread changes some lock-free state,
+//  without making the thread that changes it pay for a system call while nobody waits.
+//
+//  Distributed under the Boost Software License, Version 1.0. (See
+//  accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef BOOST_LOCKFREE_DETAIL_EVENTCOUNT_HPP_INCLUDED
+#define BOOST_LOCKFREE_DETAIL_EVENTCOUNT_HPP_INCLUDED
+
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+
+#include <boost/config.hpp>
+#include <boost/static_assert.hpp>
+
+#if defined(__linux__)
+#define BOOST_LOCKFREE_EVENTCOUNT_FUTEX
+#include <ctime>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#else
+#include <condition_variable>
+#include <mutex>
+#endif
+
+#ifdef BOOST_HAS_PRAGMA_ONCE
+#pragma once
+#endif
+
+namespace boost    {
+namespace lockfree {
+namespace detail   {
+
+/* usage, with `ready()` being a check of the lock-free state:
+ *
+ *     while (!ready()) {
+ *         eventcount::key_type key = ec.prepare_wait();
+ *         if (ready()) {
+ *             ec.cancel_wait();
+ *             break;
+ *         }
+ *         ec.wait(key);
+ *     }
+ *
+ * the thread making ready() true calls notify() afterwards. notify() only issues a system call if some thread
+ * is between prepare_wait() and the end of wait(), which is what keeps the fast path of a busy queue free of them.
+ *
+ * prepare_wait() and notify() both issue a sequentially consistent fence between their own update and their
+ * load of the other side's state, so either the waiter sees the change in its second check or notify() sees
+ * the waiter.
+ * */
+class eventcount
+{
+public:
+    typedef std::uint32_t key_type;
+
+    eventcount(void):
+        epoch_(0), waiters_(0)
+    {}
+
+    key_type prepare_wait(void)
+    {
+        waiters_.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        /* acquire pairs with the release increment in wake(), like the loads in wait() */
+        return epoch_.load(std::memory_order_acquire);
+    }
+
+    void cancel_wait(void)
+    {
+        waiters_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    /* blocks until notify() is called after the prepare_wait() that returned key */
+    void wait(key_type key)
+    {
+        while (epoch_.load(std::memory_order_acquire) == key)
+            park(key, NULL);
+        cancel_wait();
+    }
+
+    /* like wait(), but gives up at the deadline. returns false if it gave up */
+    bool wait_until(key_type key, std::chrono::steady_clock::time_point const & deadline)
+    {
+        while (epoch_.load(std::memory_order_acquire) == key) {
+            std::chrono::steady_clock::duration remaining = deadline - std::chrono::steady_clock::now();
+            if (remaining <= std::chrono::steady_clock::duration::zero()) {
+                cancel_wait();
+                return false;
+            }
+            park(key, &remaining);
+        }
+        cancel_wait();
+        return true;
+    }
+
+    /* wakes all waiting threads */
+    void notify(void)
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (BOOST_LIKELY(waiters_.load(std::memory_order_relaxed) == 0))
+            return;
+
+        wake();
+    }
+
+private:
+#ifdef BOOST_LOCKFREE_EVENTCOUNT_FUTEX
+    void park(key_type key, std::chrono::steady_clock::duration const * timeout)
+    {
+        /* FUTEX_WAIT measures relative timeouts with CLOCK_MONOTONIC, like steady_clock */
+        struct timespec ts;
+        struct timespec * ts_ptr = NULL;
+        if (timeout) {
+            std::chrono::nanoseconds ns = std::chrono::duration_cast<std::chrono::nanoseconds>(*timeout);
+            ts.tv_sec = static_cast<std::time_t>(ns.count() / 1000000000);
+            ts.tv_nsec = static_cast<long>(ns.count() % 1000000000);
+            ts_ptr = &ts;
+        }
+        /* EAGAIN (the epoch has already moved on), EINTR and ETIMEDOUT are all handled by the caller's loop */
+        ::syscall(SYS_futex, futex_word(), FUTEX_WAIT_PRIVATE, key, ts_ptr, NULL, 0);
+    }
+
+    void wake(void)
+    {
+        epoch_.fetch_add(1, std::memory_order_release);
+        ::syscall(SYS_futex, futex_word(), FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+    }
+
+    key_type * futex_word(void)
+    {
+        BOOST_STATIC_ASSERT(sizeof(std::atomic<key_type>) == sizeof(key_type));
+        return reinterpret_cast<key_type *>(&epoch_);
+    }
+#else
+    void park(key_type key, std::chrono::steady_clock::duration const * timeout)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (epoch_.load(std::memory_order_relaxed) != key)
+            return;
+        if (timeout)
+            cond_.wait_for(lock, *timeout);
+        else
+            cond_.wait(lock);
+    }
+
+    void wake(void)
+    {
+        {
+            /* the mutex orders the increment with the epoch check in park() */
+            std::lock_guard<std::mutex> lock(mutex_);
+            epoch_.fetch_add(1, std::memory_order_release);
+        }
+        cond_.notify_all();
+    }
+
+    std::mutex mutex_;
+    std::condition_variable cond_;
+#endif
+
+    std::atomic<key_type> epoch_;
+    std::atomic<key_type> waiters_;
+};
+
+} /* namespace detail */
+} /* namespace lockfree */
+} /* namespace boost */
+
+#endif /* BOOST_LOCKFREE_DETAIL_EVENTCOUNT_HPP_INCLUDED */
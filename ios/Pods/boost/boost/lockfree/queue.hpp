@@ -14,6 +14,8 @@
 #include <boost/assert.hpp>
 #include <boost/static_assert.hpp>
 #include <boost/core/allocator_access.hpp>
+#include <boost/core/no_exceptions_support.hpp>
+#include <boost/tuple/tuple.hpp>
 #include <boost/type_traits/has_trivial_assign.hpp>
 #include <boost/type_traits/has_trivial_destructor.hpp>
 #include <boost/config.hpp> // for BOOST_LIKELY & BOOST_ALIGNMENT
@@ -324,11 +326,38 @@ private:
     bool do_push(T const & t)
     {
         node * n = pool.template construct<true, Bounded>(t, pool.null_handle());
-        handle_type node_handle = pool.get_handle(n);
 
         if (n == NULL)
             return false;
 
+        link_nodes_atomic(n, n);
+        return true;
+    }
+
+    template <bool Bounded, typename ConstIterator>
+    ConstIterator do_push(ConstIterator begin, ConstIterator end)
+    {
+        node * first_node;
+        node * last_node;
+        ConstIterator ret;
+
+        tie(first_node, last_node) = prepare_node_list<true, Bounded>(begin, end, ret);
+        if (first_node)
+            link_nodes_atomic(first_node, last_node);
+
+        return ret;
+    }
+
+    /* appends the chain [first_node, last_node], which is already linked via the next pointers.
+     * the chain is published by a single compare-and-exchange on the next pointer of the last node.
+     * tail_ is then moved to last_node. if that fails, other threads advance it node by node, just
+     * as they do when a single push is interrupted before updating tail_.
+     * */
+    void link_nodes_atomic(node * first_node, node * last_node)
+    {
+        handle_type first_handle = pool.get_handle(first_node);
+        handle_type last_handle = pool.get_handle(last_node);
+
         for (;;) {
             tagged_node_handle tail = tail_.load(memory_order_acquire);
             node * tail_node = pool.get_pointer(tail);
@@ -338,11 +367,11 @@ private:
             tagged_node_handle tail2 = tail_.load(memory_order_acquire);
             if (BOOST_LIKELY(tail == tail2)) {
                 if (next_ptr == 0) {
-                    tagged_node_handle new_tail_next(node_handle, next.get_next_tag());
+                    tagged_node_handle new_tail_next(first_handle, next.get_next_tag());
                     if ( tail_node->next.compare_exchange_weak(next, new_tail_next) ) {
-                        tagged_node_handle new_tail(node_handle, tail.get_next_tag());
+                        tagged_node_handle new_tail(last_handle, tail.get_next_tag());
                         tail_.compare_exchange_strong(tail, new_tail);
-                        return true;
+                        return;
                     }
                 }
                 else {
@@ -352,9 +381,99 @@ private:
             }
         }
     }
+
+    void link_nodes_unsafe(node * first_node, node * last_node)
+    {
+        for (;;) {
+            tagged_node_handle tail = tail_.load(memory_order_relaxed);
+            node * tail_node = pool.get_pointer(tail);
+            tagged_node_handle next = tail_node->next.load(memory_order_relaxed);
+            node * next_ptr = pool.get_pointer(next);
+
+            if (next_ptr == 0) {
+                tail_node->next.store(tagged_node_handle(pool.get_handle(first_node), next.get_next_tag()), memory_order_relaxed);
+                tail_.store(tagged_node_handle(pool.get_handle(last_node), tail.get_next_tag()), memory_order_relaxed);
+                return;
+            }
+            else
+                tail_.store(tagged_node_handle(pool.get_handle(next_ptr), tail.get_next_tag()), memory_order_relaxed);
+        }
+    }
+
+    /* allocates nodes for as many elements of [begin, end) as possible and links them in order.
+     * returns the first and the last node, or NULL if no node could be allocated.
+     * */
+    template <bool Threadsafe, bool Bounded, typename ConstIterator>
+    tuple<node*, node*> prepare_node_list(ConstIterator begin, ConstIterator end, ConstIterator & ret)
+    {
+        ConstIterator it = begin;
+        node * first_node = NULL;
+        if (it != end)
+            first_node = pool.template construct<Threadsafe, Bounded>(*it, pool.null_handle());
+        if (first_node == NULL) {
+            ret = begin;
+            return make_tuple<node*, node*>(NULL, NULL);
+        }
+        ++it;
+
+        node * last_node = first_node;
+
+        BOOST_TRY {
+            for (; it != end; ++it) {
+                node * newnode = pool.template construct<Threadsafe, Bounded>(*it, pool.null_handle());
+                if (newnode == NULL)
+                    break;
+                /* the chain is not visible to other threads before it is linked */
+                tagged_node_handle old_next = last_node->next.load(memory_order_relaxed);
+                last_node->next.store(tagged_node_handle(pool.get_handle(newnode), old_next.get_tag()), memory_order_relaxed);
+                last_node = newnode;
+            }
+        } BOOST_CATCH (...) {
+            for (node * current_node = first_node; current_node != last_node;) {
+                node * next = pool.get_pointer(current_node->next.load(memory_order_relaxed));
+                pool.template destruct<Threadsafe>(current_node);
+                current_node = next;
+            }
+            pool.template destruct<Threadsafe>(last_node);
+            BOOST_RETHROW;
+        }
+        BOOST_CATCH_END
+
+        ret = it;
+        return make_tuple(first_node, last_node);
+    }
 #endif
 
 public:
+    /** Pushes as many objects from the range [begin, end) as freelist node can be allocated.
+     *
+     * \return iterator to the first element, which has not been pushed
+     *
+     * \note Operation is applied atomically: the elements are linked into the queue with a single compare-and-exchange,
+     *       and are consumed in the order of the range, without elements of other threads in between.
+     * \note Thread-safe. If internal memory pool is exhausted and the memory pool is not fixed-sized, a new node will be allocated
+     *       from the OS. This may not be lock-free.
+     * \throws if memory allocator throws
+     */
+    template <typename ConstIterator>
+    ConstIterator push(ConstIterator begin, ConstIterator end)
+    {
+        return do_push<false, ConstIterator>(begin, end);
+    }
+
+    /** Pushes as many objects from the range [begin, end) as freelist node can be allocated.
+     *
+     * \return iterator to the first element, which has not been pushed
+     *
+     * \note Operation is applied atomically
+     * \note Thread-safe and non-blocking. If internal memory pool is exhausted, the push operation will fail
+     * \throws if memory allocator throws
+     */
+    template <typename ConstIterator>
+    ConstIterator bounded_push(ConstIterator begin, ConstIterator end)
+    {
+        return do_push<true, ConstIterator>(begin, end);
+    }
 
     /** Pushes object t to the queue.
      *
@@ -387,6 +506,28 @@ public:
         }
     }
 
+    /** Pushes as many objects from the range [begin, end) as freelist node can be allocated.
+     *
+     * \return iterator to the first element, which has not been pushed
+     *
+     * \note Not thread-safe. If internal memory pool is exhausted and the memory pool is not fixed-sized, a new node will be allocated
+     *       from the OS. This may not be lock-free.
+     * \throws if memory allocator throws
+     */
+    template <typename ConstIterator>
+    ConstIterator unsynchronized_push(ConstIterator begin, ConstIterator end)
+    {
+        node * first_node;
+        node * last_node;
+        ConstIterator ret;
+
+        tie(first_node, last_node) = prepare_node_list<false, false>(begin, end, ret);
+        if (first_node)
+            link_nodes_unsafe(first_node, last_node);
+
+        return ret;
+    }
+
     /** Pops object from queue.
      *
      * \post if pop operation is successful, object will be copied to ret.
@@ -562,8 +703,100 @@ public:
         return element_count;
     }
 
+    /** consumes all elements via a functor
+     *
+     * detaches all elements up to the tail of the queue with a single compare-and-exchange of the head and applies the
+     * functor on each of them, in order. this is repeated until the queue is found empty.
+     *
+     * \returns number of elements that are consumed
+     *
+     * \note Thread-safe and non-blocking, if functor is thread-safe and non-blocking. The elements of one batch are
+     *       consumed by one thread, so the functor is not called concurrently on elements of the same batch.
+     * \throws if the functor throws. The remaining elements of the batch are discarded.
+     * */
+    template <typename Functor>
+    size_t consume_all_batch(Functor & f)
+    {
+        return do_consume_all_batch(f);
+    }
+
+    /// \copydoc boost::lockfree::queue::consume_all_batch(Functor & rhs)
+    template <typename Functor>
+    size_t consume_all_batch(Functor const & f)
+    {
+        return do_consume_all_batch(f);
+    }
+
 private:
 #ifndef BOOST_DOXYGEN_INVOKED
+    template <typename Functor>
+    size_t do_consume_all_batch(Functor & f)
+    {
+        size_t element_count = 0;
+        for (;;) {
+            tagged_node_handle head = head_.load(memory_order_acquire);
+            node * head_ptr = pool.get_pointer(head);
+
+            tagged_node_handle tail = tail_.load(memory_order_acquire);
+            node * tail_ptr = pool.get_pointer(tail);
+            tagged_node_handle next = head_ptr->next.load(memory_order_acquire);
+            node * next_ptr = pool.get_pointer(next);
+
+            tagged_node_handle head2 = head_.load(memory_order_acquire);
+            if (BOOST_UNLIKELY(head != head2))
+                continue;
+
+            if (pool.get_handle(head) == pool.get_handle(tail)) {
+                if (next_ptr == 0)
+                    return element_count;
+
+                tagged_node_handle new_tail(pool.get_handle(next), tail.get_next_tag());
+                tail_.compare_exchange_strong(tail, new_tail);
+                continue;
+            }
+
+            if (next_ptr == 0)
+                /* see pop: a node reused from the freelist may have a cleared next pointer */
+                continue;
+
+            /* the tail node becomes the new dummy node, so its payload has to be copied before
+             * the head is moved, like in pop. the payload of the other nodes is owned by this
+             * thread once the head is moved past them. */
+            T last_element;
+            detail::copy_payload(tail_ptr->data, last_element);
+
+            tagged_node_handle new_head(pool.get_handle(tail), head.get_next_tag());
+            if (!head_.compare_exchange_weak(head, new_head))
+                continue;
+
+            node * current_node = head_ptr;
+            node * next_node = NULL;
+            BOOST_TRY {
+                for (;;) {
+                    next_node = pool.get_pointer(current_node->next.load(memory_order_acquire));
+                    pool.template destruct<true>(current_node);
+                    element_count += 1;
+                    if (next_node == tail_ptr) {
+                        f(last_element);
+                        break;
+                    }
+                    f(next_node->data);
+                    current_node = next_node;
+                }
+            } BOOST_CATCH (...) {
+                /* the batch is detached from the queue, so its remaining elements cannot be put back. next_node
+                 * holds the element the functor threw on, the nodes after it up to the tail are not consumed yet. */
+                while (next_node != tail_ptr) {
+                    node * following = pool.get_pointer(next_node->next.load(memory_order_acquire));
+                    pool.template destruct<true>(next_node);
+                    next_node = following;
+                }
+                BOOST_RETHROW;
+            }
+            BOOST_CATCH_END
+        }
+    }
+
     atomic<tagged_node_handle> head_;
     static const int padding_size = BOOST_LOCKFREE_CACHELINE_BYTES - sizeof(tagged_node_handle);
     char padding1[padding_size];
@@ -0,0 +1,215 @@
+// ----------------------------------------------------------------------------
+// Copyright (C) 2002-2006 Marcin Kalicinski
+// Copyright (C) 2009 Sebastian Redl
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//
+// For more information, see www.boost.org
+// ----------------------------------------------------------------------------
+
+#ifndef BOOST_PROPERTY_TREE_COMPACT_PTREE_HPP_INCLUDED
+#define BOOST_PROPERTY_TREE_COMPACT_PTREE_HPP_INCLUDED
+
+#include <boost/property_tree/ptree.hpp>
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/iterator/iterator_facade.hpp>
+#include <boost/utility/string_view.hpp>
+#include <boost/cstdint.hpp>
+#include <iosfwd>
+#include <string>
+
+namespace boost { namespace property_tree
+{
+
+    namespace detail {
+        struct compact_ptree_header;
+        struct compact_ptree_node;
+    }
+
+    /**
+     * Read-only view of a property tree in the compact format written by
+     * write_compact(). The format is a flat array of nodes, with the
+     * children of every node stored next to each other, followed by a
+     * table of all key and data strings. It can be used in place, e.g.
+     * from a memory-mapped file, so looking up a few values does not
+     * require parsing the whole tree first.
+     *
+     * A view does not own the memory it refers to. Copying a view is cheap
+     * and yields another view of the same node.
+     *
+     * Lookups by key use binary search. Like basic_ptree::find, a key that
+     * occurs more than once among the children of a node finds the first
+     * of them, in document order.
+     */
+    template<class Ch>
+    class basic_compact_ptree
+    {
+#if defined(BOOST_PROPERTY_TREE_DOXYGEN_INVOKED)
+    public:
+#endif
+        typedef basic_compact_ptree<Ch> self_type;
+
+    public:
+        typedef Ch                                      char_type;
+        typedef std::basic_string<Ch>                   key_type;
+        typedef std::basic_string<Ch>                   data_type;
+        typedef boost::basic_string_view<Ch>            string_view_type;
+        typedef std::size_t                             size_type;
+        typedef typename path_of<key_type>::type        path_type;
+
+        class const_iterator;
+        typedef const_iterator                          iterator;
+
+        /**
+         * Creates a view of the root of the compact tree in the given buffer.
+         * @pre @e data is aligned for a 32-bit integer, and stays valid and
+         *      unchanged for as long as the view, or any view obtained from
+         *      it, is in use.
+         * @throw ptree_error If the buffer does not start with a compact tree
+         *                    written for this character type and byte order.
+         */
+        basic_compact_ptree(const void *data, size_type size);
+
+        /** The key of this node. Empty for the root. */
+        string_view_type key() const;
+        /** The data of this node. */
+        string_view_type data() const;
+
+        /** The number of direct children of this node. */
+        size_type size() const;
+        /** Whether there are any direct children. */
+        bool empty() const;
+
+        /** Iteration over the direct children, in document order. */
+        const_iterator begin() const;
+        const_iterator end() const;
+
+        /** Count the number of direct children with the given key. */
+        size_type count(const key_type &key) const;
+
+        /** Get the child at the given path, or throw @c ptree_bad_path. */
+        self_type get_child(const path_type &path) const;
+
+        /** Get the child at the given path, or return boost::null. */
+        optional<self_type> get_child_optional(const path_type &path) const;
+
+        /** Take the value of this node and attempt to translate it to a
+         * @c Type object using the default translator.
+         * @throw ptree_bad_data if the conversion fails.
+         */
+        template<class Type>
+        Type get_value() const;
+
+        /** Take the value of this node and attempt to translate it to a
+         * @c Type object using the default translator. Return boost::null if
+         * this fails.
+         */
+        template<class Type>
+        optional<Type> get_value_optional() const;
+
+        /** Shorthand for get_child(path).get_value<Type>(). */
+        template<class Type>
+        Type get(const path_type &path) const;
+
+        /** Shorthand for get_optional(path).get_value_or(default_value). */
+        template<class Type>
+        Type get(const path_type &path, const Type &default_value) const;
+
+        /** Make get do the right thing for string literals. */
+        template <class Ch2>
+        typename boost::enable_if<
+            detail::is_character<Ch2>,
+            std::basic_string<Ch2>
+        >::type
+        get(const path_type &path, const Ch2 *default_value) const;
+
+        /** Get the translated value of the child at the given path, or
+         * boost::null if the path does not exist or the conversion fails.
+         */
+        template<class Type>
+        optional<Type> get_optional(const path_type &path) const;
+
+    private:
+        basic_compact_ptree(const detail::compact_ptree_header *header,
+                            boost::uint32_t index);
+
+        const detail::compact_ptree_node *node_at(
+            boost::uint32_t index) const;
+        boost::uint32_t index_of(const detail::compact_ptree_node *n) const;
+        string_view_type string_at(boost::uint32_t offset,
+                                   boost::uint32_t size) const;
+        const boost::uint32_t *lower_bound(
+            const detail::compact_ptree_node *parent,
+            const key_type &key) const;
+        const detail::compact_ptree_node *find(
+            const detail::compact_ptree_node *parent,
+            const key_type &key) const;
+        const detail::compact_ptree_node *walk_path(path_type &p) const;
+
+        const detail::compact_ptree_header *m_header;
+        const detail::compact_ptree_node *m_node;
+    };
+
+    /**
+     * Owns a read-only memory mapping of a file written by write_compact()
+     * and gives access to the tree in it. Pages of the file are only read
+     * from disk as the lookups touch them.
+     */
+    template<class Ch>
+    class basic_compact_ptree_file
+    {
+    public:
+        /**
+         * Map the given file.
+         * @throw ptree_error If the file cannot be mapped, or does not hold
+         *                    a compact tree for this character type.
+         */
+        explicit basic_compact_ptree_file(const std::string &filename);
+
+        /** The root of the tree in the file. */
+        const basic_compact_ptree<Ch> &root() const;
+
+    private:
+        basic_compact_ptree_file(const basic_compact_ptree_file &);
+        basic_compact_ptree_file &operator =(const basic_compact_ptree_file &);
+
+        basic_compact_ptree<Ch> open(const std::string &filename);
+
+        interprocess::file_mapping m_mapping;
+        interprocess::mapped_region m_region;
+        basic_compact_ptree<Ch> m_root;
+    };
+
+    typedef basic_compact_ptree<char> compact_ptree;
+    typedef basic_compact_ptree<wchar_t> wcompact_ptree;
+    typedef basic_compact_ptree_file<char> compact_ptree_file;
+    typedef basic_compact_ptree_file<wchar_t> wcompact_ptree_file;
+
+    /**
+     * Write the property tree to the given stream in the compact format read
+     * by basic_compact_ptree. Equal strings are stored once.
+     * @note The format uses the byte order and character size of the writing
+     *       machine. Trees too large for 32-bit offsets are rejected.
+     * @throw ptree_error If the tree is too large, or writing fails.
+     */
+    template<class Ptree>
+    void write_compact(std::ostream &stream, const Ptree &pt);
+
+    /**
+     * Write the property tree to the given file in the compact format read
+     * by basic_compact_ptree_file.
+     * @throw ptree_error If the tree is too large, or the file cannot be
+     *                    written.
+     */
+    template<class Ptree>
+    void write_compact(const std::string &filename, const Ptree &pt);
+
+}}
+
+#include <boost/property_tree/detail/compact_ptree_implementation.hpp>
+
+#endif
@@ -0,0 +1,582 @@
+// ----------------------------------------------------------------------------
+// Copyright (C) 2002-2006 Marcin Kalicinski
+// Copyright (C) 2009 Sebastian Redl
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//
+// For more information, see www.boost.org
+// ----------------------------------------------------------------------------
+#ifndef BOOST_PROPERTY_TREE_DETAIL_COMPACT_PTREE_IMPLEMENTATION_HPP_INCLUDED
+#define BOOST_PROPERTY_TREE_DETAIL_COMPACT_PTREE_IMPLEMENTATION_HPP_INCLUDED
+
+#include <boost/interprocess/exceptions.hpp>
+#include <boost/unordered_map.hpp>
+#include <algorithm>
+#include <fstream>
+#include <ostream>
+#include <typeinfo>
+#include <vector>
+
+namespace boost { namespace property_tree
+{
+    namespace detail
+    {
+        // File layout, all in the byte order of the writer:
+        //   compact_ptree_header
+        //   compact_ptree_node  nodes[node_count]
+        //   uint32_t            order[node_count]
+        //   Ch                  strings[string_size]
+        // Nodes are stored breadth first, so the children of a node are
+        // nodes[children, children + size). order[children, children + size)
+        // holds the same indices, stably sorted by key, for binary search.
+        // The root is nodes[0].
+        struct compact_ptree_header
+        {
+            boost::uint32_t magic;
+            boost::uint32_t version;
+            boost::uint32_t byte_order;
+            boost::uint32_t char_size;
+            boost::uint32_t node_count;
+            boost::uint32_t string_size;
+        };
+
+        struct compact_ptree_node
+        {
+            boost::uint32_t key;
+            boost::uint32_t key_size;
+            boost::uint32_t data;
+            boost::uint32_t data_size;
+            boost::uint32_t children;
+            boost::uint32_t size;
+        };
+
+        const boost::uint32_t compact_ptree_magic = 0x50544346; // "PTCF"
+        const boost::uint32_t compact_ptree_version = 1;
+        const boost::uint32_t compact_ptree_byte_order = 0x01020304;
+
+        inline const compact_ptree_node *
+        compact_ptree_nodes(const compact_ptree_header *h)
+        {
+            return reinterpret_cast<const compact_ptree_node *>(h + 1);
+        }
+
+        inline const boost::uint32_t *
+        compact_ptree_order(const compact_ptree_header *h)
+        {
+            return reinterpret_cast<const boost::uint32_t *>(
+                compact_ptree_nodes(h) + h->node_count);
+        }
+
+        template<class Ch>
+        const Ch *compact_ptree_strings(const compact_ptree_header *h)
+        {
+            return reinterpret_cast<const Ch *>(
+                compact_ptree_order(h) + h->node_count);
+        }
+
+        template<class Ch>
+        int compare_keys(const Ch *a, std::size_t na,
+                         const Ch *b, std::size_t nb)
+        {
+            int r = std::char_traits<Ch>::compare(a, b, (std::min)(na, nb));
+            if (r != 0)
+                return r;
+            return na < nb ? -1 : (nb < na ? 1 : 0);
+        }
+
+        inline void corrupt_compact_ptree()
+        {
+            BOOST_PROPERTY_TREE_THROW(ptree_error("corrupt compact ptree"));
+        }
+
+        // Lays out a basic_ptree in the compact format.
+        template<class Ptree>
+        class compact_ptree_builder
+        {
+            typedef typename Ptree::key_type string_type;
+            typedef typename string_type::value_type char_type;
+
+        public:
+            explicit compact_ptree_builder(const Ptree &pt)
+            {
+                string_type no_key;
+                m_trees.push_back(&pt);
+                m_keys.push_back(&no_key);
+                m_nodes.resize(1);
+                m_order.push_back(0);
+                // m_trees grows as the loop runs, one level at a time.
+                for (std::size_t i = 0; i < m_trees.size(); ++i) {
+                    const Ptree &t = *m_trees[i];
+                    compact_ptree_node &n = m_nodes[i];
+                    n.key = intern(*m_keys[i], n.key_size);
+                    n.data = intern(t.data(), n.data_size);
+                    n.children = checked(m_trees.size());
+                    n.size = checked(t.size());
+                    for (typename Ptree::const_iterator it = t.begin();
+                         it != t.end(); ++it) {
+                        m_order.push_back(checked(m_trees.size()));
+                        m_trees.push_back(&it->second);
+                        m_keys.push_back(&it->first);
+                    }
+                    m_nodes.resize(m_trees.size());
+                    std::stable_sort(m_order.begin() + m_nodes[i].children,
+                                     m_order.end(), key_less(m_keys));
+                }
+                // The root's key pointer dies with no_key.
+                m_keys.clear();
+                checked(m_strings.size());
+            }
+
+            void write(std::ostream &stream) const
+            {
+                compact_ptree_header h;
+                h.magic = compact_ptree_magic;
+                h.version = compact_ptree_version;
+                h.byte_order = compact_ptree_byte_order;
+                h.char_size = sizeof(char_type);
+                h.node_count = static_cast<boost::uint32_t>(m_nodes.size());
+                h.string_size = static_cast<boost::uint32_t>(m_strings.size());
+                stream.write(reinterpret_cast<const char *>(&h), sizeof(h));
+                stream.write(reinterpret_cast<const char *>(&m_nodes[0]),
+                    m_nodes.size() * sizeof(compact_ptree_node));
+                stream.write(reinterpret_cast<const char *>(&m_order[0]),
+                    m_order.size() * sizeof(boost::uint32_t));
+                if (!m_strings.empty()) {
+                    stream.write(
+                        reinterpret_cast<const char *>(&m_strings[0]),
+                        m_strings.size() * sizeof(char_type));
+                }
+            }
+
+        private:
+            typedef boost::unordered_map<string_type, boost::uint32_t>
+                interned_map;
+
+            struct key_less
+            {
+                explicit key_less(const std::vector<const string_type *> &k)
+                    : keys(&k) {}
+                bool operator ()(boost::uint32_t a, boost::uint32_t b) const
+                {
+                    return *(*keys)[a] < *(*keys)[b];
+                }
+                const std::vector<const string_type *> *keys;
+            };
+
+            static boost::uint32_t checked(std::size_t n)
+            {
+                if (n > 0xffffffffu) {
+                    BOOST_PROPERTY_TREE_THROW(ptree_error(
+                        "tree too large for compact ptree"));
+                }
+                return static_cast<boost::uint32_t>(n);
+            }
+
+            boost::uint32_t intern(const string_type &s,
+                                   boost::uint32_t &size)
+            {
+                size = checked(s.size());
+                if (s.empty())
+                    return 0;
+                std::pair<typename interned_map::iterator, bool> r =
+                    m_interned.insert(std::make_pair(s,
+                        checked(m_strings.size())));
+                if (r.second)
+                    m_strings.insert(m_strings.end(), s.begin(), s.end());
+                return r.first->second;
+            }
+
+            std::vector<const Ptree *> m_trees;
+            std::vector<const string_type *> m_keys;
+            std::vector<compact_ptree_node> m_nodes;
+            std::vector<boost::uint32_t> m_order;
+            std::vector<char_type> m_strings;
+            interned_map m_interned;
+        };
+    }
+
+    template<class Ch>
+    class basic_compact_ptree<Ch>::const_iterator
+        : public boost::iterator_facade<const_iterator, self_type,
+                                        boost::random_access_traversal_tag,
+                                        self_type>
+    {
+        friend class boost::iterator_core_access;
+        friend class basic_compact_ptree<Ch>;
+
+    public:
+        const_iterator() : m_header(0), m_node(0) {}
+
+    private:
+        const_iterator(const detail::compact_ptree_header *header,
+                       const detail::compact_ptree_node *node)
+            : m_header(header), m_node(node)
+        {}
+
+        self_type dereference() const
+        {
+            return self_type(m_header, static_cast<boost::uint32_t>(
+                m_node - detail::compact_ptree_nodes(m_header)));
+        }
+        bool equal(const const_iterator &o) const
+        {
+            return m_node == o.m_node;
+        }
+        void increment() { ++m_node; }
+        void decrement() { --m_node; }
+        void advance(std::ptrdiff_t n) { m_node += n; }
+        std::ptrdiff_t distance_to(const const_iterator &o) const
+        {
+            return o.m_node - m_node;
+        }
+
+        const detail::compact_ptree_header *m_header;
+        const detail::compact_ptree_node *m_node;
+    };
+
+    template<class Ch>
+    basic_compact_ptree<Ch>::basic_compact_ptree(const void *data,
+                                                 size_type size)
+    {
+        using namespace detail;
+        const compact_ptree_header *h =
+            static_cast<const compact_ptree_header *>(data);
+        if (size < sizeof(compact_ptree_header) ||
+            reinterpret_cast<std::size_t>(data) %
+                sizeof(boost::uint32_t) != 0 ||
+            h->magic != compact_ptree_magic) {
+            BOOST_PROPERTY_TREE_THROW(ptree_error("not a compact ptree"));
+        }
+        if (h->version != compact_ptree_version ||
+            h->byte_order != compact_ptree_byte_order ||
+            h->char_size != sizeof(Ch)) {
+            BOOST_PROPERTY_TREE_THROW(ptree_error(
+                "compact ptree written for another platform or version"));
+        }
+        // Individual nodes are checked as they are visited, so opening a
+        // large file touches only its first page.
+        size_type need = sizeof(compact_ptree_header);
+        size_type n = h->node_count;
+        size_type max = static_cast<size_type>(-1);
+        if (n == 0 ||
+            n > (max - need) / (sizeof(compact_ptree_node) +
+                                sizeof(boost::uint32_t)) ||
+            h->string_size > (max - need - n * (sizeof(compact_ptree_node) +
+                                sizeof(boost::uint32_t))) / sizeof(Ch) ||
+            size < need + n * (sizeof(compact_ptree_node) +
+                               sizeof(boost::uint32_t)) +
+                   h->string_size * sizeof(Ch)) {
+            corrupt_compact_ptree();
+        }
+        m_header = h;
+        m_node = node_at(0);
+    }
+
+    template<class Ch> inline
+    basic_compact_ptree<Ch>::basic_compact_ptree(
+            const detail::compact_ptree_header *header,
+            boost::uint32_t index)
+        : m_header(header), m_node(node_at(index))
+    {
+    }
+
+    template<class Ch>
+    const detail::compact_ptree_node *
+        basic_compact_ptree<Ch>::node_at(boost::uint32_t index) const
+    {
+        if (index >= m_header->node_count)
+            detail::corrupt_compact_ptree();
+        const detail::compact_ptree_node *n =
+            detail::compact_ptree_nodes(m_header) + index;
+        if (n->children > m_header->node_count ||
+            n->size > m_header->node_count - n->children)
+            detail::corrupt_compact_ptree();
+        return n;
+    }
+
+    template<class Ch> inline
+    boost::uint32_t basic_compact_ptree<Ch>::index_of(
+            const detail::compact_ptree_node *n) const
+    {
+        return static_cast<boost::uint32_t>(
+            n - detail::compact_ptree_nodes(m_header));
+    }
+
+    template<class Ch>
+    typename basic_compact_ptree<Ch>::string_view_type
+        basic_compact_ptree<Ch>::string_at(boost::uint32_t offset,
+                                           boost::uint32_t size) const
+    {
+        if (offset > m_header->string_size ||
+            size > m_header->string_size - offset)
+            detail::corrupt_compact_ptree();
+        return string_view_type(
+            detail::compact_ptree_strings<Ch>(m_header) + offset, size);
+    }
+
+    template<class Ch> inline
+    typename basic_compact_ptree<Ch>::string_view_type
+        basic_compact_ptree<Ch>::key() const
+    {
+        return string_at(m_node->key, m_node->key_size);
+    }
+
+    template<class Ch> inline
+    typename basic_compact_ptree<Ch>::string_view_type
+        basic_compact_ptree<Ch>::data() const
+    {
+        return string_at(m_node->data, m_node->data_size);
+    }
+
+    template<class Ch> inline
+    typename basic_compact_ptree<Ch>::size_type
+        basic_compact_ptree<Ch>::size() const
+    {
+        return m_node->size;
+    }
+
+    template<class Ch> inline
+    bool basic_compact_ptree<Ch>::empty() const
+    {
+        return m_node->size == 0;
+    }
+
+    template<class Ch> inline
+    typename basic_compact_ptree<Ch>::const_iterator
+        basic_compact_ptree<Ch>::begin() const
+    {
+        return const_iterator(m_header,
+            detail::compact_ptree_nodes(m_header) + m_node->children);
+    }
+
+    template<class Ch> inline
+    typename basic_compact_ptree<Ch>::const_iterator
+        basic_compact_ptree<Ch>::end() const
+    {
+        return const_iterator(m_header,
+            detail::compact_ptree_nodes(m_header) + m_node->children +
+            m_node->size);
+    }
+
+    template<class Ch>
+    const boost::uint32_t *
+        basic_compact_ptree<Ch>::lower_bound(
+            const detail::compact_ptree_node *parent,
+            const key_type &key) const
+    {
+        // The first entry of parent's children in order[] whose key is not
+        // less than key, so that the first of equal keys is found.
+        const boost::uint32_t *first =
+            detail::compact_ptree_order(m_header) + parent->children;
+        std::size_t len = parent->size;
+        while (len > 0) {
+            std::size_t half = len / 2;
+            const detail::compact_ptree_node *n = node_at(first[half]);
+            string_view_type k = string_at(n->key, n->key_size);
+            if (detail::compare_keys(k.data(), k.size(),
+                                     key.data(), key.size()) < 0) {
+                first += half + 1;
+                len -= half + 1;
+            } else {
+                len = half;
+            }
+        }
+        return first;
+    }
+
+    template<class Ch>
+    const detail::compact_ptree_node *
+        basic_compact_ptree<Ch>::find(const detail::compact_ptree_node *parent,
+                                      const key_type &key) const
+    {
+        const boost::uint32_t *first = lower_bound(parent, key);
+        const boost::uint32_t *last = detail::compact_ptree_order(m_header) +
+            parent->children + parent->size;
+        if (first == last)
+            return 0;
+        const detail::compact_ptree_node *n = node_at(*first);
+        string_view_type k = string_at(n->key, n->key_size);
+        if (detail::compare_keys(k.data(), k.size(),
+                                 key.data(), key.size()) != 0)
+            return 0;
+        return n;
+    }
+
+    template<class Ch>
+    typename basic_compact_ptree<Ch>::size_type
+        basic_compact_ptree<Ch>::count(const key_type &key) const
+    {
+        // Equal keys are adjacent in order[], starting at the lower bound.
+        const boost::uint32_t *last = detail::compact_ptree_order(m_header) +
+            m_node->children + m_node->size;
+        size_type c = 0;
+        for (const boost::uint32_t *it = lower_bound(m_node, key);
+             it != last; ++it, ++c) {
+            const detail::compact_ptree_node *m = node_at(*it);
+            string_view_type k = string_at(m->key, m->key_size);
+            if (detail::compare_keys(k.data(), k.size(),
+                                     key.data(), key.size()) != 0)
+                break;
+        }
+        return c;
+    }
+
+    template<class Ch>
+    const detail::compact_ptree_node *
+        basic_compact_ptree<Ch>::walk_path(path_type &p) const
+    {
+        const detail::compact_ptree_node *n = m_node;
+        while (!p.empty()) {
+            key_type fragment = p.reduce();
+            n = find(n, fragment);
+            if (!n)
+                return 0;
+        }
+        return n;
+    }
+
+    template<class Ch>
+    basic_compact_ptree<Ch>
+        basic_compact_ptree<Ch>::get_child(const path_type &path) const
+    {
+        path_type p(path);
+        const detail::compact_ptree_node *n = walk_path(p);
+        if (!n) {
+            BOOST_PROPERTY_TREE_THROW(ptree_bad_path("No such node", path));
+        }
+        return self_type(m_header, index_of(n));
+    }
+
+    template<class Ch>
+    optional<basic_compact_ptree<Ch> >
+        basic_compact_ptree<Ch>::get_child_optional(
+            const path_type &path) const
+    {
+        path_type p(path);
+        const detail::compact_ptree_node *n = walk_path(p);
+        if (!n) {
+            return optional<self_type>();
+        }
+        return self_type(m_header, index_of(n));
+    }
+
+    template<class Ch>
+    template<class Type>
+    Type basic_compact_ptree<Ch>::get_value() const
+    {
+        if(boost::optional<Type> o = get_value_optional<Type>()) {
+            return *o;
+        }
+        string_view_type d = data();
+        BOOST_PROPERTY_TREE_THROW(ptree_bad_data(
+            std::string("conversion of data to type \"") +
+            typeid(Type).name() + "\" failed", data_type(d.begin(), d.end())));
+    }
+
+    template<class Ch>
+    template<class Type>
+    optional<Type> basic_compact_ptree<Ch>::get_value_optional() const
+    {
+        typename translator_between<data_type, Type>::type tr;
+        string_view_type d = data();
+        return tr.get_value(data_type(d.begin(), d.end()));
+    }
+
+    template<class Ch>
+    template<class Type> inline
+    Type basic_compact_ptree<Ch>::get(const path_type &path) const
+    {
+        return get_child(path).BOOST_NESTED_TEMPLATE get_value<Type>();
+    }
+
+    template<class Ch>
+    template<class Type> inline
+    Type basic_compact_ptree<Ch>::get(const path_type &path,
+                                      const Type &default_value) const
+    {
+        return get_optional<Type>(path).get_value_or(default_value);
+    }
+
+    template<class Ch>
+    template <class Ch2>
+    typename boost::enable_if<
+        detail::is_character<Ch2>,
+        std::basic_string<Ch2>
+    >::type
+    basic_compact_ptree<Ch>::get(
+        const path_type &path, const Ch2 *default_value) const
+    {
+        return get< std::basic_string<Ch2> >(path, default_value);
+    }
+
+    template<class Ch>
+    template<class Type>
+    optional<Type> basic_compact_ptree<Ch>::get_optional(
+                                                const path_type &path) const
+    {
+        if (optional<self_type> child = get_child_optional(path))
+            return child.get().BOOST_NESTED_TEMPLATE get_value_optional<Type>();
+        else
+            return optional<Type>();
+    }
+
+    template<class Ch>
+    basic_compact_ptree_file<Ch>::basic_compact_ptree_file(
+            const std::string &filename)
+        : m_root(open(filename))
+    {
+    }
+
+    template<class Ch>
+    basic_compact_ptree<Ch> basic_compact_ptree_file<Ch>::open(
+            const std::string &filename)
+    {
+        try {
+            interprocess::file_mapping mapping(filename.c_str(),
+                                               interprocess::read_only);
+            interprocess::mapped_region region(mapping,
+                                               interprocess::read_only);
+            m_mapping.swap(mapping);
+            m_region.swap(region);
+        } catch (interprocess::interprocess_exception &) {
+            BOOST_PROPERTY_TREE_THROW(ptree_error(
+                "cannot map file " + filename));
+        }
+        return basic_compact_ptree<Ch>(m_region.get_address(),
+                                       m_region.get_size());
+    }
+
+    template<class Ch> inline
+    const basic_compact_ptree<Ch> &
+        basic_compact_ptree_file<Ch>::root() const
+    {
+        return m_root;
+    }
+
+    template<class Ptree>
+    void write_compact(std::ostream &stream, const Ptree &pt)
+    {
+        detail::compact_ptree_builder<Ptree>(pt).write(stream);
+        if (!stream.good()) {
+            BOOST_PROPERTY_TREE_THROW(ptree_error(
+                "write error while writing compact ptree"));
+        }
+    }
+
+    template<class Ptree>
+    void write_compact(const std::string &filename, const Ptree &pt)
+    {
+        std::ofstream stream(filename.c_str(),
+                             std::ios_base::out | std::ios_base::binary);
+        if (!stream) {
+            BOOST_PROPERTY_TREE_THROW(ptree_error(
+                "cannot open file " + filename));
+        }
+        write_compact(stream, pt);
+    }
+
+}}
+
+#endif
@@ -364,6 +364,18 @@ namespace boost { namespace property_tree
         return iterator(subs::ch(this).push_back(value).first);
     }
 
+#if !defined(BOOST_NO_CXX11_RVALUE_REFERENCES) && \
+    !defined(BOOST_NO_CXX11_HDR_TUPLE)
+    template<class K, class D, class C> inline
+    typename basic_ptree<K, D, C>::iterator
+        basic_ptree<K, D, C>::emplace_back(key_type &&key)
+    {
+        return iterator(subs::ch(this).emplace_back(std::piecewise_construct,
+            std::forward_as_tuple(std::move(key)),
+            std::forward_as_tuple()).first);
+    }
+#endif
+
     template<class K, class D, class C> inline
     void basic_ptree<K, D, C>::pop_front()
     {
@@ -46,6 +46,29 @@ namespace boost { namespace property_tree { namespace json_parser
         detail::read_json_internal(stream, pt, std::string());
     }
 
+    /**
+     * Read JSON from a contiguous buffer, such as the contents of a
+     * memory-mapped file, and translate it to a property tree.
+     * @note Clears existing contents of property tree.  In case of error the
+     *       property tree unmodified.
+     * @note The result is the same as for the stream overload, which reads
+     *       the stream into memory and then parses it like this one.
+     * @throw json_parser_error In case of error deserializing the property
+     *                          tree.
+     * @param first Start of the JSON text.
+     * @param last End of the JSON text.
+     * @param[out] pt The property tree to populate.
+     * @param filename Name reported in parse errors.
+     */
+    template<class Ptree>
+    void read_json(const typename Ptree::key_type::value_type *first,
+                   const typename Ptree::key_type::value_type *last,
+                   Ptree &pt,
+                   const std::string &filename = std::string())
+    {
+        detail::read_json_internal(first, last, pt, filename);
+    }
+
     /**
      * Read JSON from a the given file and translate it to a property tree.
      * @note Clears existing contents of property tree.  In case of error the
@@ -2,8 +2,10 @@
 #define BOOST_PROPERTY_TREE_DETAIL_JSON_PARSER_NARROW_ENCODING_HPP
 
 #include <boost/assert.hpp>
+#include <boost/cstdint.hpp>
 #include <boost/range/iterator_range_core.hpp>
 
+#include <cstring>
 #include <utility>
 
 namespace boost { namespace property_tree {
@@ -108,6 +110,37 @@ namespace boost { namespace property_tree {
             }
         }
 
+        // Skips the run of printable ASCII, other than quote and backslash,
+        // that a string can contain verbatim.
+        template <typename Iterator, typename Sentinel>
+        void skip_unescaped(Iterator& cur, Sentinel end) const {
+            while (cur != end && is_unescaped(*cur)) {
+                ++cur;
+            }
+        }
+
+        // Contiguous input is checked eight bytes at a time.
+        void skip_unescaped(const char*& cur, const char* end) const {
+            const boost::uint64_t ones = 0x0101010101010101ull;
+            const boost::uint64_t highs = ones * 0x80;
+            while (end - cur >= 8) {
+                boost::uint64_t w;
+                std::memcpy(&w, cur, 8);
+                // With all bytes below 0x80, subtracting sets a byte's
+                // high bit exactly when some byte was below the operand.
+                boost::uint64_t stop = w | (w - ones * 0x20) |
+                    ((w ^ (ones * '"')) - ones) |
+                    ((w ^ (ones * '\\')) - ones);
+                if (stop & highs) {
+                    break;
+                }
+                cur += 8;
+            }
+            while (cur != end && is_unescaped(*cur)) {
+                ++cur;
+            }
+        }
+
         template <typename TranscodedFn>
         void feed_codepoint(unsigned codepoint,
                             TranscodedFn transcoded_fn) const {
@@ -142,6 +175,10 @@ namespace boost { namespace property_tree {
             void operator ()(char) const {}
         };
 
+        bool is_unescaped(unsigned char c) const {
+            return c >= 0x20 && c <= 0x7f && c != '"' && c != '\\';
+        }
+
         bool is_trail(unsigned char c) const {
             return (c & 0xc0) == 0x80;
         }
@@ -185,6 +185,9 @@ namespace boost { namespace property_tree {
         template <typename Sentinel, typename EncodingErrorFn>
         void process_codepoint(Sentinel end, EncodingErrorFn error_fn) {
             encoding.skip_codepoint(cur, end, error_fn);
+            // The run is only copied out at its end, so plain characters
+            // can be skipped in bulk.
+            encoding.skip_unescaped(cur, end);
         }
 
     private:
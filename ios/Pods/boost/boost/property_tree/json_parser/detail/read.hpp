@@ -18,6 +18,7 @@
 #include <boost/static_assert.hpp>
 #include <boost/type_traits/is_same.hpp>
 
+#include <cstddef>
 #include <istream>
 #include <iterator>
 #include <string>
@@ -71,20 +72,56 @@ namespace boost { namespace property_tree {
 
     template <typename Ptree>
     void read_json_internal(
-        std::basic_istream<typename Ptree::key_type::value_type> &stream,
+        const typename Ptree::key_type::value_type *first,
+        const typename Ptree::key_type::value_type *last,
         Ptree &pt, const std::string &filename)
     {
         typedef typename Ptree::key_type::value_type char_type;
         typedef standard_callbacks<Ptree> callbacks_type;
         typedef detail::encoding<char_type> encoding_type;
-        typedef std::istreambuf_iterator<char_type> iterator;
         callbacks_type callbacks;
         encoding_type encoding;
-        read_json_internal(iterator(stream), iterator(),
-            encoding, callbacks, filename);
+        read_json_internal(first, last, encoding, callbacks, filename);
         pt.swap(callbacks.output());
     }
 
+    // Reads the rest of the stream into memory, so that the parser works on
+    // contiguous input: strings and numbers are then copied out in runs
+    // instead of a character at a time.
+    template <typename Ch>
+    void read_stream(std::basic_istream<Ch> &stream,
+                     std::basic_string<Ch> &buffer)
+    {
+        std::basic_streambuf<Ch> *buf = stream.rdbuf();
+        if (!buf) {
+            return;
+        }
+        std::size_t size = 0;
+        buffer.resize(4096);
+        for (;;) {
+            std::streamsize n = buf->sgetn(&buffer[size],
+                static_cast<std::streamsize>(buffer.size() - size));
+            size += static_cast<std::size_t>(n);
+            if (size < buffer.size()) {
+                break;
+            }
+            buffer.resize(buffer.size() * 2);
+        }
+        buffer.resize(size);
+    }
+
+    template <typename Ptree>
+    void read_json_internal(
+        std::basic_istream<typename Ptree::key_type::value_type> &stream,
+        Ptree &pt, const std::string &filename)
+    {
+        typedef typename Ptree::key_type::value_type char_type;
+        std::basic_string<char_type> buffer;
+        read_stream(stream, buffer);
+        read_json_internal(buffer.data(), buffer.data() + buffer.size(),
+            pt, filename);
+    }
+
 }}}}
 
 #endif
@@ -3,6 +3,7 @@
 
 #include <boost/assert.hpp>
 #include <boost/property_tree/ptree.hpp>
+#include <utility>
 #include <vector>
 
 namespace boost { namespace property_tree {
@@ -111,8 +112,8 @@ namespace boost { namespace property_tree {
             layer& l = stack.back();
             switch (l.k) {
             case array: {
-                l.t->push_back(std::make_pair(string(), Ptree()));
-                layer nl = {leaf, &l.t->back().second};
+                string empty;
+                layer nl = {leaf, &new_child(*l.t, empty)};
                 stack.push_back(nl);
                 return *stack.back().t;
             }
@@ -120,9 +121,9 @@ namespace boost { namespace property_tree {
             default:
                 BOOST_ASSERT(false); // must start with string, i.e. call new_value
             case key: {
-                l.t->push_back(std::make_pair(key_buffer, Ptree()));
+                Ptree& child = new_child(*l.t, key_buffer);
                 l.k = object;
-                layer nl = {leaf, &l.t->back().second};
+                layer nl = {leaf, &child};
                 stack.push_back(nl);
                 return *stack.back().t;
             }
@@ -131,6 +132,15 @@ namespace boost { namespace property_tree {
                 return new_tree();
             }
         }
+        // Appends a child, taking the key's contents where possible.
+        static Ptree& new_child(Ptree& parent, string& key) {
+#if !defined(BOOST_NO_CXX11_RVALUE_REFERENCES) && \
+    !defined(BOOST_NO_CXX11_HDR_TUPLE)
+            return parent.emplace_back(std::move(key))->second;
+#else
+            return parent.push_back(std::make_pair(key, Ptree()))->second;
+#endif
+        }
         string& new_value() {
             if (stack.empty()) return new_tree().data();
             layer& l = stack.back();
@@ -97,6 +97,15 @@ namespace boost { namespace property_tree {
             feed_codepoint(codepoint, transcoded_fn, test_utf16());
         }
 
+        // Skips the run of characters below the surrogates, other than
+        // controls, quote and backslash, that a string can contain verbatim.
+        template <typename Iterator, typename Sentinel>
+        void skip_unescaped(Iterator& cur, Sentinel end) const {
+            while (cur != end && is_unescaped(*cur)) {
+                ++cur;
+            }
+        }
+
         template <typename Iterator, typename Sentinel>
         void skip_introduction(Iterator& cur, Sentinel end) const {
             // Endianness is already decoded at this level.
@@ -169,6 +178,10 @@ namespace boost { namespace property_tree {
             }
         }
 
+        static bool is_unescaped(wchar_t c) {
+            return c >= 0x20 && c < 0xd800 && c != L'"' && c != L'\\';
+        }
+
         static bool is_surrogate_high(unsigned codepoint) {
             return (codepoint & 0xfc00) == 0xd800;
         }
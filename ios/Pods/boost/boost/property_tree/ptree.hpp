@@ -27,6 +27,10 @@
 #include <boost/throw_exception.hpp>
 #include <boost/optional.hpp>
 #include <utility>                  // for std::pair
+#if !defined(BOOST_NO_CXX11_RVALUE_REFERENCES) && \
+    !defined(BOOST_NO_CXX11_HDR_TUPLE)
+#include <tuple>                    // for std::forward_as_tuple
+#endif
 
 namespace boost { namespace property_tree
 {
@@ -153,6 +157,16 @@ namespace boost { namespace property_tree
         /** Equivalent to insert(end(), value). */
         iterator push_back(const value_type &value);
 
+#if !defined(BOOST_NO_CXX11_RVALUE_REFERENCES) && \
+    !defined(BOOST_NO_CXX11_HDR_TUPLE)
+        /** Equivalent to push_back(value_type(key, self_type())), but
+         * constructs the child in place instead of copying a temporary, and
+         * moves from the key.
+         * @return An iterator to the newly created child.
+         */
+        iterator emplace_back(key_type &&key);
+#endif
+
         /** Equivalent to erase(begin()). */
         void pop_front();
 
@@ -0,0 +1,535 @@
+//----------------------------------------------------------------------------
+/// @file auto_sort.hpp
+/// @brief Front end which selects one of the sort algorithms of the library
+///        from the type and the shape of the data to sort
+///
+/// Distributed under the Boost Software License, Version 1.0.\n
+/// ( See accompanying file LICENSE_1_0.txt or copy at
+///   http://www.boost.org/LICENSE_1_0.txt  )
+///
+/// @remarks Sorted and reverse sorted ranges are detected and finished in
+///          linear time. Strings, and the integer, floating point and string
+///          keys of by_key, go to the spreadsort algorithms; everything
+///          else, and nearly sorted ranges, to pdqsort, or to
+///          block_indirect_sort when the range is large and there are
+///          threads for it.
+//-----------------------------------------------------------------------------
+#ifndef __BOOST_SORT_AUTO_SORT_HPP
+#define __BOOST_SORT_AUTO_SORT_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <string>
+#include <thread>
+#include <type_traits>
+
+#include <boost/sort/block_indirect_sort/block_indirect_sort.hpp>
+#include <boost/sort/pdqsort/pdqsort.hpp>
+#include <boost/sort/spreadsort/spreadsort.hpp>
+#include <boost/sort/common/util/traits.hpp>
+
+namespace boost
+{
+namespace sort
+{
+namespace auto_detail
+{
+//---------------------------------------------------------------------------
+//                    USING SENTENCES
+//---------------------------------------------------------------------------
+namespace bscu = boost::sort::common::util;
+using bscu::value_iter;
+using bscu::compare_iter;
+
+//---------------------------------------------------------------------------
+//                    C O N S T A N T S
+//---------------------------------------------------------------------------
+// Below this size pdqsort wins over everything else, and the radix sorts
+// would fall back to a comparison sort anyway.
+static constexpr size_t min_radix_size = 1024;
+
+// Number of equally spaced pairs of neighbours looked at to guess if the
+// data is already sorted, reverse sorted or nearly sorted.
+static constexpr uint32_t nsample = 64;
+
+// The radix sorts are about as fast as the parallel comparison sorts with
+// two threads, so they are only replaced when more threads are available.
+static constexpr uint32_t min_thread_radix = 3;
+
+// Below this size the threads of the parallel sorts are not worth starting.
+static constexpr size_t min_parallel_size = 1 << 15;
+//
+//---------------------------------------------------------------------------
+/// @struct radix_kind
+/// @brief classify the types which the spreadsort algorithms can sort by
+///        their bits instead of by comparisons
+//---------------------------------------------------------------------------
+enum radix_kind_t { radix_none, radix_integer, radix_float, radix_string };
+
+template<class T, class = void>
+struct radix_kind
+{
+    static constexpr radix_kind_t value = radix_none;
+};
+
+template<class T>
+struct radix_kind<T, typename std::enable_if<std::is_integral<T>::value
+                    and not std::is_same<T, bool>::value>::type>
+{
+    static constexpr radix_kind_t value = radix_integer;
+};
+
+// float_sort needs a signed integer of the same size to cast to
+template<class T>
+struct radix_kind<T, typename std::enable_if<std::is_floating_point<T>::value
+                    and std::numeric_limits<T>::is_iec559
+                    and (sizeof(T) == 4 or sizeof(T) == 8)>::type>
+{
+    static constexpr radix_kind_t value = radix_float;
+};
+
+template<>
+struct radix_kind<std::string, void>
+{
+    static constexpr radix_kind_t value = radix_string;
+};
+//
+//---------------------------------------------------------------------------
+/// @struct float_cast
+/// @brief signed integer with the size of the floating point type T
+//---------------------------------------------------------------------------
+template<class T>
+struct float_cast
+{
+    typedef typename std::conditional<sizeof(T) == 4, int32_t,
+                                      int64_t>::type type;
+};
+//
+//---------------------------------------------------------------------------
+/// @enum order_t
+/// @brief what the sample says about the order of the data
+//---------------------------------------------------------------------------
+enum order_t { order_sorted, order_reverse, order_nearly, order_random };
+//
+//-----------------------------------------------------------------------------
+//  function : sample_order
+/// @brief Compare nsample pairs of neighbours spread over the range. When
+///        the sample says that the range is sorted or reverse sorted, this
+///        is checked over the whole range, which stops at the first pair
+///        out of place.
+///
+/// @param first : iterator to the first element of the range
+/// @param last : iterator after the last element to the range
+/// @param comp : object for to compare two elements pointed by Iter_t
+///               iterators
+/// @return order_sorted and order_reverse only when they hold for all the
+///         range
+//-----------------------------------------------------------------------------
+template<class Iter_t, class Compare>
+order_t sample_order(Iter_t first, Iter_t last, Compare comp)
+{
+    size_t nelem = size_t(last - first);
+    if (nelem < 2) return order_sorted;
+
+    size_t step = (nelem - 1) / nsample;
+    if (step == 0) step = 1;
+    uint32_t ndown = 0, nup = 0, ncheck = 0;
+    for (size_t i = 0; i + 1 < nelem and ncheck < nsample; i += step, ++ncheck)
+    {
+        if (comp(first[i + 1], first[i])) ++ndown;
+        else if (comp(first[i], first[i + 1])) ++nup;
+    };
+
+    if (ndown == 0)
+    {
+        Iter_t it1 = first, it2 = first + 1;
+        while (it2 != last and not comp(*it2, *it1)) it1 = it2++;
+        return (it2 == last) ? order_sorted : order_nearly;
+    };
+    if (nup == 0)
+    {
+        Iter_t it1 = first, it2 = first + 1;
+        while (it2 != last and not comp(*it1, *it2)) it1 = it2++;
+        return (it2 == last) ? order_reverse : order_nearly;
+    };
+    return (ndown * 16 <= ncheck or nup * 16 <= ncheck) ? order_nearly
+                                                         : order_random;
+};
+//
+//---------------------------------------------------------------------------
+/// @struct value_radix
+/// @brief radix sort used for elements compared with std::less. Numbers are
+///        left to pdqsort, whose branchless partition is faster than
+///        integer_sort and float_sort on them.
+//---------------------------------------------------------------------------
+template<class T>
+struct value_radix
+{
+    static constexpr radix_kind_t value =
+        radix_kind<T>::value == radix_string ? radix_string : radix_none;
+};
+//
+//-----------------------------------------------------------------------------
+//  function : radix_sort
+/// @brief sort with the spreadsort algorithm for the type of the elements,
+///        in ascending order
+//-----------------------------------------------------------------------------
+template<class Iter_t>
+void radix_sort(Iter_t, Iter_t,
+                std::integral_constant<radix_kind_t, radix_none>)
+{
+};
+
+template<class Iter_t>
+void radix_sort(Iter_t first, Iter_t last,
+                std::integral_constant<radix_kind_t, radix_string>)
+{
+    spreadsort::string_sort(first, last);
+};
+//
+//---------------------------------------------------------------------------
+/// @struct key_less
+/// @brief compare two elements by the keys extracted from them
+//---------------------------------------------------------------------------
+template<class Key_of>
+struct key_less
+{
+    Key_of key;
+
+    template<class T>
+    bool operator()(const T &x, const T &y) const
+    {
+        return key(x) < key(y);
+    };
+};
+//
+//---------------------------------------------------------------------------
+/// @struct key_shift
+/// @brief right shift of the key of an element, for integer_sort and
+///        float_sort
+//---------------------------------------------------------------------------
+template<class Key_of, class Key_t,
+         radix_kind_t Kind = radix_kind<Key_t>::value>
+struct key_shift
+{
+    Key_of key;
+
+    template<class T>
+    Key_t operator()(const T &x, unsigned offset) const
+    {
+        return key(x) >> offset;
+    };
+};
+
+template<class Key_of, class Key_t>
+struct key_shift<Key_of, Key_t, radix_float>
+{
+    Key_of key;
+
+    template<class T>
+    typename float_cast<Key_t>::type
+    operator()(const T &x, unsigned offset) const
+    {
+        return spreadsort::float_mem_cast<Key_t,
+                   typename float_cast<Key_t>::type>(key(x)) >> offset;
+    };
+};
+//
+//---------------------------------------------------------------------------
+/// @struct key_char
+/// @brief character of the key of an element, and size of the key, for
+///        string_sort
+//---------------------------------------------------------------------------
+template<class Key_of>
+struct key_char
+{
+    Key_of key;
+
+    template<class T>
+    unsigned char operator()(const T &x, size_t offset) const
+    {
+        return static_cast<unsigned char>(key(x)[offset]);
+    };
+};
+
+template<class Key_of>
+struct key_size
+{
+    Key_of key;
+
+    template<class T>
+    size_t operator()(const T &x) const
+    {
+        return key(x).size();
+    };
+};
+//
+//-----------------------------------------------------------------------------
+//  function : radix_sort_key
+/// @brief sort with the spreadsort algorithm for the type of the keys, in
+///        ascending order of the keys
+//-----------------------------------------------------------------------------
+template<class Iter_t, class Key_of, class Key_t>
+void radix_sort_key(Iter_t, Iter_t, Key_of,
+                    std::integral_constant<radix_kind_t, radix_none>)
+{
+};
+
+template<class Iter_t, class Key_of, class Key_t>
+void radix_sort_key(Iter_t first, Iter_t last, Key_of key,
+                    std::integral_constant<radix_kind_t, radix_integer>)
+{
+    spreadsort::integer_sort(first, last, key_shift<Key_of, Key_t>{key},
+                             key_less<Key_of>{key});
+};
+
+template<class Iter_t, class Key_of, class Key_t>
+void radix_sort_key(Iter_t first, Iter_t last, Key_of key,
+                    std::integral_constant<radix_kind_t, radix_float>)
+{
+    spreadsort::float_sort(first, last, key_shift<Key_of, Key_t>{key},
+                           key_less<Key_of>{key});
+};
+
+template<class Iter_t, class Key_of, class Key_t>
+void radix_sort_key(Iter_t first, Iter_t last, Key_of key,
+                    std::integral_constant<radix_kind_t, radix_string>)
+{
+    spreadsort::string_sort(first, last, key_char<Key_of>{key},
+                            key_size<Key_of>{key}, key_less<Key_of>{key});
+};
+//
+//-----------------------------------------------------------------------------
+//  function : compare_sort
+/// @brief sort by comparisons, with pdqsort, or with block_indirect_sort
+///        when the range is large and there are threads for it
+//-----------------------------------------------------------------------------
+template<class Iter_t, class Compare>
+void compare_sort(Iter_t first, Iter_t last, Compare comp, uint32_t nthread)
+{
+    if (nthread > 1 and size_t(last - first) >= min_parallel_size)
+        block_indirect_sort(first, last, comp, nthread);
+    else
+        pdqsort(first, last, comp);
+};
+//
+//-----------------------------------------------------------------------------
+//  function : use_radix
+/// @brief decide if a range which the spreadsort algorithms can sort, should
+///        be sorted by them
+//-----------------------------------------------------------------------------
+inline bool use_radix(size_t nelem, order_t order, uint32_t nthread)
+{
+    // pdqsort finishes nearly sorted data in close to linear time, while the
+    // radix sorts do the same work for every input
+    if (nelem < min_radix_size or order == order_nearly) return false;
+    return nthread < min_thread_radix or nelem < min_parallel_size;
+};
+//
+//-----------------------------------------------------------------------------
+//  function : auto_sort
+/// @brief sort the range, with a radix sort when Radix is not radix_none
+//-----------------------------------------------------------------------------
+template<class Iter_t, class Compare, radix_kind_t Radix>
+void auto_sort(Iter_t first, Iter_t last, Compare comp, uint32_t nthread,
+               std::integral_constant<radix_kind_t, Radix> radix)
+{
+    order_t order = sample_order(first, last, comp);
+    if (order == order_sorted) return;
+    if (order == order_reverse)
+    {
+        std::reverse(first, last);
+        return;
+    };
+    if (Radix != radix_none and use_radix(size_t(last - first), order,
+                                          nthread))
+    {
+        radix_sort(first, last, radix);
+        return;
+    };
+    compare_sort(first, last, comp, nthread);
+};
+//
+//-----------------------------------------------------------------------------
+//  function : auto_sort_key
+/// @brief sort the range by the keys extracted with key, with a radix sort
+///        when the type of the keys allows it
+//-----------------------------------------------------------------------------
+template<class Iter_t, class Key_of>
+void auto_sort_key(Iter_t first, Iter_t last, Key_of key, uint32_t nthread)
+{
+    typedef typename std::decay<decltype(key(*first))>::type key_t;
+    typedef std::integral_constant<radix_kind_t, radix_kind<key_t>::value>
+                    radix_t;
+    key_less<Key_of> comp{key};
+
+    order_t order = sample_order(first, last, comp);
+    if (order == order_sorted) return;
+    if (order == order_reverse)
+    {
+        std::reverse(first, last);
+        return;
+    };
+    if (radix_t::value != radix_none and use_radix(size_t(last - first),
+                                                   order, nthread))
+    {
+        radix_sort_key<Iter_t, Key_of, key_t>(first, last, key, radix_t());
+        return;
+    };
+    compare_sort(first, last, comp, nthread);
+};
+//
+//****************************************************************************
+};//    End namespace auto_detail
+//****************************************************************************
+//
+namespace bscu = boost::sort::common::util;
+//
+//---------------------------------------------------------------------------
+/// @struct key_extractor
+/// @brief Wraps the function which extracts the sort key from an element,
+///        to select the key extraction overloads of auto_sort. Use by_key
+///        to build it.
+//---------------------------------------------------------------------------
+template<class Key_of>
+struct key_extractor
+{
+    Key_of key;
+};
+//
+//-----------------------------------------------------------------------------
+//  function : by_key
+/// @brief build the argument of the key extraction overloads of auto_sort
+///
+/// @param key : function object which receives an element, and returns its
+///              key. Elements are sorted in ascending order of the keys. A
+///              key of type std::string should be returned by reference.
+//-----------------------------------------------------------------------------
+template<class Key_of>
+key_extractor<Key_of> by_key(Key_of key)
+{
+    return key_extractor<Key_of>{key};
+};
+//
+//############################################################################
+//                                                                          ##
+//                                                                          ##
+//                         A U T O _ S O R T                                ##
+//                                                                          ##
+//                                                                          ##
+//############################################################################
+//
+// auto_sort is not stable. It selects the algorithm in this order:
+//   * data already sorted, or sorted in reverse, is detected by sampling
+//     and confirmed with a single pass, and is only reversed if needed
+//   * std::string compared with std::less uses string_sort, and keys of
+//     integer, IEEE float and std::string type extracted with by_key use
+//     integer_sort, float_sort and string_sort, unless the data is nearly
+//     sorted, or there are enough threads for a parallel sort to win
+//   * large ranges with at least two threads use block_indirect_sort
+//   * everything else uses pdqsort
+//
+//-----------------------------------------------------------------------------
+//  function : auto_sort
+/// @brief sort the range in ascending order with the algorithm that suits it
+///
+/// @param first : iterator to the first element of the range to sort
+/// @param last : iterator after the last element to the range to sort
+//-----------------------------------------------------------------------------
+template<class Iter_t>
+void auto_sort(Iter_t first, Iter_t last)
+{
+    typedef bscu::value_iter<Iter_t> value_t;
+    auto_detail::auto_sort(first, last, bscu::compare_iter<Iter_t>(),
+                           std::thread::hardware_concurrency(),
+                           std::integral_constant<auto_detail::radix_kind_t,
+                              auto_detail::value_radix<value_t>::value>());
+};
+//
+//-----------------------------------------------------------------------------
+//  function : auto_sort
+/// @brief sort the range in ascending order with the algorithm that suits it
+///
+/// @param first : iterator to the first element of the range to sort
+/// @param last : iterator after the last element to the range to sort
+/// @param nthread : Number of threads to use in the process. When this value
+///                  is lower than 2, the sorting is done with 1 thread
+//-----------------------------------------------------------------------------
+template<class Iter_t>
+void auto_sort(Iter_t first, Iter_t last, uint32_t nthread)
+{
+    typedef bscu::value_iter<Iter_t> value_t;
+    auto_detail::auto_sort(first, last, bscu::compare_iter<Iter_t>(), nthread,
+                           std::integral_constant<auto_detail::radix_kind_t,
+                              auto_detail::value_radix<value_t>::value>());
+};
+//
+//-----------------------------------------------------------------------------
+//  function : auto_sort
+/// @brief sort the range with the algorithm that suits it. The radix sort
+///        is only used when comp is std::less
+///
+/// @param first : iterator to the first element of the range to sort
+/// @param last : iterator after the last element to the range to sort
+/// @param comp : object for to compare two elements pointed by Iter_t
+///               iterators
+/// @param nthread : Number of threads to use in the process. When this value
+///                  is lower than 2, the sorting is done with 1 thread
+//-----------------------------------------------------------------------------
+template<class Iter_t, class Compare>
+void auto_sort(Iter_t first, Iter_t last, Compare comp, uint32_t nthread)
+{
+    typedef bscu::value_iter<Iter_t> value_t;
+    static constexpr auto_detail::radix_kind_t radix =
+        std::is_same<Compare, bscu::compare_iter<Iter_t> >::value
+            ? auto_detail::value_radix<value_t>::value
+            : auto_detail::radix_none;
+    auto_detail::auto_sort(first, last, comp, nthread,
+        std::integral_constant<auto_detail::radix_kind_t, radix>());
+};
+//
+//-----------------------------------------------------------------------------
+//  function : auto_sort
+/// @brief sort the range with the algorithm that suits it. The radix sort
+///        is only used when comp is std::less
+///
+/// @param first : iterator to the first element of the range to sort
+/// @param last : iterator after the last element to the range to sort
+/// @param comp : object for to compare two elements pointed by Iter_t
+///               iterators
+//-----------------------------------------------------------------------------
+template<class Iter_t, class Compare,
+         bscu::enable_if_not_integral<Compare> * = nullptr>
+void auto_sort(Iter_t first, Iter_t last, Compare comp)
+{
+    auto_sort(first, last, comp, std::thread::hardware_concurrency());
+};
+//
+//-----------------------------------------------------------------------------
+//  function : auto_sort
+/// @brief sort the range in ascending order of the keys extracted from the
+///        elements. Keys of integer, IEEE float and std::string type are
+///        sorted with the radix sorts.
+///
+/// @param first : iterator to the first element of the range to sort
+/// @param last : iterator after the last element to the range to sort
+/// @param key : the function object which extracts the keys, see by_key
+/// @param nthread : Number of threads to use in the process. When this value
+///                  is lower than 2, the sorting is done with 1 thread
+//-----------------------------------------------------------------------------
+template<class Iter_t, class Key_of>
+void auto_sort(Iter_t first, Iter_t last, key_extractor<Key_of> key,
+               uint32_t nthread = std::thread::hardware_concurrency())
+{
+    auto_detail::auto_sort_key(first, last, key.key, nthread);
+};
+//
+//****************************************************************************
+};//    End namespace sort
+};//    End namespace boost
+//****************************************************************************
+//
+#endif
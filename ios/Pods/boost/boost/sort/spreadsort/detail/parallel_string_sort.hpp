@@ -0,0 +1,227 @@
+// Details for a multi-threaded hybrid-radix string_sort.
+
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+// See http://www.boost.org/libs/sort for library home page.
+
+#ifndef BOOST_SORT_SPREADSORT_DETAIL_PARALLEL_STRING_SORT_HPP
+#define BOOST_SORT_SPREADSORT_DETAIL_PARALLEL_STRING_SORT_HPP
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <future>
+#include <thread>
+#include <vector>
+#include <boost/sort/spreadsort/detail/string_sort.hpp>
+#include <boost/sort/common/stack_cnc.hpp>
+#include <boost/sort/common/util/atomic.hpp>
+
+namespace boost {
+namespace sort {
+namespace spreadsort {
+  namespace detail {
+    //Below this many elements per thread, starting threads costs more than
+    //it saves.
+    static const size_t min_parallel_string_sort = 1 << 14;
+    //Every thread should get several buckets, so that uneven buckets still
+    //keep all the threads busy to the end.
+    static const unsigned parallel_string_tasks_per_thread = 8;
+
+    //Splits [first, last) into buckets by the character at char_offset
+    //after skipping the characters all the strings share, like one level of
+    //string_sort_rec.  bin_cache receives the end of the bucket of empties
+    //followed by the end of each character's bucket, and char_offset the
+    //offset that was used.
+    template <class RandomAccessIter, class Unsigned_char_type>
+    inline void
+    string_partition(RandomAccessIter first, RandomAccessIter last,
+                     size_t &char_offset,
+                     std::vector<RandomAccessIter> &bin_cache)
+    {
+      const unsigned bin_count = (1 << (sizeof(Unsigned_char_type)*8));
+      const unsigned membin_count = bin_count + 1;
+      bin_cache.assign(membin_count + 1, last);
+      bin_cache[0] = first;
+      //Skip the leading empties, which stay where they are
+      while ((*first).size() <= char_offset) {
+        if (++first == last)
+          return;
+      }
+      RandomAccessIter finish = last - 1;
+      for (;(*finish).size() <= char_offset; --finish);
+      ++finish;
+      update_offset<RandomAccessIter, Unsigned_char_type>(first, finish,
+                                                          char_offset);
+
+      std::vector<size_t> bin_sizes(membin_count, 0);
+      for (RandomAccessIter current = first; current != last; ++current) {
+        if ((*current).size() <= char_offset)
+          bin_sizes[0]++;
+        else
+          bin_sizes[static_cast<Unsigned_char_type>((*current)[char_offset])
+                    + 1]++;
+      }
+      //next[u] is where the next element of bucket u goes
+      std::vector<RandomAccessIter> next(membin_count);
+      next[0] = first;
+      for (unsigned u = 0; u < membin_count - 1; u++)
+        next[u + 1] = next[u] + bin_sizes[u];
+      for (unsigned u = 0; u < membin_count; u++)
+        bin_cache[u + 1] = next[u] + bin_sizes[u];
+
+      //Swap into place, bucket by bucket
+      for (unsigned u = 0; u < membin_count; ++u) {
+        RandomAccessIter bin_end = bin_cache[u + 1];
+        for (RandomAccessIter current = next[u]; current < bin_end;
+             ++current) {
+          for (unsigned target = (*current).size() <= char_offset ? 0 :
+                 static_cast<Unsigned_char_type>((*current)[char_offset]) + 1;
+               target != u;
+               target = (*current).size() <= char_offset ? 0 :
+                 static_cast<Unsigned_char_type>((*current)[char_offset]) + 1)
+            iter_swap(current, next[target]++);
+        }
+        next[u] = bin_end;
+      }
+    }
+
+    //Sorts one bucket on the calling thread, where all the strings are
+    //identical up to char_offset
+    template <class RandomAccessIter, class Unsigned_char_type>
+    inline void
+    string_sort_bucket(RandomAccessIter first, RandomAccessIter last,
+                       size_t char_offset)
+    {
+      typedef typename std::iterator_traits<RandomAccessIter>::value_type
+        Data_type;
+      const unsigned max_size = (1 << (sizeof(Unsigned_char_type)*8));
+      if (size_t(last - first) < max_size) {
+        boost::sort::pdqsort(first, last,
+          offset_less_than<Data_type, Unsigned_char_type>(char_offset));
+        return;
+      }
+      size_t bin_sizes[(1 << (8 * sizeof(Unsigned_char_type))) + 1];
+      std::vector<RandomAccessIter> bin_cache;
+      string_sort_rec<RandomAccessIter, Unsigned_char_type>
+        (first, last, char_offset, bin_cache, 0, bin_sizes);
+    }
+
+    //The buckets are sorted by tasks taken from a shared stack by every
+    //thread.  A bucket larger than split_size is split again by its next
+    //character into new tasks, so that a prefix shared by many of the
+    //strings does not leave one thread with most of the work.
+    template <class RandomAccessIter, class Unsigned_char_type>
+    class parallel_string_sorter {
+      typedef std::function<void(void)> function_t;
+      typedef std::atomic<uint32_t> atomic_t;
+
+     public:
+      parallel_string_sorter(RandomAccessIter first, RandomAccessIter last,
+                             unsigned nthread)
+        : pending(0), error(false)
+      {
+        split_size = size_t(last - first) /
+                     (nthread * parallel_string_tasks_per_thread);
+        if (split_size < min_parallel_string_sort)
+          split_size = min_parallel_string_sort;
+        add_task(first, last, 0, true);
+
+        std::vector<std::future<void> > vfuture(nthread);
+        for (unsigned i = 0; i < nthread; ++i)
+          vfuture[i] = std::async(std::launch::async, [this]() { exec(); });
+        for (unsigned i = 0; i < nthread; ++i)
+          vfuture[i].get();
+        if (error)
+          std::rethrow_exception(first_error);
+      }
+
+     private:
+      void add_task(RandomAccessIter first, RandomAccessIter last,
+                    size_t char_offset, bool split)
+      {
+        boost::sort::common::util::atomic_add(pending, 1);
+        function_t f = [=]() {
+          if (split)
+            split_bucket(first, last, char_offset);
+          else
+            string_sort_bucket<RandomAccessIter, Unsigned_char_type>
+              (first, last, char_offset);
+        };
+        works.emplace_back(f);
+      }
+
+      void split_bucket(RandomAccessIter first, RandomAccessIter last,
+                        size_t char_offset)
+      {
+        std::vector<RandomAccessIter> bin_cache;
+        string_partition<RandomAccessIter, Unsigned_char_type>
+          (first, last, char_offset, bin_cache);
+        //bin_cache[1] ends the empties, which are already in place
+        for (size_t u = 2; u < bin_cache.size(); ++u) {
+          size_t count = bin_cache[u] - bin_cache[u - 1];
+          if (count < 2)
+            continue;
+          add_task(bin_cache[u - 1], bin_cache[u], char_offset + 1,
+                   count > split_size);
+        }
+      }
+
+      //Runs tasks until all of them are done
+      void exec()
+      {
+        function_t func_exec;
+        while (boost::sort::common::util::atomic_read(pending) != 0 &&
+               !error) {
+          if (works.pop_move_back(func_exec)) {
+            try {
+              func_exec();
+            } catch (...) {
+              //Only the first exception is kept; the other threads stop
+              //taking tasks once error is set
+              if (!error.exchange(true))
+                first_error = std::current_exception();
+            }
+            boost::sort::common::util::atomic_sub(pending, 1);
+          } else {
+            std::this_thread::yield();
+          }
+        }
+      }
+
+      boost::sort::common::stack_cnc<function_t> works;
+      atomic_t pending;
+      std::atomic<bool> error;
+      std::exception_ptr first_error;
+      size_t split_size;
+    };
+
+    //Holds the thread pool and makes the initial call
+    template <class RandomAccessIter, class Unsigned_char_type>
+    inline typename boost::enable_if_c< sizeof(Unsigned_char_type) <= 2, void
+                                                                      >::type
+    parallel_string_sort(RandomAccessIter first, RandomAccessIter last,
+                         unsigned nthread, Unsigned_char_type)
+    {
+      parallel_string_sorter<RandomAccessIter, Unsigned_char_type>
+        (first, last, nthread);
+    }
+
+    template <class RandomAccessIter, class Unsigned_char_type>
+    inline typename boost::disable_if_c< sizeof(Unsigned_char_type) <= 2, void
+                                                                       >::type
+    parallel_string_sort(RandomAccessIter first, RandomAccessIter last,
+                         unsigned, Unsigned_char_type)
+    {
+      //Warning that we're using boost::sort::pdqsort, even though string_sort was called
+      BOOST_STATIC_ASSERT( sizeof(Unsigned_char_type) <= 2 );
+      boost::sort::pdqsort(first, last);
+    }
+  }
+}
+}
+}
+
+#endif
@@ -0,0 +1,100 @@
+//Templated multi-threaded hybrid string_sort
+
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+// See http://www.boost.org/libs/sort/ for library home page.
+
+#ifndef BOOST_PARALLEL_STRING_SORT_HPP
+#define BOOST_PARALLEL_STRING_SORT_HPP
+#include <thread>
+#include <boost/sort/spreadsort/string_sort.hpp>
+#include <boost/sort/spreadsort/detail/parallel_string_sort.hpp>
+#include <boost/range/begin.hpp>
+#include <boost/range/end.hpp>
+
+namespace boost {
+namespace sort {
+namespace spreadsort {
+
+/*! \brief Multi-threaded string sort algorithm using random access iterators, allowing character-type overloads.
+  (Falls back to @c string_sort on one thread if @c nthread is less than 2 or the data size is less than
+  2 * @c detail::min_parallel_string_sort).
+
+  \details The range is split into buckets by its first distinguishing character, as in the first
+level of @c string_sort. The buckets are then sorted by a pool of @c nthread threads, which take
+them from a shared stack of tasks. A bucket that would be too large for one thread, such as the
+strings sharing a common prefix, is split again by its next character first. The result is the
+same as for @c string_sort.
+
+   \param[in] first Iterator pointer to first element.
+   \param[in] last Iterator pointing to one beyond the end of data.
+   \param[in] nthread Number of threads to start. The calling thread waits for them.
+   \param[in] unused Unused ... (only used for type of the characters).
+
+   \pre [@c first, @c last) is a valid range.
+   \pre @c RandomAccessIter @c value_type is mutable.
+   \pre @c RandomAccessIter @c value_type is <a href="http://en.cppreference.com/w/cpp/concept/LessThanComparable">LessThanComparable</a>
+   \pre @c RandomAccessIter @c value_type supports the @c operator[] and @c size() of @c std::string.
+   \post The elements in the range [@c first, @c last) are sorted in ascending order.
+
+   \throws std::bad_alloc If memory for the buckets or the tasks cannot be allocated, on any thread.
+   \throws std::exception Propagates exceptions if thread creation, element swaps or iterator operations throw.
+
+   \warning Throwing an exception may cause data loss.
+   \warning Invalid arguments cause undefined behaviour.
+*/
+  template <class RandomAccessIter, class Unsigned_char_type>
+  inline void parallel_string_sort(RandomAccessIter first,
+                                   RandomAccessIter last, unsigned nthread,
+                                   Unsigned_char_type unused)
+  {
+    if (nthread < 2 || static_cast<size_t>(last - first) <
+                       2 * static_cast<size_t>(detail::min_parallel_string_sort))
+      string_sort(first, last, unused);
+    else
+      detail::parallel_string_sort(first, last, nthread, unused);
+  }
+
+/*! \brief Multi-threaded string sort algorithm using random access iterators, wraps using default of unsigned char.
+
+   \param[in] first Iterator pointer to first element.
+   \param[in] last Iterator pointing to one beyond the end of data.
+   \param[in] nthread Number of threads to use. Defaults to @c std::thread::hardware_concurrency().
+
+   \pre [@c first, @c last) is a valid range.
+   \post The elements in the range [@c first, @c last) are sorted in ascending order.
+
+   \note See the overload taking the character type for details.
+*/
+  template <class RandomAccessIter>
+  inline void parallel_string_sort(RandomAccessIter first,
+                                   RandomAccessIter last,
+                                   unsigned nthread =
+                                     std::thread::hardware_concurrency())
+  {
+    unsigned char unused = '\0';
+    parallel_string_sort(first, last, nthread, unused);
+  }
+
+/*! \brief Multi-threaded string sort algorithm using range, wraps using default of unsigned char.
+
+   \param[in] range Range [first, last) for sorting.
+   \param[in] nthread Number of threads to use. Defaults to @c std::thread::hardware_concurrency().
+
+   \pre [@c first, @c last) is a valid range.
+   \post The elements in the range [@c first, @c last) are sorted in ascending order.
+*/
+template <class Range>
+inline void parallel_string_sort(Range& range,
+                                 unsigned nthread =
+                                   std::thread::hardware_concurrency())
+{
+  parallel_string_sort(boost::begin(range), boost::end(range), nthread);
+}
+}
+}
+}
+
+#endif
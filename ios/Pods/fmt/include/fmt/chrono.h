@@ -396,6 +396,221 @@ inline std::size_t strftime(wchar_t* str, std::size_t count,
                             const wchar_t* format, const std::tm* time) {
   return std::wcsftime(str, count, format, time);
 }
+
+// Writes the date as YYYY-MM-DD and the time of day as HH:MM:SS, the way
+// %F and %T do, or returns false if strftime would write a field otherwise.
+inline bool write_timestamp_digits(int year, int month, int day, int hour,
+                                   int minute, int second, char* date,
+                                   char* time) {
+  if (year < 1000 || year > 9999 || month < 0 || month > 99 || day < 0 ||
+      day > 99 || hour < 0 || hour > 99 || minute < 0 || minute > 99 ||
+      second < 0 || second > 99) {
+    return false;
+  }
+  std::memcpy(date, data::digits + year / 100 * 2, 2);
+  std::memcpy(date + 2, data::digits + year % 100 * 2, 2);
+  date[4] = '-';
+  std::memcpy(date + 5, data::digits + month * 2, 2);
+  date[7] = '-';
+  std::memcpy(date + 8, data::digits + day * 2, 2);
+  std::memcpy(time, data::digits + hour * 2, 2);
+  time[2] = ':';
+  std::memcpy(time + 3, data::digits + minute * 2, 2);
+  time[5] = ':';
+  std::memcpy(time + 6, data::digits + second * 2, 2);
+  return true;
+}
+
+inline bool write_timestamp_digits(const std::tm& tm, char* date, char* time) {
+  return tm.tm_year <= 9999 - 1900 &&
+         write_timestamp_digits(tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday,
+                                tm.tm_hour, tm.tm_min, tm.tm_sec, date, time);
+}
+
+// A strftime format made only of %Y, %m, %d, %H, %M, %S, %F, %T, %% and
+// literal text, which is written from the digits of write_timestamp_digits
+// without calling strftime.
+template <typename Char> class timestamp_format {
+ private:
+  enum class field : unsigned char {
+    text,
+    year,
+    month,
+    day,
+    hour,
+    minute,
+    second,
+    date,
+    time
+  };
+
+  struct part {
+    field kind;
+    unsigned begin, end;  // The range of text in the format.
+  };
+
+  enum { max_parts = 16 };
+  part parts_[max_parts];
+  int num_parts_;
+  int num_seconds_;  // The number of %S and %T.
+  std::size_t size_;
+
+  bool add(field kind, std::size_t begin, std::size_t end, std::size_t size) {
+    if (num_parts_ == max_parts) return false;
+    parts_[num_parts_++] = {kind, static_cast<unsigned>(begin),
+                            static_cast<unsigned>(end)};
+    size_ += size;
+    return true;
+  }
+
+  // Replaces the parts of "%Y-%m-%d" with %F and of "%H:%M:%S" with %T, so
+  // the common formats are written with fewer, longer copies.
+  void fuse(const Char* format, field first, field second, Char separator,
+            field fused) {
+    if (num_parts_ < 5) return;
+    part* p = parts_ + num_parts_ - 5;
+    auto is_separator = [=](const part& text) {
+      return text.kind == field::text && text.end - text.begin == 1 &&
+             format[text.begin] == separator;
+    };
+    if (p[0].kind != first || p[2].kind != second || !is_separator(p[1]) ||
+        !is_separator(p[3])) {
+      return;
+    }
+    p[0] = {fused, 0, 0};
+    num_parts_ -= 4;
+  }
+
+  bool add_text(const Char* format, const Char* begin, const Char* end) {
+    return begin == end || add(field::text, to_unsigned(begin - format),
+                               to_unsigned(end - format),
+                               to_unsigned(end - begin));
+  }
+
+  bool do_parse(const Char* begin, const Char* end) {
+    const Char* text = begin;
+    for (auto p = begin; p != end;) {
+      if (*p != '%') {
+        ++p;
+        continue;
+      }
+      if (!add_text(begin, text, p) || ++p == end) return false;
+      field kind;
+      std::size_t size = 2;
+      switch (*p++) {
+      case '%':
+        text = p - 1;
+        continue;
+      case 'Y':
+        kind = field::year;
+        size = 4;
+        break;
+      case 'm':
+        kind = field::month;
+        break;
+      case 'd':
+        kind = field::day;
+        break;
+      case 'H':
+        kind = field::hour;
+        break;
+      case 'M':
+        kind = field::minute;
+        break;
+      case 'S':
+        kind = field::second;
+        ++num_seconds_;
+        break;
+      case 'F':
+        kind = field::date;
+        size = 10;
+        break;
+      case 'T':
+        kind = field::time;
+        size = 8;
+        ++num_seconds_;
+        break;
+      default:
+        return false;
+      }
+      if (!add(kind, 0, 0, size)) return false;
+      if (kind == field::day)
+        fuse(begin, field::year, field::month, '-', field::date);
+      else if (kind == field::second)
+        fuse(begin, field::hour, field::minute, ':', field::time);
+      text = p;
+    }
+    return add_text(begin, text, end);
+  }
+
+ public:
+  timestamp_format() : num_parts_(-1), num_seconds_(0), size_(0) {}
+
+  bool supported() const { return num_parts_ >= 0; }
+
+  // Parses [begin, end), which must outlive this object; leaves the format
+  // unsupported if it has other conversions or is too long.
+  void parse(const Char* begin, const Char* end) {
+    num_parts_ = 0;
+    num_seconds_ = 0;
+    size_ = 0;
+    if (to_unsigned(end - begin) > max_value<unsigned>() ||
+        !do_parse(begin, end)) {
+      num_parts_ = -1;
+    }
+  }
+
+  // Copies short runs without the call std::copy makes to memmove.
+  template <typename InputIt, typename OutputIt>
+  static OutputIt copy(InputIt begin, InputIt end, OutputIt it) {
+    for (; begin != end; ++begin) *it++ = static_cast<Char>(*begin);
+    return it;
+  }
+
+  // Writes the format with the given digits and the fractional seconds
+  // following every %S and %T.
+  template <typename OutputIt>
+  OutputIt format(OutputIt out, const Char* format, const char* date,
+                  const char* time, basic_string_view<char> fraction) const {
+    auto&& it =
+        reserve(out, size_ + to_unsigned(num_seconds_) * fraction.size());
+    for (int i = 0; i < num_parts_; ++i) {
+      const part& p = parts_[i];
+      switch (p.kind) {
+      case field::text:
+        it = copy(format + p.begin, format + p.end, it);
+        break;
+      case field::year:
+        it = copy(date, date + 4, it);
+        break;
+      case field::month:
+        it = copy(date + 5, date + 7, it);
+        break;
+      case field::day:
+        it = copy(date + 8, date + 10, it);
+        break;
+      case field::hour:
+        it = copy(time, time + 2, it);
+        break;
+      case field::minute:
+        it = copy(time + 3, time + 5, it);
+        break;
+      case field::second:
+        it = copy(time + 6, time + 8, it);
+        it = copy(fraction.begin(), fraction.end(), it);
+        break;
+      case field::date:
+        it = copy(date, date + 10, it);
+        break;
+      case field::time:
+        it = copy(time, time + 8, it);
+        it = copy(fraction.begin(), fraction.end(), it);
+        break;
+      }
+    }
+    return out;
+  }
+};
 }  // namespace internal
 
 template <typename Char> struct formatter<std::tm, Char> {
@@ -405,14 +620,32 @@ template <typename Char> struct formatter<std::tm, Char> {
     if (it != ctx.end() && *it == ':') ++it;
     auto end = it;
     while (end != ctx.end() && *end != '}') ++end;
-    tm_format.reserve(internal::to_unsigned(end - it + 1));
-    tm_format.append(it, end);
-    tm_format.push_back('\0');
+    set_format(it, end);
     return end;
   }
 
+  // Sets the format, which like the format string must outlive the calls to
+  // format.
+  void set_format(const Char* begin, const Char* end) {
+    format_str =
+        basic_string_view<Char>(begin, internal::to_unsigned(end - begin));
+    ts_format.parse(begin, end);
+    tm_format.resize(0);
+  }
+
   template <typename FormatContext>
   auto format(const std::tm& tm, FormatContext& ctx) -> decltype(ctx.out()) {
+    char date[10], time[8];
+    if (ts_format.supported() &&
+        internal::write_timestamp_digits(tm, date, time)) {
+      return ts_format.format(ctx.out(), format_str.data(), date, time, {});
+    }
+    if (tm_format.size() == 0) {
+      // strftime needs a null-terminated copy.
+      tm_format.reserve(format_str.size() + 1);
+      tm_format.append(format_str.begin(), format_str.end());
+      tm_format.push_back('\0');
+    }
     basic_memory_buffer<Char> buf;
     std::size_t start = buf.size();
     for (;;) {
@@ -436,7 +669,167 @@ template <typename Char> struct formatter<std::tm, Char> {
     return std::copy(buf.begin(), buf.end(), ctx.out());
   }
 
+  basic_string_view<Char> format_str;
   basic_memory_buffer<Char> tm_format;
+  internal::timestamp_format<Char> ts_format;
+};
+
+// Enable the per-thread cache of the last second formatted by the
+// system_clock::time_point formatter, unless explicitly disabled.
+#ifndef FMT_USE_TIMESTAMP_CACHE
+#  if FMT_HAS_FEATURE(cxx_thread_local) || FMT_GCC_VERSION >= 408 || \
+      FMT_MSC_VER >= 1900
+#    define FMT_USE_TIMESTAMP_CACHE 1
+#  else
+#    define FMT_USE_TIMESTAMP_CACHE 0
+#  endif
+#endif
+
+namespace internal {
+// The digits of a second since the epoch in UTC, if its year has four.
+struct utc_timestamp {
+  long long seconds;
+  bool valid;
+  char date[10];
+  char time[8];
+};
+
+// Computes the date of a day since the epoch in the proleptic Gregorian
+// calendar: http://howardhinnant.github.io/date_algorithms.html
+inline void civil_from_days(long long days, long long& year, int& month,
+                            int& day) {
+  days += 719468;
+  long long era = (days >= 0 ? days : days - 146096) / 146097;
+  auto day_of_era = static_cast<unsigned>(days - era * 146097);
+  unsigned year_of_era = (day_of_era - day_of_era / 1460 +
+                          day_of_era / 36524 - day_of_era / 146096) /
+                         365;
+  unsigned day_of_year =
+      day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+  unsigned shifted_month = (5 * day_of_year + 2) / 153;
+  day = static_cast<int>(day_of_year - (153 * shifted_month + 2) / 5 + 1);
+  month = static_cast<int>(shifted_month < 10 ? shifted_month + 3
+                                              : shifted_month - 9);
+  year = year_of_era + era * 400 + (month <= 2);
+}
+
+inline void compute_utc_timestamp(long long seconds, utc_timestamp& ts) {
+  ts.seconds = seconds;
+  long long days = seconds / 86400;
+  auto second_of_day = static_cast<int>(seconds % 86400);
+  if (second_of_day < 0) {
+    second_of_day += 86400;
+    --days;
+  }
+  long long year;
+  int month, day;
+  civil_from_days(days, year, month, day);
+  ts.valid = year >= 1000 && year <= 9999 &&
+             write_timestamp_digits(static_cast<int>(year), month, day,
+                                    second_of_day / 3600,
+                                    second_of_day / 60 % 60,
+                                    second_of_day % 60, ts.date, ts.time);
+}
+
+// Returns the digits of a second since the epoch; consecutive timestamps in
+// the same second only copy them.
+inline utc_timestamp get_utc_timestamp(long long seconds) {
+#if FMT_USE_TIMESTAMP_CACHE
+  // Starts out invalid, which is also right for the sentinel second.
+  static thread_local utc_timestamp cache = {
+      std::numeric_limits<long long>::min(), false, {}, {}};
+  if (cache.seconds != seconds) compute_utc_timestamp(seconds, cache);
+  return cache;
+#else
+  utc_timestamp ts;
+  compute_utc_timestamp(seconds, ts);
+  return ts;
+#endif
+}
+
+// The number of fractional digits %S writes for durations with the given
+// period: the fewest that represent it exactly, or 6 if that takes more
+// than 18, as in C++20.
+constexpr int fractional_digits(std::intmax_t num, std::intmax_t den,
+                                int n = 0) {
+  return num % den == 0
+             ? n
+             : n == 18 ? 6 : fractional_digits(num % den * 10, den, n + 1);
+}
+
+constexpr std::intmax_t power_of_10(int n) {
+  return n == 0 ? 1 : 10 * power_of_10(n - 1);
+}
+}  // namespace internal
+
+/**
+  Formats a UTC time point, ``sys_time<Duration>`` in C++20, without calling
+  ``gmtime`` or ``strftime`` for formats that only use ``%Y``, ``%m``,
+  ``%d``, ``%H``, ``%M``, ``%S``, ``%F`` and ``%T``. As in C++20, ``%S`` and
+  ``%T`` include the fractional seconds of ``Duration`` and the default
+  format is ``%F %T``::
+
+    // 2020-05-03T07:08:09.123456789Z
+    fmt::format("{:%FT%TZ}", std::chrono::system_clock::now());
+
+  Other formats go through ``gmtime`` and ``strftime`` and drop the
+  fractional seconds.
+ */
+template <typename Duration, typename Char>
+struct formatter<std::chrono::time_point<std::chrono::system_clock, Duration>,
+                 Char> {
+  template <typename ParseContext>
+  auto parse(ParseContext& ctx) -> decltype(ctx.begin()) {
+    auto it = ctx.begin();
+    if (it != ctx.end() && *it == ':') ++it;
+    auto end = it;
+    while (end != ctx.end() && *end != '}') ++end;
+    if (it == end) {
+      static const Char default_format[] = {'%', 'F', ' ', '%', 'T'};
+      tm_formatter.set_format(default_format, default_format + 5);
+    } else {
+      tm_formatter.set_format(it, end);
+    }
+    return end;
+  }
+
+  template <typename FormatContext>
+  auto format(const std::chrono::time_point<std::chrono::system_clock,
+                                            Duration>& tp,
+              FormatContext& ctx) -> decltype(ctx.out()) {
+    using std::chrono::duration_cast;
+    auto d = tp.time_since_epoch();
+    auto seconds = duration_cast<std::chrono::seconds>(d);
+    if (seconds > d) seconds -= std::chrono::seconds(1);
+    if (tm_formatter.ts_format.supported()) {
+      internal::utc_timestamp ts =
+          internal::get_utc_timestamp(static_cast<long long>(seconds.count()));
+      if (ts.valid) {
+        enum {
+          num_digits = internal::fractional_digits(Duration::period::num,
+                                                   Duration::period::den)
+        };
+        char fraction[num_digits + 1];
+        if (num_digits != 0) {
+          using subseconds = std::chrono::duration<
+              long long, std::ratio<1, internal::power_of_10(num_digits)>>;
+          auto n = duration_cast<subseconds>(d - seconds).count();
+          fraction[0] = '.';
+          for (int i = num_digits; i > 0; --i, n /= 10)
+            fraction[i] = static_cast<char>('0' + n % 10);
+        }
+        return tm_formatter.ts_format.format(
+            ctx.out(), tm_formatter.format_str.data(), ts.date, ts.time,
+            {fraction, num_digits != 0 ? num_digits + 1 : 0});
+      }
+    }
+    auto time = static_cast<std::time_t>(seconds.count());
+    if (static_cast<long long>(time) != seconds.count())
+      FMT_THROW(format_error("time_t value out of range"));
+    return tm_formatter.format(gmtime(time), ctx);
+  }
+
+  formatter<std::tm, Char> tm_formatter;
 };
 
 namespace internal {
@@ -634,28 +1027,29 @@ FMT_CONSTEXPR const Char* parse_chrono_format(const Char* begin,
 struct chrono_format_checker {
   FMT_NORETURN void report_no_date() { FMT_THROW(format_error("no date")); }
 
-  template <typename Char> void on_text(const Char*, const Char*) {}
+  template <typename Char>
+  FMT_CONSTEXPR void on_text(const Char*, const Char*) {}
   FMT_NORETURN void on_abbr_weekday() { report_no_date(); }
   FMT_NORETURN void on_full_weekday() { report_no_date(); }
   FMT_NORETURN void on_dec0_weekday(numeric_system) { report_no_date(); }
   FMT_NORETURN void on_dec1_weekday(numeric_system) { report_no_date(); }
   FMT_NORETURN void on_abbr_month() { report_no_date(); }
   FMT_NORETURN void on_full_month() { report_no_date(); }
-  void on_24_hour(numeric_system) {}
-  void on_12_hour(numeric_system) {}
-  void on_minute(numeric_system) {}
-  void on_second(numeric_system) {}
+  FMT_CONSTEXPR void on_24_hour(numeric_system) {}
+  FMT_CONSTEXPR void on_12_hour(numeric_system) {}
+  FMT_CONSTEXPR void on_minute(numeric_system) {}
+  FMT_CONSTEXPR void on_second(numeric_system) {}
   FMT_NORETURN void on_datetime(numeric_system) { report_no_date(); }
   FMT_NORETURN void on_loc_date(numeric_system) { report_no_date(); }
   FMT_NORETURN void on_loc_time(numeric_system) { report_no_date(); }
   FMT_NORETURN void on_us_date() { report_no_date(); }
   FMT_NORETURN void on_iso_date() { report_no_date(); }
-  void on_12_hour_time() {}
-  void on_24_hour_time() {}
-  void on_iso_time() {}
-  void on_am_pm() {}
-  void on_duration_value() {}
-  void on_duration_unit() {}
+  FMT_CONSTEXPR void on_12_hour_time() {}
+  FMT_CONSTEXPR void on_24_hour_time() {}
+  FMT_CONSTEXPR void on_iso_time() {}
+  FMT_CONSTEXPR void on_am_pm() {}
+  FMT_CONSTEXPR void on_duration_value() {}
+  FMT_CONSTEXPR void on_duration_unit() {}
   FMT_NORETURN void on_utc_offset() { report_no_date(); }
   FMT_NORETURN void on_tz_name() { report_no_date(); }
 };
@@ -1014,7 +1408,7 @@ struct formatter<std::chrono::duration<Rep, Period>, Char> {
   using arg_ref_type = internal::arg_ref<Char>;
   arg_ref_type width_ref;
   arg_ref_type precision_ref;
-  mutable basic_string_view<Char> format_str;
+  basic_string_view<Char> format_str;
   using duration = std::chrono::duration<Rep, Period>;
 
   struct spec_handler {
@@ -1037,17 +1431,19 @@ struct formatter<std::chrono::duration<Rep, Period>, Char> {
     }
 
     void on_error(const char* msg) { FMT_THROW(format_error(msg)); }
-    void on_fill(basic_string_view<Char> fill) { f.specs.fill = fill; }
-    void on_align(align_t align) { f.specs.align = align; }
-    void on_width(int width) { f.specs.width = width; }
-    void on_precision(int _precision) { f.precision = _precision; }
-    void end_precision() {}
+    FMT_CONSTEXPR void on_fill(basic_string_view<Char> fill) {
+      f.specs.fill = fill;
+    }
+    FMT_CONSTEXPR void on_align(align_t align) { f.specs.align = align; }
+    FMT_CONSTEXPR void on_width(int width) { f.specs.width = width; }
+    FMT_CONSTEXPR void on_precision(int _precision) { f.precision = _precision; }
+    FMT_CONSTEXPR void end_precision() {}
 
-    template <typename Id> void on_dynamic_width(Id arg_id) {
+    template <typename Id> FMT_CONSTEXPR void on_dynamic_width(Id arg_id) {
       f.width_ref = make_arg_ref(arg_id);
     }
 
-    template <typename Id> void on_dynamic_precision(Id arg_id) {
+    template <typename Id> FMT_CONSTEXPR void on_dynamic_precision(Id arg_id) {
       f.precision_ref = make_arg_ref(arg_id);
     }
   };
@@ -1077,7 +1473,7 @@ struct formatter<std::chrono::duration<Rep, Period>, Char> {
   }
 
  public:
-  formatter() : precision(-1) {}
+  FMT_CONSTEXPR formatter() : precision(-1) {}
 
   FMT_CONSTEXPR auto parse(basic_format_parse_context<Char>& ctx)
       -> decltype(ctx.begin()) {
@@ -55,6 +55,37 @@ template <typename Char> struct format_part {
   }
 };
 
+// Returns a pointer to the brace that ends the format specs at begin.
+template <typename Char>
+FMT_CONSTEXPR const Char* skip_format_specs(const Char* begin,
+                                            const Char* end) {
+  // Find the matching brace.
+  unsigned brace_counter = 0;
+  for (; begin != end; ++begin) {
+    if (*begin == '{') {
+      ++brace_counter;
+    } else if (*begin == '}') {
+      if (brace_counter == 0u) break;
+      --brace_counter;
+    }
+  }
+  return begin;
+}
+
+// Returns a mask with bit i set if argument i is of a type with a
+// user-defined formatter, which parses its own format specs.
+template <typename Context> constexpr unsigned long long custom_arg_mask() {
+  return 0;
+}
+
+template <typename Context, typename Arg, typename... Args>
+constexpr unsigned long long custom_arg_mask() {
+  return (mapped_type_constant<Arg, Context>::value == type::custom_type
+              ? 1ull
+              : 0ull) |
+         (custom_arg_mask<Context, Args...>() << 1);
+}
+
 template <typename Char> struct part_counter {
   unsigned num_parts = 0;
 
@@ -70,17 +101,7 @@ template <typename Char> struct part_counter {
 
   FMT_CONSTEXPR const Char* on_format_specs(const Char* begin,
                                             const Char* end) {
-    // Find the matching brace.
-    unsigned brace_counter = 0;
-    for (; begin != end; ++begin) {
-      if (*begin == '{') {
-        ++brace_counter;
-      } else if (*begin == '}') {
-        if (brace_counter == 0u) break;
-        --brace_counter;
-      }
-    }
-    return begin;
+    return skip_format_specs(begin, end);
   }
 
   FMT_CONSTEXPR void on_error(const char*) {}
@@ -103,13 +124,16 @@ class format_string_compiler : public error_handler {
   part part_;
   basic_string_view<Char> format_str_;
   basic_format_parse_context<Char> parse_context_;
+  unsigned long long custom_args_;
 
  public:
   FMT_CONSTEXPR format_string_compiler(basic_string_view<Char> format_str,
-                                       PartHandler handler)
+                                       PartHandler handler,
+                                       unsigned long long custom_args)
       : handler_(handler),
         format_str_(format_str),
-        parse_context_(format_str) {}
+        parse_context_(format_str),
+        custom_args_(custom_args) {}
 
   FMT_CONSTEXPR void on_text(const Char* begin, const Char* end) {
     if (begin != end)
@@ -136,6 +160,16 @@ class format_string_compiler : public error_handler {
 
   FMT_CONSTEXPR const Char* on_format_specs(const Char* begin,
                                             const Char* end) {
+    if (part_.part_kind == part::kind::arg_index &&
+        part_.val.arg_index < 64 &&
+        ((custom_args_ >> part_.val.arg_index) & 1) != 0) {
+      // Leave the specs to the formatter of the argument.
+      auto it = skip_format_specs(begin, end);
+      if (it == end) on_error("missing '}' in format string");
+      part_.arg_id_end = begin;
+      handler_(part_);
+      return it;
+    }
     auto repl = typename part::replacement();
     dynamic_specs_handler<basic_format_parse_context<Char>> handler(
         repl.specs, parse_context_);
@@ -152,12 +186,14 @@ class format_string_compiler : public error_handler {
 };
 
 // Compiles a format string and invokes handler(part) for each parsed part.
+// Bit i of custom_args is set if argument i has a user-defined formatter.
 template <bool IS_CONSTEXPR, typename Char, typename PartHandler>
 FMT_CONSTEXPR void compile_format_string(basic_string_view<Char> format_str,
-                                         PartHandler handler) {
+                                         PartHandler handler,
+                                         unsigned long long custom_args = 0) {
   parse_format_string<IS_CONSTEXPR>(
-      format_str,
-      format_string_compiler<Char, PartHandler>(format_str, handler));
+      format_str, format_string_compiler<Char, PartHandler>(format_str, handler,
+                                                            custom_args));
 }
 
 template <typename Range, typename Context, typename Id>
@@ -225,8 +261,8 @@ auto vformat_to(Range out, CompiledFormat& cf, basic_format_args<Context> args)
       if (specs.precision >= 0) checker.check_precision();
 
       advance_to(parse_ctx, part.arg_id_end);
-      ctx.advance_to(
-          visit_format_arg(arg_formatter<Range>(ctx, nullptr, &specs), arg));
+      ctx.advance_to(visit_format_arg(
+          arg_formatter<Range>(ctx, &parse_ctx, &specs), arg));
       break;
     }
     }
@@ -237,7 +273,7 @@ auto vformat_to(Range out, CompiledFormat& cf, basic_format_args<Context> args)
 
 struct basic_compiled_format {};
 
-template <typename S, typename = void>
+template <typename S, unsigned long long CUSTOM_ARGS, typename = void>
 struct compiled_format_base : basic_compiled_format {
   using char_type = char_t<S>;
   using parts_container = std::vector<internal::format_part<char_type>>;
@@ -248,7 +284,8 @@ struct compiled_format_base : basic_compiled_format {
     compile_format_string<false>(format_str,
                                  [this](const format_part<char_type>& part) {
                                    compiled_parts.push_back(part);
-                                 });
+                                 },
+                                 CUSTOM_ARGS);
   }
 
   const parts_container& parts() const { return compiled_parts; }
@@ -261,7 +298,7 @@ template <typename Char, unsigned N> struct format_part_array {
 
 template <typename Char, unsigned N>
 FMT_CONSTEXPR format_part_array<Char, N> compile_to_parts(
-    basic_string_view<Char> format_str) {
+    basic_string_view<Char> format_str, unsigned long long custom_args) {
   format_part_array<Char, N> parts;
   unsigned counter = 0;
   // This is not a lambda for compatibility with older compilers.
@@ -272,7 +309,7 @@ FMT_CONSTEXPR format_part_array<Char, N> compile_to_parts(
       parts[(*counter)++] = part;
     }
   } collector{parts.data, &counter};
-  compile_format_string<true>(format_str, collector);
+  compile_format_string<true>(format_str, collector, custom_args);
   if (counter < N) {
     parts.data[counter] =
         format_part<Char>::make_text(basic_string_view<Char>());
@@ -284,8 +321,9 @@ template <typename T> constexpr const T& constexpr_max(const T& a, const T& b) {
   return (a < b) ? b : a;
 }
 
-template <typename S>
-struct compiled_format_base<S, enable_if_t<is_compile_string<S>::value>>
+template <typename S, unsigned long long CUSTOM_ARGS>
+struct compiled_format_base<S, CUSTOM_ARGS,
+                            enable_if_t<is_compile_string<S>::value>>
     : basic_compiled_format {
   using char_type = char_t<S>;
 
@@ -305,15 +343,20 @@ struct compiled_format_base<S, enable_if_t<is_compile_string<S>::value>>
   const parts_container& parts() const {
     static FMT_CONSTEXPR_DECL const auto compiled_parts =
         compile_to_parts<char_type, num_format_parts>(
-            internal::to_string_view(S()));
+            internal::to_string_view(S()), CUSTOM_ARGS);
     return compiled_parts.data;
   }
 };
 
 template <typename S, typename... Args>
-class compiled_format : private compiled_format_base<S> {
+using compiled_format_base_t =
+    compiled_format_base<S, custom_arg_mask<buffer_context<char_t<S>>,
+                                            Args...>()>;
+
+template <typename S, typename... Args>
+class compiled_format : private compiled_format_base_t<S, Args...> {
  public:
-  using typename compiled_format_base<S>::char_type;
+  using typename compiled_format_base_t<S, Args...>::char_type;
 
  private:
   basic_string_view<char_type> format_str_;
@@ -326,9 +369,20 @@ class compiled_format : private compiled_format_base<S> {
  public:
   compiled_format() = delete;
   explicit constexpr compiled_format(basic_string_view<char_type> format_str)
-      : compiled_format_base<S>(format_str), format_str_(format_str) {}
+      : compiled_format_base_t<S, Args...>(format_str),
+        format_str_(format_str) {}
 };
 
+// Whether T is a format string compiled into a tree of parts such as text
+// and field, see compile_format_string below.
+template <typename T> struct is_compiled_format : std::false_type {};
+
+// Whether T is the result of compile().
+template <typename T>
+struct is_compiled
+    : bool_constant<std::is_base_of<basic_compiled_format, T>::value ||
+                    is_compiled_format<T>::value> {};
+
 #ifdef __cpp_if_constexpr
 template <typename... Args> struct type_list {};
 
@@ -351,16 +405,15 @@ template <int N, typename... Args> struct get_type_impl<N, type_list<Args...>> {
 template <int N, typename T>
 using get_type = typename get_type_impl<N, T>::type;
 
-template <typename T> struct is_compiled_format : std::false_type {};
-
 template <typename Char> struct text {
   basic_string_view<Char> data;
   using char_type = Char;
 
   template <typename OutputIt, typename... Args>
   OutputIt format(OutputIt out, const Args&...) const {
-    // TODO: reserve
-    return copy_str<Char>(data.begin(), data.end(), out);
+    auto&& it = reserve(out, data.size());
+    it = copy_str<Char>(data.begin(), data.end(), it);
+    return out;
   }
 };
 
@@ -374,11 +427,13 @@ constexpr text<Char> make_text(basic_string_view<Char> s, size_t pos,
 }
 
 template <typename Char, typename OutputIt, typename T,
-          std::enable_if_t<std::is_integral_v<T>, int> = 0>
+          std::enable_if_t<std::is_integral_v<T> && !is_char<T>::value,
+                           int> = 0>
 OutputIt format_default(OutputIt out, T value) {
-  // TODO: reserve
   format_int fi(value);
-  return std::copy(fi.data(), fi.data() + fi.size(), out);
+  auto&& it = reserve(out, fi.size());
+  it = std::copy(fi.data(), fi.data() + fi.size(), it);
+  return out;
 }
 
 template <typename Char, typename OutputIt>
@@ -415,6 +470,115 @@ template <typename Char, typename T, int N> struct field {
 template <typename Char, typename T, int N>
 struct is_compiled_format<field<Char, T, N>> : std::true_type {};
 
+// Whether a replacement field without format specs for an argument of type T
+// can be written with format_default.
+template <typename Char, typename T>
+using has_format_default = bool_constant<
+    (std::is_integral<T>::value && !std::is_same<T, bool>::value &&
+     !is_char<T>::value) ||
+    std::is_same<T, Char>::value || std::is_same<T, const Char*>::value>;
+
+template <typename OutputIt, typename Char, typename T, typename... Args>
+OutputIt format_with(formatter<T, Char>& f, OutputIt out, const T& arg,
+                     const Args&... args) {
+  using context = basic_format_context<OutputIt, Char>;
+  // The arguments are only used for dynamic width and precision.
+  auto store = make_format_args<context>(args...);
+  context ctx(out, basic_format_args<context>(store));
+  return f.format(arg, ctx);
+}
+
+// A replacement field that refers to argument N and is formatted with
+// formatter<T, Char>, which has parsed the format specs at compile time.
+template <typename Char, typename T, int N> struct spec_field {
+  using char_type = Char;
+  mutable formatter<T, Char> fmt;
+
+  template <typename OutputIt, typename... Args>
+  OutputIt format(OutputIt out, const Args&... args) const {
+    const T& arg = get<N>(args...);
+    return format_with(fmt, out, arg, args...);
+  }
+};
+
+template <typename Char, typename T, int N>
+struct is_compiled_format<spec_field<Char, T, N>> : std::true_type {};
+
+// A replacement field that refers to argument N and is formatted with
+// formatter<T, Char>, for formatters that cannot parse at compile time such as
+// the one for std::tm. The specs, which end with the closing '}', are parsed
+// on each call; the format string is still scanned only once.
+template <typename Char, typename T, int N> struct runtime_spec_field {
+  using char_type = Char;
+  basic_string_view<Char> specs;
+
+  template <typename OutputIt, typename... Args>
+  OutputIt format(OutputIt out, const Args&... args) const {
+    const T& arg = get<N>(args...);
+    formatter<T, Char> fmt;
+    basic_format_parse_context<Char> parse_ctx(specs);
+    fmt.parse(parse_ctx);
+    return format_with(fmt, out, arg, args...);
+  }
+};
+
+template <typename Char, typename T, int N>
+struct is_compiled_format<runtime_spec_field<Char, T, N>> : std::true_type {};
+
+template <typename T, typename Char> struct parse_specs_result {
+  formatter<T, Char> fmt;
+  size_t end;
+  int next_arg_id;
+};
+
+// Parses the format specs of argument ID starting at pos with
+// formatter<T, Char>. The result's end is the position of the closing '}'.
+template <typename T, typename Char>
+constexpr parse_specs_result<T, Char> parse_specs(basic_string_view<Char> str,
+                                                  size_t pos, int arg_id) {
+  str.remove_prefix(pos);
+  auto ctx = basic_format_parse_context<Char>(str);
+  // Skip the ids of this and the preceding arguments so that nested
+  // replacement fields get the right ones.
+  for (int i = 0; i <= arg_id; ++i) ctx.next_arg_id();
+  auto f = formatter<T, Char>();
+  auto end = f.parse(ctx);
+  return {f, pos + to_unsigned(end - str.data()), ctx.next_arg_id()};
+}
+
+template <typename T, typename S, size_t POS, int ID, typename = void>
+struct is_constexpr_parse : std::false_type {};
+
+template <typename T, typename S, size_t POS, int ID>
+struct is_constexpr_parse<
+    T, S, POS, ID,
+    void_t<std::integral_constant<
+        size_t, parse_specs<T>(basic_string_view<typename S::char_type>(S()),
+                               POS, ID)
+                    .end>>> : std::true_type {};
+
+// Whether formatter<T> can parse the specs at POS in the format string S at
+// compile time. It cannot if the formatter is not a literal type or its parse
+// function is not constexpr.
+template <typename T, typename S, size_t POS, int ID,
+          typename F = formatter<T, typename S::char_type>>
+using has_constexpr_parse = typename std::conditional<
+    std::is_trivially_destructible<F>::value &&
+        std::is_copy_constructible<F>::value,
+    is_constexpr_parse<T, S, POS, ID>, std::false_type>::type;
+
+// Returns the position of the '}' that ends the format specs starting at
+// pos, or str.size() if there is none or the specs contain nested
+// replacement fields.
+template <typename Char>
+constexpr size_t find_specs_end(basic_string_view<Char> str, size_t pos) {
+  for (size_t size = str.size(); pos != size; ++pos) {
+    if (str[pos] == '}') return pos;
+    if (str[pos] == '{') break;
+  }
+  return str.size();
+}
+
 template <typename L, typename R> struct concat {
   L lhs;
   R rhs;
@@ -448,6 +612,11 @@ constexpr size_t parse_text(basic_string_view<Char> str, size_t pos) {
 template <typename Args, size_t POS, int ID, typename S>
 constexpr auto compile_format_string(S format_str);
 
+// Compiles a replacement field for argument ID whose format specs, possibly
+// empty, start at POS.
+template <typename Args, size_t POS, int ID, typename S>
+constexpr auto compile_spec_field(S format_str);
+
 template <typename Args, size_t POS, int ID, typename T, typename S>
 constexpr auto parse_tail(T head, S format_str) {
   if constexpr (POS != to_string_view(format_str).size()) {
@@ -473,14 +642,16 @@ constexpr auto compile_format_string(S format_str) {
       throw format_error("unmatched '{' in format string");
     if constexpr (str[POS + 1] == '{') {
       return parse_tail<Args, POS + 2, ID>(make_text(str, POS, 1), format_str);
-    } else if constexpr (str[POS + 1] == '}') {
+    } else if constexpr (str[POS + 1] == '}' &&
+                         has_format_default<char_type,
+                                            get_type<ID, Args>>::value) {
       using type = get_type<ID, Args>;
-      if constexpr (std::is_same<type, int>::value) {
-        return parse_tail<Args, POS + 2, ID + 1>(field<char_type, type, ID>(),
-                                                 format_str);
-      } else {
-        return unknown_format();
-      }
+      return parse_tail<Args, POS + 2, ID + 1>(field<char_type, type, ID>(),
+                                               format_str);
+    } else if constexpr (str[POS + 1] == '}') {
+      return compile_spec_field<Args, POS + 1, ID>(format_str);
+    } else if constexpr (str[POS + 1] == ':') {
+      return compile_spec_field<Args, POS + 2, ID>(format_str);
     } else {
       return unknown_format();
     }
@@ -494,6 +665,30 @@ constexpr auto compile_format_string(S format_str) {
                                      format_str);
   }
 }
+
+template <typename Args, size_t POS, int ID, typename S>
+constexpr auto compile_spec_field(S format_str) {
+  using char_type = typename S::char_type;
+  using type = get_type<ID, Args>;
+  constexpr basic_string_view<char_type> str = format_str;
+  if constexpr (has_constexpr_parse<type, S, POS, ID>::value) {
+    constexpr auto result = parse_specs<type>(str, POS, ID);
+    if (result.end >= str.size() || str[result.end] != '}')
+      throw format_error("missing '}' in format string");
+    return parse_tail<Args, result.end + 1, result.next_arg_id>(
+        spec_field<char_type, type, ID>{result.fmt}, format_str);
+  } else {
+    constexpr auto end = find_specs_end(str, POS);
+    if constexpr (end == str.size()) {
+      return unknown_format();
+    } else {
+      return parse_tail<Args, end + 1, ID + 1>(
+          runtime_spec_field<char_type, type, ID>{
+              basic_string_view<char_type>(&str[POS], end + 1 - POS)},
+          format_str);
+    }
+  }
+}
 #endif  // __cpp_if_constexpr
 }  // namespace internal
 
@@ -523,7 +718,8 @@ template <typename CompiledFormat, typename... Args,
           FMT_ENABLE_IF(internal::is_compiled_format<CompiledFormat>::value)>
 std::basic_string<Char> format(const CompiledFormat& cf, const Args&... args) {
   basic_memory_buffer<Char> buffer;
-  cf.format(std::back_inserter(buffer), args...);
+  internal::buffer<Char>& base = buffer;
+  cf.format(std::back_inserter(base), args...);
   return to_string(buffer);
 }
 
@@ -576,20 +772,92 @@ OutputIt format_to(OutputIt out, const CompiledFormat& cf,
 }
 
 template <typename OutputIt, typename CompiledFormat, typename... Args,
-          FMT_ENABLE_IF(internal::is_output_iterator<OutputIt>::value)>
+          FMT_ENABLE_IF(internal::is_output_iterator<OutputIt>::value&&
+                            internal::is_compiled<CompiledFormat>::value)>
 format_to_n_result<OutputIt> format_to_n(OutputIt out, size_t n,
                                          const CompiledFormat& cf,
                                          const Args&... args) {
-  auto it =
-      format_to(internal::truncating_iterator<OutputIt>(out, n), cf, args...);
-  return {it.base(), it.count()};
+  // Formatting into a buffer and copying its head is faster than writing
+  // through a truncating_iterator one character at a time.
+  using char_type = typename CompiledFormat::char_type;
+  basic_memory_buffer<char_type> buffer;
+  internal::buffer<char_type>& base = buffer;
+  format_to(std::back_inserter(base), cf, args...);
+  size_t size = buffer.size();
+  out = std::copy_n(buffer.data(), size < n ? size : n, out);
+  return {out, size};
 }
 
-template <typename CompiledFormat, typename... Args>
+template <typename CompiledFormat, typename... Args,
+          FMT_ENABLE_IF(internal::is_compiled<CompiledFormat>::value)>
 std::size_t formatted_size(const CompiledFormat& cf, const Args&... args) {
   return format_to(internal::counting_iterator(), cf, args...).count();
 }
 
+#if FMT_USE_CONSTEXPR && defined(__cpp_if_constexpr)
+namespace internal {
+// A format string marked with FMT_COMPILE.
+template <typename S> struct compiled_string {
+  using char_type = typename S::char_type;
+  using format_string = S;
+};
+
+template <typename T> struct is_compiled_string : std::false_type {};
+
+template <typename S>
+struct is_compiled_string<compiled_string<S>> : std::true_type {};
+
+template <typename S> constexpr compiled_string<S> make_compiled_string(S) {
+  return {};
+}
+}  // namespace internal
+
+template <typename S, typename... Args,
+          FMT_ENABLE_IF(internal::is_compiled_string<S>::value)>
+std::basic_string<typename S::char_type> format(const S&,
+                                                const Args&... args) {
+  constexpr auto cf = compile<Args...>(typename S::format_string());
+  return format(cf, args...);
+}
+
+template <typename OutputIt, typename S, typename... Args,
+          FMT_ENABLE_IF(internal::is_compiled_string<S>::value)>
+OutputIt format_to(OutputIt out, const S&, const Args&... args) {
+  constexpr auto cf = compile<Args...>(typename S::format_string());
+  return format_to(out, cf, args...);
+}
+
+template <typename OutputIt, typename S, typename... Args,
+          FMT_ENABLE_IF(internal::is_output_iterator<OutputIt>::value&&
+                            internal::is_compiled_string<S>::value)>
+format_to_n_result<OutputIt> format_to_n(OutputIt out, size_t n, const S&,
+                                         const Args&... args) {
+  constexpr auto cf = compile<Args...>(typename S::format_string());
+  return format_to_n(out, n, cf, args...);
+}
+
+template <typename S, typename... Args,
+          FMT_ENABLE_IF(internal::is_compiled_string<S>::value)>
+std::size_t formatted_size(const S&, const Args&... args) {
+  constexpr auto cf = compile<Args...>(typename S::format_string());
+  return formatted_size(cf, args...);
+}
+
+/**
+  \rst
+  Constructs a format string that is compiled for the argument types it is
+  used with, as with ``fmt::compile<Args...>``, where it is used.
+
+  **Example**::
+
+    std::string s = fmt::format(FMT_COMPILE("{:>8}|{}"), 42, "abc");
+  \endrst
+ */
+#  define FMT_COMPILE(s) fmt::internal::make_compiled_string(FMT_STRING(s))
+#else
+#  define FMT_COMPILE(s) FMT_STRING(s)
+#endif
+
 FMT_END_NAMESPACE
 
 #endif  // FMT_COMPILE_H_
@@ -37,6 +37,27 @@
 #  define FMT_USE_FCNTL 0
 #endif
 
+// The buffered output file writes with writev, so it needs POSIX.
+#ifndef FMT_USE_WRITEV
+#  if FMT_USE_FCNTL && FMT_HAS_INCLUDE("sys/uio.h") && \
+      FMT_HAS_INCLUDE("unistd.h")
+#    define FMT_USE_WRITEV 1
+#  else
+#    define FMT_USE_WRITEV 0
+#  endif
+#endif
+#if FMT_USE_WRITEV
+#  include <limits.h>   // for IOV_MAX
+#  include <sys/uio.h>  // for writev
+#  include <unistd.h>   // for sysconf
+
+#  include <condition_variable>
+#  include <memory>
+#  include <mutex>
+#  include <thread>
+#  include <vector>
+#endif
+
 #ifndef FMT_POSIX
 #  if defined(_WIN32) && !defined(__MINGW32__)
 // Fix warnings about deprecated symbols.
@@ -343,6 +364,400 @@ class file {
 long getpagesize();
 #endif  // FMT_USE_FCNTL
 
+#if FMT_USE_WRITEV
+/** Parameters of an output file opened with `fmt::output_file`. */
+struct ostream_params {
+  // Flags passed to open.
+  int oflag = FMT_POSIX(O_WRONLY) | FMT_POSIX(O_CREAT) | FMT_POSIX(O_TRUNC);
+
+  // The size of the output buffer, rounded up to whole pages.
+  std::size_t buffer_size = 65536;
+
+  // The buffer is written once it holds this many bytes. With 0 it is
+  // written once the largest print so far might not fit in the rest of it.
+  std::size_t flush_threshold = 0;
+
+  // Hands full buffers to a thread that writes them, so that printing only
+  // waits for the disk when all the buffers are in flight.
+  bool background_writer = false;
+
+  // The number of buffers in flight with a background writer.
+  std::size_t max_pending_buffers = 4;
+};
+
+namespace internal {
+inline std::size_t page_size() {
+  long size = FMT_POSIX_CALL(sysconf(_SC_PAGESIZE));
+  return size > 0 ? static_cast<std::size_t>(size) : 4096;
+}
+
+inline std::size_t round_up_to_pages(std::size_t size) {
+  std::size_t page = page_size();
+  return size == 0 ? page : (size + page - 1) / page * page;
+}
+
+inline char* allocate_pages(std::size_t size) {
+  void* p = nullptr;
+  if (FMT_SYSTEM(posix_memalign(&p, page_size(), size)) != 0)
+    FMT_THROW(std::bad_alloc());
+  return static_cast<char*>(p);
+}
+
+// The number of buffers written with one writev call.
+#  if defined(IOV_MAX) && IOV_MAX < 64
+enum { max_iovecs = IOV_MAX };
+#  else
+enum { max_iovecs = 64 };
+#  endif
+
+// Writes iov[0, count), retrying partial writes, and returns false with
+// errno set on error.
+inline bool write_all(int fd, iovec* iov, int count) {
+  while (count > 0) {
+    ssize_t result = 0;
+    FMT_RETRY(result, FMT_POSIX_CALL(writev(fd, iov, count)));
+    if (result < 0) return false;
+    auto written = static_cast<std::size_t>(result);
+    while (count > 0 && written >= iov->iov_len) {
+      written -= iov->iov_len;
+      ++iov;
+      --count;
+    }
+    if (count > 0) {
+      iov->iov_base = static_cast<char*>(iov->iov_base) + written;
+      iov->iov_len -= written;
+    }
+  }
+  return true;
+}
+
+// Writes the buffers handed to it on a thread of its own, batching all the
+// queued ones into one writev call.
+class background_writer {
+ public:
+  struct chunk {
+    char* data;
+    std::size_t size;
+    std::size_t capacity;
+  };
+
+ private:
+  int fd_;
+  std::size_t max_chunks_;
+  std::size_t num_chunks_;  // Including the one being filled.
+  std::mutex mutex_;
+  std::condition_variable queued_cond_;
+  std::condition_variable written_cond_;
+  std::vector<chunk> queued_;
+  std::vector<chunk> free_;
+  bool writing_;
+  bool stop_;
+  int error_;
+  std::thread thread_;
+
+  void run() {
+    std::vector<chunk> batch;
+    iovec iov[max_iovecs];
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+      queued_cond_.wait(lock, [this] { return stop_ || !queued_.empty(); });
+      if (queued_.empty()) return;
+      batch.swap(queued_);
+      writing_ = true;
+      bool failed = error_ != 0;
+      lock.unlock();
+      int error = 0;
+      for (std::size_t i = 0; i < batch.size() && !failed; i += max_iovecs) {
+        int count = 0;
+        for (std::size_t j = i; j < batch.size() && count < max_iovecs; ++j) {
+          iov[count].iov_base = batch[j].data;
+          iov[count++].iov_len = batch[j].size;
+        }
+        if (!write_all(fd_, iov, count)) {
+          error = errno;
+          failed = true;
+        }
+      }
+      lock.lock();
+      if (error_ == 0) error_ = error;
+      free_.insert(free_.end(), batch.begin(), batch.end());
+      batch.clear();
+      writing_ = false;
+      written_cond_.notify_all();
+    }
+  }
+
+ public:
+  background_writer(int fd, std::size_t max_chunks)
+      : fd_(fd),
+        max_chunks_(max_chunks > 1 ? max_chunks : 2),
+        num_chunks_(1),
+        writing_(false),
+        stop_(false),
+        error_(0),
+        thread_([this] { run(); }) {}
+
+  background_writer(const background_writer&) = delete;
+  void operator=(const background_writer&) = delete;
+
+  // Writes what is queued and frees the buffers.
+  ~background_writer() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    queued_cond_.notify_one();
+    thread_.join();
+    for (const chunk& c : free_) std::free(c.data);
+  }
+
+  // Queues a full buffer and returns an empty one, waiting for one to be
+  // written if max_chunks are in flight.
+  chunk exchange(chunk full, std::size_t capacity) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    queued_.push_back(full);
+    queued_cond_.notify_one();
+    if (free_.empty() && num_chunks_ < max_chunks_) {
+      ++num_chunks_;
+      lock.unlock();
+      return {allocate_pages(capacity), 0, capacity};
+    }
+    written_cond_.wait(lock, [this] { return !free_.empty(); });
+    chunk c = free_.back();
+    free_.pop_back();
+    return c;
+  }
+
+  // Queues the last buffer, or frees it if it is empty.
+  void release(chunk last) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (last.size != 0) {
+      queued_.push_back(last);
+      queued_cond_.notify_one();
+    } else {
+      free_.push_back(last);
+    }
+  }
+
+  // Returns the first write error, or 0.
+  int error() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return error_;
+  }
+
+  // Waits until everything queued is written and returns the first write
+  // error, or 0.
+  int wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    written_cond_.wait(lock, [this] { return queued_.empty() && !writing_; });
+    return error_;
+  }
+};
+}  // namespace internal
+
+/**
+  \rst
+  An output file that formats straight into a page-aligned buffer and
+  writes it with few, large ``writev`` calls. Unlike ``fmt::print(FILE*)``
+  it takes no locks, so an object must only be used by one thread at a time.
+  Once a write has thrown, what is still buffered is discarded when the file
+  is closed.
+  \endrst
+ */
+class ostream : private internal::buffer<char> {
+ private:
+  int fd_;
+  std::size_t buffer_size_;
+  std::size_t flush_threshold_;
+  std::size_t max_print_size_;
+  // Set once a write error has been thrown, so that close() and the
+  // destructor neither write the buffer again nor report the error twice.
+  bool failed_;
+  std::unique_ptr<internal::background_writer> writer_;
+
+  ostream(cstring_view path, const ostream_params& params)
+      : fd_(-1),
+        buffer_size_(internal::round_up_to_pages(params.buffer_size)),
+        flush_threshold_(params.flush_threshold < buffer_size_
+                             ? params.flush_threshold
+                             : buffer_size_),
+        max_print_size_(0),
+        failed_(false) {
+    char* data = internal::allocate_pages(buffer_size_);
+    FMT_RETRY(fd_, FMT_POSIX_CALL(open(path.c_str(), params.oflag, 0666)));
+    if (fd_ == -1) {
+      std::free(data);
+      FMT_THROW(system_error(errno, "cannot open file {}", path.c_str()));
+    }
+    set(data, buffer_size_);
+    if (params.background_writer) {
+      writer_.reset(
+          new internal::background_writer(fd_, params.max_pending_buffers));
+    }
+  }
+
+  void grow(std::size_t capacity) FMT_OVERRIDE {
+    std::size_t old_capacity = this->capacity();
+    std::size_t new_capacity = internal::round_up_to_pages(
+        capacity > old_capacity * 2 ? capacity : old_capacity * 2);
+    char* new_data = internal::allocate_pages(new_capacity);
+    std::memcpy(new_data, data(), size());
+    std::free(data());
+    set(new_data, new_capacity);
+  }
+
+  void report_write_error(int error_code) {
+    failed_ = true;
+    FMT_THROW(system_error(error_code, "cannot write to file"));
+  }
+
+  // Writes the buffer or, with a background writer, queues it.
+  void flush_buffer() {
+    if (size() == 0) return;
+    if (!writer_) {
+      iovec iov = {data(), size()};
+      if (!internal::write_all(fd_, &iov, 1)) report_write_error(errno);
+      clear();
+      return;
+    }
+    auto empty = writer_->exchange({data(), size(), capacity()}, buffer_size_);
+    set(empty.data, empty.capacity);
+    clear();
+    if (int error_code = writer_->error()) report_write_error(error_code);
+  }
+
+  // Writes the buffer once the next print might not fit in it.
+  void end_print(std::size_t begin) {
+    std::size_t print_size = size() - begin;
+    if (print_size > max_print_size_) max_print_size_ = print_size;
+    std::size_t threshold = flush_threshold_;
+    if (threshold == 0) {
+      std::size_t reserve = max_print_size_ < capacity() / 2
+                                ? max_print_size_
+                                : capacity() / 2;
+      threshold = capacity() - reserve;
+    }
+    if (size() >= threshold) flush_buffer();
+  }
+
+  void append(string_view str) {
+    internal::buffer<char>::append(str.data(), str.data() + str.size());
+  }
+
+  // Writes the buffer, waiting for a background writer, and frees the
+  // buffers. Returns the first write error, or 0. After a reported write
+  // error the buffer is discarded instead, and 0 is returned.
+  int write_and_release() {
+    int error_code = 0;
+    if (writer_) {
+      writer_->release({data(), failed_ ? 0 : size(), capacity()});
+      error_code = writer_->wait();
+      writer_.reset();
+    } else {
+      iovec iov = {data(), size()};
+      if (!failed_ && !internal::write_all(fd_, &iov, 1)) error_code = errno;
+      std::free(data());
+    }
+    set(nullptr, 0);
+    clear();
+    return failed_ ? 0 : error_code;
+  }
+
+ public:
+  ostream(ostream&& other) FMT_NOEXCEPT
+      : internal::buffer<char>(other.data(), other.size(), other.capacity()),
+        fd_(other.fd_),
+        buffer_size_(other.buffer_size_),
+        flush_threshold_(other.flush_threshold_),
+        max_print_size_(other.max_print_size_),
+        failed_(other.failed_),
+        writer_(std::move(other.writer_)) {
+    other.set(nullptr, 0);
+    other.clear();
+    other.fd_ = -1;
+  }
+
+  ostream(const ostream&) = delete;
+  void operator=(const ostream&) = delete;
+
+  // Writes the buffer and closes the file, reporting errors without
+  // throwing.
+  ~ostream() FMT_NOEXCEPT {
+    if (fd_ == -1) return;
+    if (int error_code = write_and_release())
+      report_system_error(error_code, "cannot write to file");
+    if (FMT_POSIX_CALL(close(fd_)) != 0)
+      report_system_error(errno, "cannot close file");
+  }
+
+  friend ostream output_file(cstring_view path, const ostream_params& params);
+
+  // Returns the file descriptor.
+  int descriptor() const FMT_NOEXCEPT { return fd_; }
+
+  template <typename S, typename... Args>
+  void print(const S& format_str, Args&&... args) {
+    std::size_t begin = size();
+    internal::vformat_to(
+        static_cast<internal::buffer<char>&>(*this),
+        to_string_view(format_str),
+        internal::make_args_checked<Args...>(format_str, args...));
+    end_print(begin);
+  }
+
+  // Writes str after what is buffered. Without a background writer, str
+  // at least half the buffer size goes to the file in the same writev call
+  // as the buffer rather than through it.
+  void write(string_view str) {
+    if (!writer_ && str.size() >= buffer_size_ / 2) {
+      iovec iov[] = {{data(), size()},
+                     {const_cast<char*>(str.data()), str.size()}};
+      if (!internal::write_all(fd_, iov, 2)) report_write_error(errno);
+      clear();
+      return;
+    }
+    std::size_t begin = size();
+    append(str);
+    end_print(begin);
+  }
+
+  // Writes the buffer to the file, waiting for a background writer.
+  void flush() {
+    flush_buffer();
+    if (!writer_) return;
+    if (int error_code = writer_->wait()) report_write_error(error_code);
+  }
+
+  // Flushes and closes the file. The file is closed even if writing fails,
+  // so that the destructor does not report the error a second time.
+  void close() {
+    if (fd_ == -1) return;
+    int error_code = write_and_release();
+    int fd = fd_;
+    fd_ = -1;
+    int close_error = FMT_POSIX_CALL(close(fd)) != 0 ? errno : 0;
+    if (error_code != 0) report_write_error(error_code);
+    if (close_error != 0)
+      FMT_THROW(system_error(close_error, "cannot close file"));
+  }
+};
+
+/**
+  \rst
+  Opens a file for writing with the given parameters.
+
+  **Example**::
+
+    auto out = fmt::output_file("guide.txt");
+    out.print("Don't {}\n", "Panic");
+  \endrst
+ */
+inline ostream output_file(cstring_view path,
+                           const ostream_params& params = ostream_params()) {
+  return ostream(path, params);
+}
+#endif  // FMT_USE_WRITEV
+
 #ifdef FMT_LOCALE
 // A "C" numeric locale.
 class locale {
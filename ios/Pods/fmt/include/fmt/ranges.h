@@ -39,7 +39,7 @@ struct formatting_range : formatting_base<Char> {
   Char prefix;
   Char delimiter;
   Char postfix;
-  formatting_range() : prefix('{'), delimiter(','), postfix('}') {}
+  FMT_CONSTEXPR formatting_range() : prefix('{'), delimiter(','), postfix('}') {}
   static FMT_CONSTEXPR_DECL const bool add_delimiter_spaces = true;
   static FMT_CONSTEXPR_DECL const bool add_prepostfix_space = false;
 };
@@ -49,7 +49,7 @@ struct formatting_tuple : formatting_base<Char> {
   Char prefix;
   Char delimiter;
   Char postfix;
-  formatting_tuple() : prefix('('), delimiter(','), postfix(')') {}
+  FMT_CONSTEXPR formatting_tuple() : prefix('('), delimiter(','), postfix(')') {}
   static FMT_CONSTEXPR_DECL const bool add_delimiter_spaces = true;
   static FMT_CONSTEXPR_DECL const bool add_prepostfix_space = false;
 };
@@ -156,6 +156,11 @@ template FMT_API int internal::snprintf_float(double, int,
 template FMT_API int internal::snprintf_float(long double, int,
                                               internal::float_specs,
                                               internal::buffer<char>&);
+template FMT_API internal::dragonbox::decimal_fp<float>
+internal::dragonbox::to_decimal(float x) FMT_NOEXCEPT;
+template FMT_API internal::dragonbox::decimal_fp<double>
+internal::dragonbox::to_decimal(double x) FMT_NOEXCEPT;
+
 template FMT_API int internal::format_float(double, int, internal::float_specs,
                                             internal::buffer<char>&);
 template FMT_API int internal::format_float(long double, int,
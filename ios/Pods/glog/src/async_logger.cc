@@ -0,0 +1,548 @@
+// Copyright (c) 2008, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Asynchronous base::Logger: see the AsyncLogger comment in logging.h.
+//
+// The ring buffer holds variable-length records.  Each starts on a 16 byte
+// boundary with a header word (commit bit, flush bit, message length) and
+// the timestamp, followed by the message, which may wrap around the end
+// of the buffer.  Producers claim space by advancing "head" with a
+// compare-and-swap, copy the message in, and publish the header word last.
+// The single writer consumes records in order from "tail"; it zeroes what
+// it consumed before advancing tail, so an unpublished header always reads
+// as zero.
+
+#include "utilities.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#ifdef HAVE_PTHREAD
+# include <pthread.h>
+# include <sys/time.h>
+# include <sys/uio.h>
+#endif
+#ifdef HAVE_UNISTD_H
+# include <unistd.h>
+#endif
+
+#include "glog/logging.h"
+
+using std::string;
+
+_START_GOOGLE_NAMESPACE_
+
+namespace base {
+
+namespace {
+
+const size_t kHeaderSize = 16;
+const size_t kMinBufferSize = 64 << 10;
+const uint64 kCommitted = 1ULL << 63;
+const uint64 kForceFlush = 1ULL << 62;
+const uint64 kLengthMask = 0xffffffffULL;
+
+// Upper bounds on the records the writer hands on in one batch.  Space is
+// only returned to producers between batches.
+const size_t kMaxBatchRecords = 256;
+const size_t kMaxBatchBytes = 1 << 20;
+
+// How long a FATAL message or Flush() waits for a writer that makes no
+// progress before giving up.
+const int kFlushTimeoutMs = 10 * 1000;
+
+inline size_t RoundUp(size_t n) {
+  return (n + kHeaderSize - 1) & ~(kHeaderSize - 1);
+}
+
+#ifdef HAVE_PTHREAD
+void DeadlineAfter(struct timespec* ts, int ms) {
+  struct timeval now;
+  gettimeofday(&now, NULL);
+  int64 nsec = now.tv_usec * 1000LL + (ms % 1000) * 1000000LL;
+  ts->tv_sec = now.tv_sec + ms / 1000 + nsec / 1000000000LL;
+  ts->tv_nsec = nsec % 1000000000LL;
+}
+#endif
+
+}  // namespace
+
+struct AsyncLogger::Impl {
+  Impl(Logger* wrapped, int fd, size_t buffer_size, OverflowPolicy policy);
+  ~Impl();
+
+  void Write(bool force_flush, time_t timestamp,
+             const char* message, size_t len);
+  void Flush();
+  uint32 LogSize();
+
+  // Writes straight to the destination, bypassing the buffer.
+  void WriteDirect(bool force_flush, time_t timestamp,
+                   const char* message, size_t len);
+
+  Logger* const wrapped_;
+  const int fd_;
+  const OverflowPolicy policy_;
+  uint64 dropped_;
+  uint64 bytes_written_;
+
+#ifdef HAVE_PTHREAD
+  static void* WriterMain(void* arg);
+  void Run();
+  // Waits for a record to be published; returns true once stopping with
+  // nothing left to write.
+  bool Idle();
+  void WaitForSpace(uint64 need);
+  void Emit(size_t num_pieces, bool force_flush, time_t timestamp);
+  void WriteFdFully(struct iovec* iov, int iovcnt);
+  bool OnWriterThread() const;
+
+  uint64* HeaderWord(uint64 pos) const {
+    return reinterpret_cast<uint64*>(ring_ + (pos & mask_));
+  }
+  int64* Timestamp(uint64 pos) const {
+    return reinterpret_cast<int64*>(ring_ + (pos & mask_) + 8);
+  }
+  void CopyIn(uint64 pos, const char* src, size_t n);
+  void Zero(uint64 pos, size_t n);
+
+  size_t capacity_;          // a power of two
+  uint64 mask_;
+  char* ring_;
+  uint64 head_;              // next byte to claim; advanced by producers
+  uint64 tail_;              // next byte to consume; advanced by the writer
+  uint64 reported_dropped_;  // writer only
+
+  pthread_mutex_t mutex_;
+  pthread_cond_t data_cond_;     // the writer waits for records
+  pthread_cond_t space_cond_;    // blocked producers wait for room
+  pthread_cond_t drained_cond_;  // Flush() waits for the writer
+  bool sleeping_;                // the writer waits on data_cond_
+  bool stop_;
+  int blocked_;                  // under mutex_
+  int flushers_;                 // under mutex_
+  bool writer_started_;
+  pthread_t writer_;
+
+  // One batch, as (pointer, length) pieces: two per record at most, since
+  // a message may wrap, plus the dropped-messages notice.
+  struct iovec pieces_[2 * kMaxBatchRecords + 1];
+  char notice_[96];
+  string staging_;  // batch copy for a wrapped Logger
+#endif
+};
+
+AsyncLogger::Impl::Impl(Logger* wrapped, int fd, size_t buffer_size,
+                        OverflowPolicy policy)
+    : wrapped_(wrapped), fd_(fd), policy_(policy),
+      dropped_(0), bytes_written_(0) {
+#ifdef HAVE_PTHREAD
+  capacity_ = kMinBufferSize;
+  while (capacity_ < buffer_size) {
+    capacity_ <<= 1;
+  }
+  mask_ = capacity_ - 1;
+  // calloc: every header starts out unpublished.
+  ring_ = static_cast<char*>(calloc(capacity_, 1));
+  head_ = 0;
+  tail_ = 0;
+  reported_dropped_ = 0;
+  pthread_mutex_init(&mutex_, NULL);
+  pthread_cond_init(&data_cond_, NULL);
+  pthread_cond_init(&space_cond_, NULL);
+  pthread_cond_init(&drained_cond_, NULL);
+  sleeping_ = false;
+  stop_ = false;
+  blocked_ = 0;
+  flushers_ = 0;
+  // Without a buffer or a thread, fall back to writing synchronously.
+  writer_started_ = ring_ != NULL &&
+      pthread_create(&writer_, NULL, &WriterMain, this) == 0;
+#else
+  (void)buffer_size;
+#endif
+}
+
+AsyncLogger::Impl::~Impl() {
+#ifdef HAVE_PTHREAD
+  if (writer_started_) {
+    pthread_mutex_lock(&mutex_);
+    stop_ = true;
+    pthread_cond_signal(&data_cond_);
+    pthread_mutex_unlock(&mutex_);
+    pthread_join(writer_, NULL);
+  }
+  if (wrapped_ != NULL) {
+    wrapped_->Flush();
+  }
+  pthread_cond_destroy(&drained_cond_);
+  pthread_cond_destroy(&space_cond_);
+  pthread_cond_destroy(&data_cond_);
+  pthread_mutex_destroy(&mutex_);
+  free(ring_);
+#endif
+}
+
+void AsyncLogger::Impl::WriteDirect(bool force_flush, time_t timestamp,
+                                    const char* message, size_t len) {
+  if (wrapped_ != NULL) {
+    wrapped_->Write(force_flush, timestamp, message, static_cast<int>(len));
+    return;
+  }
+  while (len > 0) {
+    ssize_t n = write(fd_, message, len);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return;
+    }
+    bytes_written_ += n;
+    message += n;
+    len -= n;
+  }
+}
+
+#ifdef HAVE_PTHREAD
+
+void AsyncLogger::Impl::Write(bool force_flush, time_t timestamp,
+                              const char* message, size_t len) {
+  if (!writer_started_) {
+    WriteDirect(force_flush, timestamp, message, len);
+    return;
+  }
+  if (len == 0) {
+    // LogMessage::SendToLog() issues an empty forced write before aborting
+    // on a FATAL message: everything must be on its way to disk by then.
+    if (force_flush) {
+      Flush();
+    }
+    return;
+  }
+  if (len > capacity_ - kHeaderSize) {
+    len = capacity_ - kHeaderSize;
+  }
+  const uint64 need = kHeaderSize + RoundUp(len);
+  uint64 pos = __atomic_load_n(&head_, __ATOMIC_RELAXED);
+  for (;;) {
+    // Acquire: the writer zeroed the space below tail before releasing it.
+    const uint64 tail = __atomic_load_n(&tail_, __ATOMIC_ACQUIRE);
+    if (pos + need - tail > capacity_) {
+      // The writer thread itself must never wait for itself; a message it
+      // logs while the buffer is full is dropped.
+      if (policy_ != BLOCK_ON_OVERFLOW || OnWriterThread()) {
+        __atomic_fetch_add(&dropped_, 1, __ATOMIC_RELAXED);
+        return;
+      }
+      WaitForSpace(need);
+      pos = __atomic_load_n(&head_, __ATOMIC_RELAXED);
+      continue;
+    }
+    if (__atomic_compare_exchange_n(&head_, &pos, pos + need, true,
+                                    __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+      break;
+    }
+  }
+
+  *Timestamp(pos) = timestamp;
+  CopyIn(pos + kHeaderSize, message, len);
+  // Sequentially consistent, to pair with the writer's store to sleeping_
+  // followed by its load of this header.
+  __atomic_store_n(HeaderWord(pos),
+                   kCommitted | (force_flush ? kForceFlush : 0) | len,
+                   __ATOMIC_SEQ_CST);
+  if (__atomic_load_n(&sleeping_, __ATOMIC_SEQ_CST)) {
+    pthread_mutex_lock(&mutex_);
+    pthread_cond_signal(&data_cond_);
+    pthread_mutex_unlock(&mutex_);
+  }
+}
+
+void AsyncLogger::Impl::Flush() {
+  if (!writer_started_) {
+    if (wrapped_ != NULL) {
+      wrapped_->Flush();
+    }
+    return;
+  }
+  if (OnWriterThread()) {
+    return;
+  }
+  const uint64 target = __atomic_load_n(&head_, __ATOMIC_ACQUIRE);
+  struct timespec deadline;
+  DeadlineAfter(&deadline, kFlushTimeoutMs);
+  pthread_mutex_lock(&mutex_);
+  ++flushers_;
+  pthread_cond_signal(&data_cond_);
+  while (__atomic_load_n(&tail_, __ATOMIC_ACQUIRE) < target) {
+    if (pthread_cond_timedwait(&drained_cond_, &mutex_, &deadline) ==
+        ETIMEDOUT) {
+      break;
+    }
+  }
+  --flushers_;
+  pthread_mutex_unlock(&mutex_);
+  if (wrapped_ != NULL) {
+    wrapped_->Flush();
+  }
+}
+
+void AsyncLogger::Impl::WaitForSpace(uint64 need) {
+  struct timespec deadline;
+  DeadlineAfter(&deadline, 100);
+  pthread_mutex_lock(&mutex_);
+  ++blocked_;
+  // Rechecked under the lock: the writer advances tail before taking it to
+  // look at blocked_.
+  if (__atomic_load_n(&head_, __ATOMIC_RELAXED) + need -
+      __atomic_load_n(&tail_, __ATOMIC_ACQUIRE) > capacity_) {
+    pthread_cond_timedwait(&space_cond_, &mutex_, &deadline);
+  }
+  --blocked_;
+  pthread_mutex_unlock(&mutex_);
+}
+
+void* AsyncLogger::Impl::WriterMain(void* arg) {
+  static_cast<Impl*>(arg)->Run();
+  return NULL;
+}
+
+bool AsyncLogger::Impl::OnWriterThread() const {
+  return writer_started_ && pthread_equal(pthread_self(), writer_);
+}
+
+void AsyncLogger::Impl::Run() {
+  for (;;) {
+    const uint64 start = tail_;
+    uint64 pos = start;
+    size_t num_pieces = 0;
+    size_t num_records = 0;
+    bool force_flush = false;
+    time_t timestamp = 0;
+    while (num_records < kMaxBatchRecords && pos - start < kMaxBatchBytes) {
+      const uint64 word = __atomic_load_n(HeaderWord(pos), __ATOMIC_ACQUIRE);
+      if ((word & kCommitted) == 0) {
+        break;
+      }
+      const size_t len = word & kLengthMask;
+      force_flush |= (word & kForceFlush) != 0;
+      timestamp = *Timestamp(pos);
+      const size_t off = (pos + kHeaderSize) & mask_;
+      const size_t first = std::min(len, capacity_ - off);
+      pieces_[num_pieces].iov_base = ring_ + off;
+      pieces_[num_pieces++].iov_len = first;
+      if (first < len) {
+        pieces_[num_pieces].iov_base = ring_;
+        pieces_[num_pieces++].iov_len = len - first;
+      }
+      pos += kHeaderSize + RoundUp(len);
+      ++num_records;
+    }
+
+    if (num_records == 0) {
+      if (Idle()) {
+        return;
+      }
+      continue;
+    }
+
+    Emit(num_pieces, force_flush, timestamp);
+
+    Zero(start, pos - start);
+    __atomic_store_n(&tail_, pos, __ATOMIC_RELEASE);
+    pthread_mutex_lock(&mutex_);
+    if (blocked_ > 0) {
+      pthread_cond_broadcast(&space_cond_);
+    }
+    if (flushers_ > 0) {
+      pthread_cond_broadcast(&drained_cond_);
+    }
+    pthread_mutex_unlock(&mutex_);
+  }
+}
+
+bool AsyncLogger::Impl::Idle() {
+  bool done = false;
+  struct timespec deadline;
+  pthread_mutex_lock(&mutex_);
+  __atomic_store_n(&sleeping_, true, __ATOMIC_SEQ_CST);
+  if ((__atomic_load_n(HeaderWord(tail_), __ATOMIC_SEQ_CST) & kCommitted) ==
+      0) {
+    if (flushers_ > 0) {
+      pthread_cond_broadcast(&drained_cond_);
+    }
+    if (stop_ && __atomic_load_n(&head_, __ATOMIC_ACQUIRE) == tail_) {
+      done = true;
+    } else {
+      // A claimed record is published shortly; otherwise sleep until a
+      // producer signals.  The timeout only guards against lost wakeups.
+      DeadlineAfter(&deadline, stop_ ? 1 : 1000);
+      pthread_cond_timedwait(&data_cond_, &mutex_, &deadline);
+    }
+  }
+  __atomic_store_n(&sleeping_, false, __ATOMIC_RELAXED);
+  pthread_mutex_unlock(&mutex_);
+  return done;
+}
+
+void AsyncLogger::Impl::Emit(size_t num_pieces, bool force_flush,
+                             time_t timestamp) {
+  const uint64 dropped = __atomic_load_n(&dropped_, __ATOMIC_RELAXED);
+  if (policy_ == COUNT_ON_OVERFLOW && dropped != reported_dropped_) {
+    int n = snprintf(notice_, sizeof(notice_),
+                     "*** %llu log messages dropped (buffer full) ***\n",
+                     static_cast<unsigned long long>(
+                         dropped - reported_dropped_));
+    reported_dropped_ = dropped;
+    pieces_[num_pieces].iov_base = notice_;
+    pieces_[num_pieces++].iov_len =
+        std::min(static_cast<size_t>(n), sizeof(notice_) - 1);
+  }
+
+  if (wrapped_ == NULL) {
+    WriteFdFully(pieces_, static_cast<int>(num_pieces));
+    return;
+  }
+  staging_.clear();
+  for (size_t i = 0; i < num_pieces; ++i) {
+    staging_.append(static_cast<const char*>(pieces_[i].iov_base),
+                    pieces_[i].iov_len);
+  }
+  wrapped_->Write(force_flush, timestamp, staging_.data(),
+                  static_cast<int>(staging_.size()));
+}
+
+void AsyncLogger::Impl::WriteFdFully(struct iovec* iov, int iovcnt) {
+  while (iovcnt > 0) {
+    ssize_t n = writev(fd_, iov, std::min(iovcnt, IOV_MAX));
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      // Like LogFileObject, give up on this batch rather than retry.
+      return;
+    }
+    __atomic_fetch_add(&bytes_written_, n, __ATOMIC_RELAXED);
+    size_t left = n;
+    while (iovcnt > 0 && left >= iov->iov_len) {
+      left -= iov->iov_len;
+      ++iov;
+      --iovcnt;
+    }
+    if (iovcnt > 0) {
+      iov->iov_base = static_cast<char*>(iov->iov_base) + left;
+      iov->iov_len -= left;
+    }
+  }
+}
+
+void AsyncLogger::Impl::CopyIn(uint64 pos, const char* src, size_t n) {
+  const size_t off = pos & mask_;
+  const size_t first = std::min(n, capacity_ - off);
+  memcpy(ring_ + off, src, first);
+  memcpy(ring_, src + first, n - first);
+}
+
+void AsyncLogger::Impl::Zero(uint64 pos, size_t n) {
+  const size_t off = pos & mask_;
+  const size_t first = std::min(n, capacity_ - off);
+  memset(ring_ + off, 0, first);
+  memset(ring_, 0, n - first);
+}
+
+uint32 AsyncLogger::Impl::LogSize() {
+  if (wrapped_ != NULL) {
+    return wrapped_->LogSize();
+  }
+  return static_cast<uint32>(
+      __atomic_load_n(&bytes_written_, __ATOMIC_RELAXED));
+}
+
+#else  // !HAVE_PTHREAD
+
+void AsyncLogger::Impl::Write(bool force_flush, time_t timestamp,
+                              const char* message, size_t len) {
+  WriteDirect(force_flush, timestamp, message, len);
+}
+
+void AsyncLogger::Impl::Flush() {
+  if (wrapped_ != NULL) {
+    wrapped_->Flush();
+  }
+}
+
+uint32 AsyncLogger::Impl::LogSize() {
+  return wrapped_ != NULL ? wrapped_->LogSize()
+                          : static_cast<uint32>(bytes_written_);
+}
+
+#endif  // HAVE_PTHREAD
+
+AsyncLogger::AsyncLogger(Logger* wrapped, size_t buffer_size,
+                         OverflowPolicy policy)
+    : impl_(new Impl(wrapped, -1, buffer_size, policy)) {
+}
+
+AsyncLogger::AsyncLogger(int fd, size_t buffer_size, OverflowPolicy policy)
+    : impl_(new Impl(NULL, fd, buffer_size, policy)) {
+}
+
+AsyncLogger::~AsyncLogger() {
+  delete impl_;
+}
+
+void AsyncLogger::Write(bool force_flush, time_t timestamp,
+                        const char* message, int message_len) {
+  impl_->Write(force_flush, timestamp, message,
+               message_len > 0 ? static_cast<size_t>(message_len) : 0);
+}
+
+void AsyncLogger::Flush() {
+  impl_->Flush();
+}
+
+uint32 AsyncLogger::LogSize() {
+  return impl_->LogSize();
+}
+
+uint64 AsyncLogger::dropped_messages() const {
+#ifdef HAVE_PTHREAD
+  return __atomic_load_n(&impl_->dropped_, __ATOMIC_RELAXED);
+#else
+  return impl_->dropped_;
+#endif
+}
+
+}  // namespace base
+
+_END_GOOGLE_NAMESPACE_
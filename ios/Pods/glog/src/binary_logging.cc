@@ -0,0 +1,564 @@
+// Copyright (c) 2008, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Structured logging: see the comment in glog/binary_logging.h.
+//
+// A binary log file starts with the 8 bytes "GLOGBIN1" and continues with
+// records, each a tag byte followed by fields.  Integers are base-128
+// varints, least significant group first; signed ones are zigzag encoded
+// first (0, -1, 1, -2, ... -> 0, 1, 2, 3, ...).  Strings are a varint of
+// their length plus one, 0 standing for a NULL pointer, then the bytes.
+//
+//   'S' site     id, severity, line (signed), file, format
+//   'Z' zone     offset of local time from UTC in seconds (signed)
+//   'M' message  site id, microseconds since the previous message of the
+//                file (signed; since the epoch for the first one), thread
+//                id, argument count, arguments
+//
+// Each argument is a BinaryLogArg::Type byte and the value: a varint for
+// SIGNED (signed), UNSIGNED and POINTER, 8 little-endian bytes of the IEEE
+// representation for DOUBLE, a string for STRING.
+//
+// The writer (BinaryLogFile in logging.cc) defines a site in each file
+// before its first message, and writes a zone record before the first
+// message and whenever the offset changes.
+
+#include "utilities.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "glog/binary_logging.h"
+#include "glog/logging.h"
+
+using std::string;
+using std::vector;
+
+_START_GOOGLE_NAMESPACE_
+
+namespace {
+
+// printf length modifiers, as far as they matter here.
+enum LengthModifier {
+  LENGTH_NONE,
+  LENGTH_HH,
+  LENGTH_H,
+  LENGTH_L,
+  LENGTH_LL,
+  LENGTH_J,
+  LENGTH_Z,
+  LENGTH_T,
+  LENGTH_LONG_DOUBLE
+};
+
+// The size of the integer printf reads for a conversion with "length".
+size_t IntegerSize(LengthModifier length) {
+  switch (length) {
+    case LENGTH_HH: return sizeof(char);
+    case LENGTH_H:  return sizeof(short);
+    case LENGTH_L:  return sizeof(long);
+    case LENGTH_LL: return sizeof(long long);
+    case LENGTH_J:  return sizeof(intmax_t);
+    case LENGTH_Z:  return sizeof(size_t);
+    case LENGTH_T:  return sizeof(ptrdiff_t);
+    default:        return sizeof(int);
+  }
+}
+
+// The bits of an integer, pointer or char argument.
+bool IntegerBits(const BinaryLogArg& arg, uint64* bits) {
+  switch (arg.type) {
+    case BinaryLogArg::SIGNED:
+      *bits = static_cast<uint64>(arg.i);
+      return true;
+    case BinaryLogArg::UNSIGNED:
+      *bits = arg.u;
+      return true;
+    case BinaryLogArg::POINTER:
+      *bits = reinterpret_cast<uintptr_t>(arg.p);
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Appends snprintf(spec, value) to *out.
+template <typename T>
+void AppendFormatted(string* out, const char* spec, T value) {
+  char buf[128];
+  const int n = snprintf(buf, sizeof(buf), spec, value);
+  if (n < 0) {
+    return;
+  }
+  if (static_cast<size_t>(n) < sizeof(buf)) {
+    out->append(buf, n);
+    return;
+  }
+  const size_t old_size = out->size();
+  out->resize(old_size + n + 1);
+  snprintf(&(*out)[old_size], n + 1, spec, value);
+  out->resize(old_size + n);
+}
+
+}  // namespace
+
+void FormatBinaryLogMessage(const char* format,
+                            const BinaryLogArg* args,
+                            size_t nargs,
+                            string* out) {
+  size_t next_arg = 0;
+  const char* p = format;
+  for (;;) {
+    const char* percent = strchr(p, '%');
+    if (percent == NULL) {
+      out->append(p);
+      return;
+    }
+    out->append(p, percent - p);
+    if (percent[1] == '%') {
+      *out += '%';
+      p = percent + 2;
+      continue;
+    }
+
+    // Copy "%[flags][width][.precision]" into spec, substituting the
+    // arguments for '*', then parse the length modifier, which is left out
+    // of spec: each conversion below supplies its own.
+    char spec[64];
+    size_t n = 0;
+    spec[n++] = '%';
+    const char* q = percent + 1;
+    bool ok = true;
+    while (*q != '\0' && strchr("-+ #0'", *q) != NULL && n < 16) {
+      spec[n++] = *q++;
+    }
+    for (int part = 0; part < 2 && ok; ++part) {
+      if (part == 1) {
+        if (*q != '.') break;
+        spec[n++] = *q++;
+      }
+      if (*q == '*') {
+        uint64 bits;
+        ok = next_arg < nargs && IntegerBits(args[next_arg++], &bits);
+        if (ok) {
+          n += snprintf(spec + n, sizeof(spec) - n, "%d",
+                        static_cast<int>(bits));
+        }
+        ++q;
+      } else {
+        while (*q >= '0' && *q <= '9' && n < 40) {
+          spec[n++] = *q++;
+        }
+      }
+    }
+
+    LengthModifier length = LENGTH_NONE;
+    switch (*q) {
+      case 'h':
+        length = (q[1] == 'h') ? LENGTH_HH : LENGTH_H;
+        q += (q[1] == 'h') ? 2 : 1;
+        break;
+      case 'l':
+        length = (q[1] == 'l') ? LENGTH_LL : LENGTH_L;
+        q += (q[1] == 'l') ? 2 : 1;
+        break;
+      case 'q': length = LENGTH_LL; ++q; break;
+      case 'j': length = LENGTH_J; ++q; break;
+      case 'z': length = LENGTH_Z; ++q; break;
+      case 't': length = LENGTH_T; ++q; break;
+      case 'L': length = LENGTH_LONG_DOUBLE; ++q; break;
+    }
+
+    const char conversion = *q;
+    if (conversion == '\0') {
+      // A truncated specification is printed as is.
+      out->append(percent);
+      return;
+    }
+    p = q + 1;
+    if (conversion == 'n') {
+      ++next_arg;
+      continue;
+    }
+
+    const bool known = strchr("diouxXcsp" "eEfFgGaA", conversion) != NULL;
+    if (!ok || !known || next_arg >= nargs) {
+      // Arguments the format has no use for, or a format the arguments do
+      // not match: show the specification rather than guess.
+      out->append(percent, p - percent);
+      continue;
+    }
+    const BinaryLogArg& arg = args[next_arg++];
+
+    uint64 bits = 0;
+    const size_t size = IntegerSize(length);
+    const uint64 mask = (size >= 8) ? ~0ULL : (1ULL << (8 * size)) - 1;
+    switch (conversion) {
+      case 'd':
+      case 'i':
+        if (IntegerBits(arg, &bits)) {
+          // Sign-extend what printf would have read.
+          bits &= mask;
+          const uint64 sign = (size >= 8) ? 0 : (1ULL << (8 * size - 1));
+          const long long value = static_cast<long long>(
+              (bits ^ sign) - sign);
+          memcpy(spec + n, "ll", 2);
+          spec[n + 2] = conversion;
+          spec[n + 3] = '\0';
+          AppendFormatted(out, spec, value);
+          continue;
+        }
+        break;
+      case 'o':
+      case 'u':
+      case 'x':
+      case 'X':
+        if (IntegerBits(arg, &bits)) {
+          memcpy(spec + n, "ll", 2);
+          spec[n + 2] = conversion;
+          spec[n + 3] = '\0';
+          AppendFormatted(out, spec,
+                          static_cast<unsigned long long>(bits & mask));
+          continue;
+        }
+        break;
+      case 'c':
+        if (IntegerBits(arg, &bits)) {
+          spec[n] = 'c';
+          spec[n + 1] = '\0';
+          AppendFormatted(out, spec, static_cast<int>(bits));
+          continue;
+        }
+        break;
+      case 's':
+        if (arg.type == BinaryLogArg::STRING) {
+          const char* s = (arg.s != NULL) ? arg.s : "(null)";
+          if (n == 1) {
+            out->append(s);
+          } else {
+            spec[n] = 's';
+            spec[n + 1] = '\0';
+            AppendFormatted(out, spec, s);
+          }
+          continue;
+        }
+        break;
+      case 'p':
+        if (IntegerBits(arg, &bits)) {
+          spec[n] = 'p';
+          spec[n + 1] = '\0';
+          AppendFormatted(out, spec,
+                          reinterpret_cast<const void*>(
+                              static_cast<uintptr_t>(bits)));
+          continue;
+        }
+        break;
+      default:  // floating point
+        if (arg.type == BinaryLogArg::DOUBLE) {
+          spec[n] = conversion;
+          spec[n + 1] = '\0';
+          AppendFormatted(out, spec, arg.d);
+          continue;
+        }
+        break;
+    }
+    out->append(percent, p - percent);
+  }
+}
+
+namespace binary_logging_internal {
+
+void CheckFormat(const char*, ...) {
+}
+
+}  // namespace binary_logging_internal
+
+BinaryLogReader::BinaryLogReader()
+  : file_(NULL),
+    buffer_(1 << 16),
+    pos_(0),
+    end_(0),
+    eof_(false),
+    timestamp_usec_(0),
+    gmtoff_(0),
+    log_prefix_(true) {
+}
+
+BinaryLogReader::~BinaryLogReader() {
+  if (file_ != NULL) {
+    fclose(file_);
+  }
+}
+
+bool BinaryLogReader::Open(const char* path, string* error) {
+  if (file_ != NULL) {
+    fclose(file_);
+  }
+  pos_ = end_ = 0;
+  eof_ = false;
+  sites_.clear();
+  timestamp_usec_ = 0;
+  gmtoff_ = 0;
+
+  file_ = fopen(path, "rb");
+  if (file_ == NULL) {
+    *error = string(path) + ": " + strerror(errno);
+    return false;
+  }
+  if (!Fill(kBinaryLogMagicLen) ||
+      memcmp(&buffer_[pos_], kBinaryLogMagic, kBinaryLogMagicLen) != 0) {
+    *error = string(path) + ": not a binary log file";
+    return false;
+  }
+  pos_ += kBinaryLogMagicLen;
+  return true;
+}
+
+// Makes n bytes available at buffer_[pos_].  Returns false if the file
+// ends before that.
+bool BinaryLogReader::Fill(size_t n) {
+  if (end_ - pos_ >= n) {
+    return true;
+  }
+  memmove(&buffer_[0], &buffer_[pos_], end_ - pos_);
+  end_ -= pos_;
+  pos_ = 0;
+  if (buffer_.size() < n) {
+    buffer_.resize(n);
+  }
+  while (end_ < n && !eof_) {
+    const size_t got = fread(&buffer_[end_], 1, buffer_.size() - end_, file_);
+    if (got == 0) {
+      eof_ = true;
+    }
+    end_ += got;
+  }
+  return end_ >= n;
+}
+
+bool BinaryLogReader::ReadVarint(uint64* value) {
+  *value = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    if (!Fill(1)) {
+      return false;
+    }
+    const unsigned char byte = buffer_[pos_++];
+    *value |= static_cast<uint64>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool BinaryLogReader::ReadSignedVarint(int64* value) {
+  uint64 zigzag;
+  if (!ReadVarint(&zigzag)) {
+    return false;
+  }
+  *value = static_cast<int64>(zigzag >> 1) ^ -static_cast<int64>(zigzag & 1);
+  return true;
+}
+
+bool BinaryLogReader::ReadString(string* out, bool* is_null) {
+  uint64 len;
+  if (!ReadVarint(&len)) {
+    return false;
+  }
+  *is_null = (len == 0);
+  out->clear();
+  // The length comes from the file, so the string is copied a buffer at a
+  // time instead of with one Fill(len - 1): a damaged length then ends the
+  // file, like a truncated record, once the data runs out, rather than
+  // allocating the whole length up front.
+  uint64 left = len > 0 ? len - 1 : 0;
+  while (left > 0) {
+    if (!Fill(1)) {
+      return false;
+    }
+    const size_t n = static_cast<size_t>(
+        std::min(left, static_cast<uint64>(end_ - pos_)));
+    out->append(&buffer_[pos_], n);
+    pos_ += n;
+    left -= n;
+  }
+  return true;
+}
+
+bool BinaryLogReader::Next(LogSeverity* severity, string* line,
+                           string* error) {
+  error->clear();
+  for (;;) {
+    if (!Fill(1)) {
+      return false;
+    }
+    const char tag = buffer_[pos_++];
+
+    if (tag == kBinaryLogSiteTag) {
+      uint64 id, site_severity;
+      int64 site_line;
+      Site site;
+      bool is_null;
+      if (!ReadVarint(&id) || !ReadVarint(&site_severity) ||
+          !ReadSignedVarint(&site_line) ||
+          !ReadString(&site.file, &is_null) ||
+          !ReadString(&site.format, &is_null)) {
+        return false;
+      }
+      if (id == 0 || id > (1 << 24) || site_severity >= NUM_SEVERITIES) {
+        *error = "bad site record";
+        return false;
+      }
+      site.severity = static_cast<LogSeverity>(site_severity);
+      site.line = static_cast<int>(site_line);
+      site.defined = true;
+      if (id >= sites_.size()) {
+        sites_.resize(id + 1);
+      }
+      sites_[id] = site;
+      continue;
+    }
+
+    if (tag == kBinaryLogZoneTag) {
+      if (!ReadSignedVarint(&gmtoff_)) {
+        return false;
+      }
+      continue;
+    }
+
+    if (tag != kBinaryLogMessageTag) {
+      *error = "unknown record";
+      return false;
+    }
+
+    uint64 id, tid, nargs;
+    int64 delta;
+    if (!ReadVarint(&id) || !ReadSignedVarint(&delta) ||
+        !ReadVarint(&tid) || !ReadVarint(&nargs)) {
+      return false;
+    }
+    if (id >= sites_.size() || !sites_[id].defined) {
+      *error = "message for an undefined site";
+      return false;
+    }
+    if (nargs > (1 << 16)) {
+      *error = "bad message record";
+      return false;
+    }
+
+    // Strings are collected first, and pointed to once they stop moving.
+    vector<BinaryLogArg> args(nargs);
+    vector<string> strings(nargs);
+    for (size_t i = 0; i < nargs; ++i) {
+      if (!Fill(1)) {
+        return false;
+      }
+      BinaryLogArg& arg = args[i];
+      arg.type = static_cast<BinaryLogArg::Type>(buffer_[pos_++]);
+      bool complete = true;
+      switch (arg.type) {
+        case BinaryLogArg::SIGNED:
+          complete = ReadSignedVarint(&arg.i);
+          break;
+        case BinaryLogArg::UNSIGNED:
+          complete = ReadVarint(&arg.u);
+          break;
+        case BinaryLogArg::POINTER: {
+          uint64 bits;
+          complete = ReadVarint(&bits);
+          arg.p = reinterpret_cast<const void*>(static_cast<uintptr_t>(bits));
+          break;
+        }
+        case BinaryLogArg::DOUBLE: {
+          complete = Fill(8);
+          if (complete) {
+            uint64 bits = 0;
+            for (int b = 0; b < 8; ++b) {
+              bits |= static_cast<uint64>(
+                  static_cast<unsigned char>(buffer_[pos_ + b])) << (8 * b);
+            }
+            pos_ += 8;
+            memcpy(&arg.d, &bits, sizeof(bits));
+          }
+          break;
+        }
+        case BinaryLogArg::STRING: {
+          bool is_null;
+          complete = ReadString(&strings[i], &is_null);
+          arg.s = is_null ? NULL : "";
+          break;
+        }
+        default:
+          *error = "bad argument";
+          return false;
+      }
+      if (!complete) {
+        return false;
+      }
+    }
+    for (size_t i = 0; i < nargs; ++i) {
+      if (args[i].type == BinaryLogArg::STRING && args[i].s != NULL) {
+        args[i].s = strings[i].c_str();
+      }
+    }
+
+    const Site& site = sites_[id];
+    timestamp_usec_ += delta;
+    *severity = site.severity;
+    line->clear();
+    if (log_prefix_) {
+      // Shifting by the recorded offset and breaking the result down as
+      // UTC gives the local time of the writer, whatever the reader's
+      // time zone.
+      time_t local_seconds = static_cast<time_t>(
+          timestamp_usec_ / 1000000 + gmtoff_);
+      struct ::tm tm_time;
+      gmtime_r(&local_seconds, &tm_time);
+      AppendLogPrefix(line, site.severity, tm_time,
+                      static_cast<int>(timestamp_usec_ % 1000000),
+                      static_cast<pid_t>(tid),
+                      const_basename(site.file.c_str()), site.line);
+    }
+    const size_t prefix_len = line->size();
+    FormatBinaryLogMessage(site.format.c_str(),
+                           args.empty() ? NULL : &args[0], nargs, line);
+    if (line->size() == prefix_len || (*line)[line->size() - 1] != '\n') {
+      *line += '\n';
+    }
+    return true;
+  }
+}
+
+_END_GOOGLE_NAMESPACE_
@@ -0,0 +1,257 @@
+// Copyright (c) 2008, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Structured ("binary") logging.
+//
+// LOG_BINARY(severity, format, args...) logs like
+//    LOG(severity) << StringPrintf(format, args...);
+// but with --log_binary the message is never formatted.  Instead the call
+// site is described once by a static BinaryLogSite (file, line, severity
+// and the printf format, which must be a string literal), and each message
+// is recorded as the site's id, the time, the thread id and the raw
+// argument values in a compact binary file next to the text logs:
+//
+//    <program>.<hostname>.<user>.log.BINARY.<date>-<time>.<pid>
+//
+// glog-decode (src/tools/glog_decode.cc) turns such a file back into the
+// exact text lines LOG(severity) would have written, prefix included.
+//
+//    LOG_BINARY(INFO, "fetched %d of %zu bytes from %s", n, size, url);
+//
+// Arguments are limited to what printf takes: integers, enums, floating
+// point numbers, C strings and pointers.  The compiler checks them against
+// the format as it does for printf.  %n is not supported, and long double
+// arguments are recorded as double.
+//
+// Messages are still formatted, lazily, when something needs the text:
+// when they go to stderr (--stderrthreshold, --alsologtostderr), to email,
+// or to a LogSink added with AddLogSink(), and for all messages when
+// --log_binary is off, --logtostderr is set or InitGoogleLogging() has not
+// been called yet.  FATAL messages always take the text path.
+
+#ifndef BASE_BINARY_LOGGING_H_
+#define BASE_BINARY_LOGGING_H_
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "glog/logging.h"
+
+namespace google {
+
+// A LOG_BINARY call site.  Sites are static and are assigned an id the
+// first time they log to a binary file.
+struct BinaryLogSite {
+  const char* file;
+  int line;
+  LogSeverity severity;
+  const char* format;
+  uint32 id;  // 0 until assigned, under the logging lock
+};
+
+// One argument of a LOG_BINARY message.  Integers are widened to 64 bits
+// and narrowed again according to the conversion's length modifier when
+// the message is formatted, as printf itself would read them.
+struct BinaryLogArg {
+  enum Type {
+    SIGNED,
+    UNSIGNED,
+    DOUBLE,
+    STRING,
+    POINTER
+  };
+
+  Type type;
+  union {
+    int64 i;
+    uint64 u;
+    double d;
+    const char* s;    // NUL-terminated, or NULL
+    const void* p;
+  };
+};
+
+// Formats the message of a LOG_BINARY call, the part after the prefix,
+// and appends it to *out.
+GOOGLE_GLOG_DLL_DECL void FormatBinaryLogMessage(const char* format,
+                                                 const BinaryLogArg* args,
+                                                 size_t nargs,
+                                                 std::string* out);
+
+// Logs a message for "site": to the binary log with --log_binary, as text
+// otherwise.  Called by LOG_BINARY.
+GOOGLE_GLOG_DLL_DECL void LogBinaryMessage(BinaryLogSite* site,
+                                           const BinaryLogArg* args,
+                                           size_t nargs);
+
+// Reads a binary log file record by record, for glog-decode.
+class GOOGLE_GLOG_DLL_DECL BinaryLogReader {
+ public:
+  BinaryLogReader();
+  ~BinaryLogReader();
+
+  // Opens "path", which must start with a binary log header.  Returns false
+  // and sets *error otherwise.
+  bool Open(const char* path, std::string* error);
+
+  // Whether Next() puts the usual prefix in front of each line, as with
+  // --log_prefix.  Defaults to true.
+  void set_log_prefix(bool log_prefix) { log_prefix_ = log_prefix; }
+
+  // Reads the next message and rebuilds its text line, prefix and trailing
+  // newline included.  Returns false at the end of the file; *error is
+  // left empty there, and describes the problem if the file is damaged.
+  // A record cut short by a crash ends the file silently.
+  bool Next(LogSeverity* severity, std::string* line, std::string* error);
+
+ private:
+  struct Site {
+    Site() : severity(0), line(0), defined(false) {}
+
+    LogSeverity severity;
+    int line;
+    std::string file;
+    std::string format;
+    bool defined;
+  };
+
+  bool Fill(size_t n);
+  bool ReadVarint(uint64* value);
+  bool ReadSignedVarint(int64* value);
+  bool ReadString(std::string* out, bool* is_null);
+
+  FILE* file_;
+  std::vector<char> buffer_;
+  size_t pos_;
+  size_t end_;
+  bool eof_;
+  std::vector<Site> sites_;
+  int64 timestamp_usec_;
+  int64 gmtoff_;
+  bool log_prefix_;
+
+  BinaryLogReader(const BinaryLogReader&);
+  void operator=(const BinaryLogReader&);
+};
+
+namespace binary_logging_internal {
+
+// Never called; lets the compiler check LOG_BINARY arguments against the
+// format.
+#if defined(__GNUC__)
+void CheckFormat(const char* format, ...)
+    __attribute__((format(printf, 1, 2)));
+#else
+void CheckFormat(const char* format, ...);
+#endif
+
+inline BinaryLogArg Signed(int64 value) {
+  BinaryLogArg arg;
+  arg.type = BinaryLogArg::SIGNED;
+  arg.i = value;
+  return arg;
+}
+
+inline BinaryLogArg Unsigned(uint64 value) {
+  BinaryLogArg arg;
+  arg.type = BinaryLogArg::UNSIGNED;
+  arg.u = value;
+  return arg;
+}
+
+inline BinaryLogArg MakeArg(bool v) { return Signed(v); }
+inline BinaryLogArg MakeArg(char v) { return Signed(v); }
+inline BinaryLogArg MakeArg(signed char v) { return Signed(v); }
+inline BinaryLogArg MakeArg(short v) { return Signed(v); }
+inline BinaryLogArg MakeArg(int v) { return Signed(v); }
+inline BinaryLogArg MakeArg(long v) { return Signed(v); }
+inline BinaryLogArg MakeArg(long long v) { return Signed(v); }
+inline BinaryLogArg MakeArg(unsigned char v) { return Unsigned(v); }
+inline BinaryLogArg MakeArg(unsigned short v) { return Unsigned(v); }
+inline BinaryLogArg MakeArg(unsigned int v) { return Unsigned(v); }
+inline BinaryLogArg MakeArg(unsigned long v) { return Unsigned(v); }
+inline BinaryLogArg MakeArg(unsigned long long v) { return Unsigned(v); }
+
+inline BinaryLogArg MakeArg(double v) {
+  BinaryLogArg arg;
+  arg.type = BinaryLogArg::DOUBLE;
+  arg.d = v;
+  return arg;
+}
+inline BinaryLogArg MakeArg(float v) { return MakeArg(static_cast<double>(v)); }
+inline BinaryLogArg MakeArg(long double v) {
+  return MakeArg(static_cast<double>(v));
+}
+
+inline BinaryLogArg MakeArg(const char* v) {
+  BinaryLogArg arg;
+  arg.type = BinaryLogArg::STRING;
+  arg.s = v;
+  return arg;
+}
+inline BinaryLogArg MakeArg(char* v) { return MakeArg(const_cast<const char*>(v)); }
+
+inline BinaryLogArg MakeArg(const void* v) {
+  BinaryLogArg arg;
+  arg.type = BinaryLogArg::POINTER;
+  arg.p = v;
+  return arg;
+}
+template <typename T>
+inline BinaryLogArg MakeArg(T* v) { return MakeArg(static_cast<const void*>(v)); }
+
+#if __cplusplus >= 201103L
+template <typename... Args>
+inline void Log(BinaryLogSite* site, const Args&... args) {
+  // One spare element so that messages without arguments compile.
+  const BinaryLogArg packed[sizeof...(Args) + 1] = { MakeArg(args)... };
+  LogBinaryMessage(site, packed, sizeof...(Args));
+}
+#endif
+
+}  // namespace binary_logging_internal
+
+}  // namespace google
+
+#if __cplusplus >= 201103L
+#define LOG_BINARY(severity, format, ...)                                   \
+  do {                                                                      \
+    static google::BinaryLogSite google_binary_log_site_ = {                \
+        __FILE__, __LINE__, google::GLOG_ ## severity, "" format, 0 };      \
+    if (false) {                                                            \
+      google::binary_logging_internal::CheckFormat(format, ##__VA_ARGS__);  \
+    }                                                                       \
+    google::binary_logging_internal::Log(&google_binary_log_site_,          \
+                                         ##__VA_ARGS__);                    \
+  } while (0)
+#endif
+
+#endif  // BASE_BINARY_LOGGING_H_
@@ -191,6 +191,27 @@ typedef unsigned __int64 uint64;
 //
 // Outputs log messages for the first 20 times it is executed.
 //
+// You can also limit how often a line logs over time, whatever the number
+// of threads running it:
+//
+//   LOG_EVERY_MS(WARNING, 1000) << "Queue is full, dropping " << item;
+//
+// logs at most once a second, and
+//
+//   LOG_RATE_LIMITED(INFO, 10, 50) << "Retrying " << request;
+//
+// lets bursts of up to 50 messages through, refilled at 10 messages per
+// second.  Messages that are not logged are counted, and the next one that
+// is, is preceded by "Suppressed N messages from this site".  The limits
+// must be positive; a rate below one message per second is treated as one
+// per second.  google::COUNTER is not available with these macros.
+//
+// A suppressed message is not free: it reads the monotonic clock (a vDSO
+// call on Linux, no system call) to compare it with the site's deadline,
+// which it loads relaxed, and increments a thread-local counter.  It takes
+// no lock, and only every 256th one per thread writes to the site (every
+// one, where there is no thread_local).
+//
 // Analogous SYSLOG, SYSLOG_IF, and SYSLOG_EVERY_N macros are available.
 // These log to syslog as well as to the normal logs.  If you use these at
 // all, you need to be aware that syslog can drastically reduce performance,
@@ -346,6 +367,13 @@ DECLARE_int32(stderrthreshold);
 // Set whether the log prefix should be prepended to each line of output.
 DECLARE_bool(log_prefix);
 
+// Set whether log timestamps come from a cheaper, coarser clock
+// (CLOCK_REALTIME_COARSE) where the platform has one.
+DECLARE_bool(log_coarse_clock);
+
+// Set whether LOG_BINARY messages go to the binary log, see binary_logging.h.
+DECLARE_bool(log_binary);
+
 // Log messages at a level <= this flag are buffered.
 // Log messages at a higher level are flushed immediately.
 DECLARE_int32(logbuflevel);
@@ -373,6 +401,10 @@ DECLARE_int32(v);  // in vlog_is_on.cc
 // Sets the maximum log file size (in MB).
 DECLARE_int32(max_log_size);
 
+// If positive, log files are replaced by one fixed-size ring of this many
+// KB, see ring_logging.h.
+DECLARE_int32(log_ring_kb);
+
 // Sets whether to avoid logging to the disk if the disk is full.
 DECLARE_bool(stop_logging_if_full_disk);
 
@@ -955,6 +987,96 @@ bool IsFailureSignalHandlerInstalled();
 #define LOG_IF_EVERY_N(severity, condition, n) \
   SOME_KIND_OF_LOG_IF_EVERY_N(severity, (condition), (n), google::LogMessage::SendToLog)
 
+// LOG_EVERY_MS() and LOG_RATE_LIMITED() keep a token bucket per site: the
+// earliest time at which the site may log again, and how many messages it
+// suppressed since it last did.  Threads count the messages they suppress
+// in a thread-local counter and merge it into the site's every
+// kLogRateLimitMergeCount messages, or as soon as the site may log again,
+// so a suppressed message reads the clock and one shared word with a
+// relaxed load, and writes nothing shared.  The first message logged after
+// some were suppressed is preceded by a line saying how many.
+struct LogRateLimitSite {
+  const char* file;
+  int line;
+  LogSeverity severity;
+  int64 next_usec;        // updated by compare-and-swap
+  int32 suppressed;       // merged from the threads' counts
+};
+
+const int32 kLogRateLimitMergeCount = 256;
+
+// Microseconds on a monotonic clock.
+GOOGLE_GLOG_DLL_DECL int64 LogRateLimitNowUsec();
+
+// The slow paths of LogRateLimitAllows__: taking a token when the site may
+// log, and merging a thread's count of suppressed messages into the site's.
+// "suppressed_here" is NULL when there is no thread-local storage, and
+// suppressed messages are then added to the site directly.
+GOOGLE_GLOG_DLL_DECL bool LogRateLimitAcquire__(LogRateLimitSite* site,
+                                                int64 now_usec,
+                                                int64 interval_usec,
+                                                int32 burst,
+                                                int32* suppressed_here);
+GOOGLE_GLOG_DLL_DECL void LogRateLimitMerge__(LogRateLimitSite* site,
+                                              int32* suppressed_here);
+
+// Whether a message may be logged at "site", which lets "burst" messages
+// through at once and then one every "interval_usec".
+inline bool LogRateLimitAllows__(LogRateLimitSite* site, int64 interval_usec,
+                                 int32 burst, int32* suppressed_here) {
+  const int64 now_usec = LogRateLimitNowUsec();
+#if defined(__GNUC__)
+  const int64 next_usec = __atomic_load_n(&site->next_usec, __ATOMIC_RELAXED);
+#else
+  const int64 next_usec = *static_cast<volatile int64*>(&site->next_usec);
+#endif
+  if (GOOGLE_PREDICT_TRUE(now_usec < next_usec)) {
+    if (suppressed_here == NULL ||
+        GOOGLE_PREDICT_BRANCH_NOT_TAKEN(++*suppressed_here >=
+                                        kLogRateLimitMergeCount)) {
+      LogRateLimitMerge__(site, suppressed_here);
+    }
+    return false;
+  }
+  return LogRateLimitAcquire__(site, now_usec, interval_usec, burst,
+                               suppressed_here);
+}
+
+// The interval of LOG_RATE_LIMITED(), which keeps a rate of zero or less
+// from dividing by zero.
+inline int64 LogRateLimitIntervalUsec__(int64 per_second) {
+  return 1000000 / (per_second > 1 ? per_second : 1);
+}
+
+#define LOG_RATE_LIMIT_SITE LOG_EVERY_N_VARNAME(rate_limit_site_, __LINE__)
+#define LOG_RATE_LIMIT_SUPPRESSED \
+  LOG_EVERY_N_VARNAME(rate_limit_suppressed_, __LINE__)
+
+#if !defined(GLOG_NO_THREAD_LOCAL_STORAGE) && __cplusplus >= 201103L
+#define SOME_KIND_OF_LOG_RATE_LIMITED(severity, interval_usec, burst) \
+  static google::LogRateLimitSite LOG_RATE_LIMIT_SITE = { \
+      __FILE__, __LINE__, google::GLOG_ ## severity, 0, 0 }; \
+  static thread_local google::int32 LOG_RATE_LIMIT_SUPPRESSED = 0; \
+  if (google::LogRateLimitAllows__(&LOG_RATE_LIMIT_SITE, (interval_usec), \
+                                   (burst), &LOG_RATE_LIMIT_SUPPRESSED)) \
+    google::LogMessage(__FILE__, __LINE__, google::GLOG_ ## severity).stream()
+#else
+#define SOME_KIND_OF_LOG_RATE_LIMITED(severity, interval_usec, burst) \
+  static google::LogRateLimitSite LOG_RATE_LIMIT_SITE = { \
+      __FILE__, __LINE__, google::GLOG_ ## severity, 0, 0 }; \
+  if (google::LogRateLimitAllows__(&LOG_RATE_LIMIT_SITE, (interval_usec), \
+                                   (burst), NULL)) \
+    google::LogMessage(__FILE__, __LINE__, google::GLOG_ ## severity).stream()
+#endif
+
+#define LOG_EVERY_MS(severity, ms) \
+  SOME_KIND_OF_LOG_RATE_LIMITED(severity, \
+      static_cast<google::int64>(ms) * 1000, 1)
+
+#define LOG_RATE_LIMITED(severity, per_second, burst) \
+  SOME_KIND_OF_LOG_RATE_LIMITED(severity, \
+      google::LogRateLimitIntervalUsec__(per_second), (burst))
+
 // We want the special COUNTER value available for LOG_EVERY_X()'ed messages
 enum PRIVATE_Counter {COUNTER};
 
@@ -1574,6 +1696,67 @@ extern GOOGLE_GLOG_DLL_DECL Logger* GetLogger(LogSeverity level);
 // be deleted by the caller.  Thread-safe.
 extern GOOGLE_GLOG_DLL_DECL void SetLogger(LogSeverity level, Logger* logger);
 
+// A Logger that takes file I/O off the logging threads.  Write() copies
+// the message into a bounded ring buffer without taking a lock, and a
+// background writer thread drains the buffer in batches, either into a
+// wrapped Logger (one Write() per batch) or straight to a file descriptor
+// (one writev() per batch).
+//
+// Write(force_flush=true) only asks the writer to flush after the batch
+// containing that message.  Flush(), and the empty forced write that a
+// FATAL message issues before aborting, wait synchronously until every
+// message accepted so far has been written.  Call FlushLogFiles() before
+// exiting normally, since messages still in the buffer are lost at exit.
+//
+// Once passed to SetLogger(), an AsyncLogger belongs to the logging module:
+// ShutdownGoogleLogging() deletes it, which writes the messages still in
+// the buffer and stops the writer thread, before it frees the Logger that
+// the AsyncLogger wraps.  Do not delete it yourself.
+//
+// Typical use, for every severity:
+//   base::SetLogger(GLOG_INFO,
+//                   new base::AsyncLogger(base::GetLogger(GLOG_INFO)));
+class GOOGLE_GLOG_DLL_DECL AsyncLogger : public Logger {
+ public:
+  // What Write() does when the ring buffer is full.
+  enum OverflowPolicy {
+    BLOCK_ON_OVERFLOW,  // wait for the writer to make room
+    DROP_ON_OVERFLOW,   // discard the message
+    COUNT_ON_OVERFLOW   // discard it, and have the writer report how many
+                        // messages were lost
+  };
+
+  // Writes batches to "wrapped", which is not owned.  buffer_size is the
+  // ring buffer capacity in bytes; each message also uses 16 bytes of
+  // bookkeeping.
+  explicit AsyncLogger(Logger* wrapped,
+                       size_t buffer_size = 4 << 20,
+                       OverflowPolicy policy = BLOCK_ON_OVERFLOW);
+
+  // Writes batches to "fd", which is not closed.
+  AsyncLogger(int fd, size_t buffer_size, OverflowPolicy policy);
+
+  // Drains the buffer and stops the writer thread.
+  virtual ~AsyncLogger();
+
+  virtual void Write(bool force_flush,
+                     time_t timestamp,
+                     const char* message,
+                     int message_len);
+  virtual void Flush();
+  virtual uint32 LogSize();
+
+  // Number of messages discarded because the buffer was full.
+  uint64 dropped_messages() const;
+
+ private:
+  struct Impl;
+  Impl* impl_;
+
+  AsyncLogger(const AsyncLogger&);
+  void operator=(const AsyncLogger&);
+};
+
 }
 
 // glibc has traditionally implemented two incompatible versions of
@@ -0,0 +1,98 @@
+// Copyright (c) 2008, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Ring logging.
+//
+// With --log_ring_kb=N all log messages go to a single file of N KB in the
+// first usable log directory,
+//
+//    <program>.<hostname>.<user>.log.RING
+//
+// instead of the per-severity log files.  The file is created at its full
+// size and mapped into memory; messages are copied into the mapping, each
+// with a sequence number, and overwrite the oldest ones once it is full.
+// Logging to it makes no system calls, and it never grows: there is no
+// rolling over, no symlink, no TruncateLogFile().
+//
+// Since the messages live in the mapping, they survive a crash of the
+// process (not of the machine) without being flushed; FlushLogFiles()
+// schedules them to be written back.  A program that restarts continues the
+// ring where it left off, sequence numbers included.  Only one process can
+// use a ring at a time: another instance of the program, or a child after
+// fork(), logs to the usual files instead.
+//
+// glog-ring (src/tools/glog_ring.cc) prints the messages of a ring file in
+// order.
+
+#ifndef BASE_RING_LOGGING_H_
+#define BASE_RING_LOGGING_H_
+
+#include <string>
+#include <vector>
+
+#include "glog/logging.h"
+
+namespace google {
+
+// Reads the messages of a ring log file, oldest first, for glog-ring.
+// The file may belong to a running program; messages it overwrites while
+// the file is being read are missed, not garbled.
+class GOOGLE_GLOG_DLL_DECL RingLogReader {
+ public:
+  RingLogReader();
+
+  // Reads "path", which must be a ring log file.  Returns false and sets
+  // *error otherwise.
+  bool Open(const char* path, std::string* error);
+
+  // The sequence numbers of the oldest message and of the one the writer
+  // would log next.  first_sequence() == next_sequence() for an empty ring.
+  uint64 first_sequence() const { return first_sequence_; }
+  uint64 next_sequence() const { return next_sequence_; }
+
+  // Reads the next message: its text, as it would have appeared in the log
+  // file, prefix and trailing newline included.  Returns false after the
+  // last one.
+  bool Next(LogSeverity* severity, uint64* sequence, std::string* text);
+
+ private:
+  std::vector<char> file_;
+  uint64 data_size_;
+  uint64 offset_;
+  uint64 sequence_;
+  uint64 first_sequence_;
+  uint64 next_sequence_;
+
+  RingLogReader(const RingLogReader&);
+  void operator=(const RingLogReader&);
+};
+
+}  // namespace google
+
+#endif  // BASE_RING_LOGGING_H_
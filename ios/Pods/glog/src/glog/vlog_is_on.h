@@ -52,8 +52,8 @@
 //                    for all code in source files "my_module.*" and "foo*.*"
 //                    ("-inl" suffixes are also disregarded for this matching).
 //
-// SetVLOGLevel helper function is provided to do limited dynamic control over
-// V-logging by overriding the per-module settings given via --vmodule flag.
+// SetVLOGLevel and SetVModule change the per-module settings given via
+// the --vmodule flag at runtime; every VLOG_IS_ON site picks up the change.
 //
 // CAVEAT: --vmodule functionality is not available in non gcc compilers.
 //
@@ -73,20 +73,25 @@
 #endif
 
 #if defined(__GNUC__)
-// We emit an anonymous static int* variable at every VLOG_IS_ON(n) site.
-// (Normally) the first time every VLOG_IS_ON(n) site is hit,
-// we determine what variable will dynamically control logging at this site:
-// it's either FLAGS_v or an appropriate internal variable
-// matching the current source file that represents results of
-// parsing of --vmodule flag and/or SetVLOGLevel calls.
+// We emit an anonymous static VLogSite at every VLOG_IS_ON(n) site.
+// The first time a site is hit it registers itself and is given the level
+// of the first --vmodule pattern that matches its source file, or
+// kVLogSiteUsesFlagV when none does, in which case FLAGS_v controls it.
+// SetVLOGLevel and SetVModule re-evaluate all registered sites, so the
+// check at the site is a relaxed load of its level (plus a read of FLAGS_v,
+// which may be assigned directly, for sites no pattern matches).
 #define VLOG_IS_ON(verboselevel)                                \
   __extension__  \
-  ({ static google::int32* vlocal__ = &google::kLogSiteUninitialized;           \
-     google::int32 verbose_level__ = (verboselevel);                    \
-     (*vlocal__ >= verbose_level__) &&                          \
-     ((vlocal__ != &google::kLogSiteUninitialized) ||                   \
-      (google::InitVLOG3__(&vlocal__, &FLAGS_v,                         \
-                   __FILE__, verbose_level__))); })
+  ({ static google::VLogSite vlog_site__ = {                        \
+       google::kVLogSiteUninitialized, __FILE__, 0, 0 };            \
+     google::int32 verbose_level__ = (verboselevel);                \
+     google::int32 site_level__ =                                   \
+         __atomic_load_n(&vlog_site__.level, __ATOMIC_RELAXED); \
+     (site_level__ >= verbose_level__) ?                        \
+       ((site_level__ != google::kVLogSiteUninitialized) ||         \
+        (google::InitVLOGSite__(&vlog_site__, verbose_level__))) :  \
+       ((site_level__ == google::kVLogSiteUsesFlagV) &&             \
+        (FLAGS_v >= verbose_level__)); })
 #else
 // GNU extensions not available, so we do not support --vmodule.
 // Dynamic value of FLAGS_v always controls the logging level.
@@ -96,16 +101,47 @@
 // Set VLOG(_IS_ON) level for module_pattern to log_level.
 // This lets us dynamically control what is normally set by the --vmodule flag.
 // Returns the level that previously applied to module_pattern.
-// NOTE: To change the log level for VLOG(_IS_ON) sites
-//	 that have already executed after/during InitGoogleLogging,
-//	 one needs to supply the exact --vmodule pattern that applied to them.
-//       (If no --vmodule pattern applied to them
-//       the value of FLAGS_v will continue to control them.)
+// The pattern takes precedence over the existing ones, and applies to the
+// sites that have already executed as well as to later ones.
 extern GOOGLE_GLOG_DLL_DECL int SetVLOGLevel(const char* module_pattern,
                                              int log_level);
 
+// Replace all per-module levels, those from --vmodule and SetVLOGLevel, by
+// the ones in "vmodule", which has the syntax of the --vmodule flag.
+// Sites that no pattern matches go back to being controlled by FLAGS_v.
+extern GOOGLE_GLOG_DLL_DECL void SetVModule(const char* vmodule);
+
 // Various declarations needed for VLOG_IS_ON above: =========================
 
+// The state of one VLOG_IS_ON site.
+struct VLogSite {
+  // The verbosity level at or below which the site logs, written with
+  // atomic stores; or one of the special values below.
+  google::int32 level;
+  const char* file;
+  // Next site in the registry of sites SetVLOGLevel updates.
+  VLogSite* next;
+  google::int32 registered;
+};
+
+// Special values of VLogSite::level.  kVLogSiteUninitialized is large so
+// that the common-case check of "level >= verbose_level__" passes and
+// InitVLOGSite__ is then triggered; per-module levels are kept below it.
+enum {
+  kVLogSiteUninitialized = 1000,
+  kVLogSiteUsesFlagV = -2147483647 - 1
+};
+
+// Registers a VLOG_IS_ON site the first time it is hit and resolves its
+// level.  Returns the return value for VLOG_IS_ON.
+extern GOOGLE_GLOG_DLL_DECL bool InitVLOGSite__(
+    VLogSite* site,
+    google::int32 verbose_level);
+
+// The pointer-based site initialization below is what VLOG_IS_ON expanded
+// to in earlier versions of this header; it is kept for code compiled
+// against them.
+
 // Special value used to indicate that a VLOG_IS_ON site has not been
 // initialized.  We make this a large value, so the common-case check
 // of "*vlocal__ >= verbose_level__" in VLOG_IS_ON definition
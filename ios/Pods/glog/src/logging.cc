@@ -34,6 +34,7 @@
 #include <algorithm>
 #include <assert.h>
 #include <iomanip>
+#include <new>
 #include <string>
 #ifdef HAVE_UNISTD_H
 # include <unistd.h>  // For _exit.
@@ -45,6 +46,9 @@
 # include <sys/utsname.h>  // For uname.
 #endif
 #include <fcntl.h>
+#if !defined(OS_WINDOWS)
+# include <sys/mman.h>  // For mmap, for the ring log.
+#endif
 #include <cstdio>
 #include <iostream>
 #include <stdarg.h>
@@ -59,8 +63,10 @@
 #include <errno.h>                   // for errno
 #include <sstream>
 #include "base/commandlineflags.h"        // to get the program name
+#include "glog/binary_logging.h"
 #include "glog/logging.h"
 #include "glog/raw_logging.h"
+#include "glog/ring_logging.h"
 #include "base/googleinit.h"
 
 #ifdef HAVE_STACKTRACE
@@ -136,6 +142,13 @@ GLOG_DEFINE_string(alsologtoemail, "",
                    "in addition to logfiles");
 GLOG_DEFINE_bool(log_prefix, true,
                  "Prepend the log prefix to the start of each log line");
+GLOG_DEFINE_bool(log_coarse_clock, false,
+                 "Timestamp log messages with CLOCK_REALTIME_COARSE where "
+                 "available: cheaper to read, but only accurate to a few "
+                 "milliseconds");
+GLOG_DEFINE_bool(log_binary, false,
+                 "Record LOG_BINARY messages in a compact binary log file, "
+                 "to be read with glog-decode, instead of formatting them");
 GLOG_DEFINE_int32(minloglevel, 0, "Messages logged at a lower level than this don't "
                   "actually get logged anywhere");
 GLOG_DEFINE_int32(logbuflevel, 0,
@@ -177,6 +190,12 @@ GLOG_DEFINE_int32(max_log_size, 1800,
                   "approx. maximum log file size (in MB). A value of 0 will "
                   "be silently overridden to 1.");
 
+GLOG_DEFINE_int32(log_ring_kb, 0,
+                  "If positive, log to a memory-mapped ring file of this many "
+                  "KB, which overwrites its oldest messages when full, "
+                  "instead of to the per-severity log files.  Values below "
+                  "64 are silently raised to 64.");
+
 GLOG_DEFINE_bool(stop_logging_if_full_disk, false,
                  "Stop attempting to log to disk if the disk is full.");
 
@@ -448,6 +467,122 @@ class LogFileObject : public base::Logger {
   bool CreateLogfile(const string& time_pid_string);
 };
 
+// Incremented in the child after fork(), so that the binary log notices a
+// fork without a getpid() system call per message.  Without pthreads the
+// pid itself plays this part.
+static int fork_generation = 0;
+
+#ifdef HAVE_PTHREAD
+static void CountFork() {
+  ++fork_generation;
+}
+#endif
+
+int ForkGeneration() {
+#ifdef HAVE_PTHREAD
+  return fork_generation;
+#else
+  return getpid();
+#endif
+}
+
+// Makes ForkGeneration() count forks from now on.
+static void WatchForks() {
+#ifdef HAVE_PTHREAD
+  static bool fork_handler_installed = false;
+  if (!fork_handler_installed) {
+    pthread_atfork(NULL, NULL, &CountFork);
+    fork_handler_installed = true;
+  }
+#endif
+}
+
+// The --log_binary file, which holds the LOG_BINARY messages of all
+// severities.  Like LogFileObject it rolls over at --max_log_size and
+// flushes according to --logbuflevel and --logbufsecs.
+// REQUIRES: log_mutex is held for all calls
+class BinaryLogFile {
+ public:
+  BinaryLogFile();
+  ~BinaryLogFile();
+
+  void Write(bool force_flush,
+             BinaryLogSite* site,
+             time_t timestamp,
+             int usecs,
+             long gmtoff,            // of the local time zone, in seconds
+             pid_t tid,
+             const BinaryLogArg* args,
+             size_t nargs);
+  void Flush();
+
+ private:
+  static const uint32 kRolloverAttemptFrequency = 0x20;
+  // Records are collected in buffer_ and written out in pieces this big.
+  static const size_t kWriteSize = 64 << 10;
+
+  FILE* file_;
+  int fork_generation_;           // ForkGeneration() when file_ was created
+  uint32 bytes_since_flush_;
+  uint32 file_length_;
+  unsigned int rollover_attempt_;
+  int64 next_flush_time_;         // cycle count at which to flush log
+
+  // What the records written to file_ so far have established: the sites
+  // defined (indexed by site id), the local time zone, and the timestamp
+  // of the last message, which the next one is stored relative to.
+  vector<bool> defined_sites_;
+  bool has_gmtoff_;
+  long gmtoff_;
+  int64 last_usec_;
+
+  string buffer_;                 // encoded records not yet written
+
+  bool CreateLogfile(time_t timestamp);
+  // Hands buffer_ to file_.  Returns false if the disk is full.
+  bool WriteBuffer();
+};
+
+// The --log_ring_kb file, which takes the messages of all severities in
+// place of the LogFileObjects; see glog/ring_logging.h.
+// REQUIRES: log_mutex is held for all calls
+class RingLogFile {
+ public:
+  RingLogFile();
+  ~RingLogFile();
+
+  // Returns false if the ring can't be used, and the message should go to
+  // the usual log files instead.
+  bool Write(LogSeverity severity, const char* message, size_t len);
+  void Flush();
+
+ private:
+  // Whether the ring has been opened, or could not be.
+  bool opened_;
+  int fd_;
+  char* map_;
+  size_t map_size_;
+  int fork_generation_;           // ForkGeneration() when map_ was created
+  RingLogHeader* header_;
+  char* ring_;
+  uint64 data_size_;
+  // The positions, which header_ has a copy of.
+  uint64 first_offset_;
+  uint64 first_sequence_;
+  uint64 next_offset_;
+  uint64 next_sequence_;
+
+  bool Open();
+  void Close();
+  // Copies the positions to header_.
+  void UpdateHeader();
+  // Forgets the records that start in [begin, end) of the ring, which is
+  // about to be overwritten.
+  void DropRecords(uint64 begin, uint64 end);
+  // Writes a record at next_offset_ and moves it on.
+  void PutRecord(uint32 severity, const char* text, uint32 length);
+};
+
 }  // namespace
 
 class LogDestination {
@@ -484,6 +619,10 @@ class LogDestination {
 
   static void DeleteLogDestinations();
 
+  // Logs a LOG_BINARY message, see LogBinaryMessage().
+  static void LogBinary(BinaryLogSite* site,
+                        const BinaryLogArg* args, size_t nargs);
+
  private:
   LogDestination(LogSeverity severity, const char* base_filename);
   ~LogDestination() { }
@@ -508,6 +647,10 @@ class LogDestination {
   static void LogToAllLogfiles(LogSeverity severity,
                                time_t timestamp,
                                const char* message, size_t len);
+  // Log a message to the --log_ring_kb file.  Returns false if there
+  // isn't one.
+  static bool LogToRing(LogSeverity severity,
+                        const char* message, size_t len);
 
   // Send logging info to all registered sinks.
   static void LogToSinks(LogSeverity severity,
@@ -519,7 +662,7 @@ class LogDestination {
                          size_t message_len);
 
   // Wait for all registered sinks via WaitTillSent
-  // including the optional one in "data".
+  // including the optional one in "data", which may be NULL.
   static void WaitForSinks(LogMessage::LogMessageData* data);
 
   static LogDestination* log_destination(LogSeverity severity);
@@ -528,6 +671,8 @@ class LogDestination {
   base::Logger* logger_;      // Either &fileobject_, or wrapper around it
 
   static LogDestination* log_destinations_[NUM_SEVERITIES];
+  static BinaryLogFile* binary_log_file_;   // created on first use
+  static RingLogFile* ring_log_file_;       // created on first use
   static LogSeverity email_logging_severity_;
   static string addresses_;
   static string hostname_;
@@ -583,6 +728,12 @@ inline void LogDestination::FlushLogFilesUnsafe(int min_severity) {
       log->fileobject_.FlushUnlocked();
     }
   }
+  if (binary_log_file_ != NULL) {
+    binary_log_file_->Flush();
+  }
+  if (ring_log_file_ != NULL) {
+    ring_log_file_->Flush();
+  }
 }
 
 inline void LogDestination::FlushLogFiles(int min_severity) {
@@ -595,6 +746,12 @@ inline void LogDestination::FlushLogFiles(int min_severity) {
       log->logger_->Flush();
     }
   }
+  if (binary_log_file_ != NULL) {
+    binary_log_file_->Flush();
+  }
+  if (ring_log_file_ != NULL) {
+    ring_log_file_->Flush();
+  }
 }
 
 inline void LogDestination::SetLogDestination(LogSeverity severity,
@@ -771,12 +928,23 @@ inline void LogDestination::LogToAllLogfiles(LogSeverity severity,
 
   if ( FLAGS_logtostderr ) {           // global flag: never log to file
     ColoredWriteToStderr(severity, message, len);
+  } else if (FLAGS_log_ring_kb > 0 && LogToRing(severity, message, len)) {
+    // The ring holds the messages of all severities once.
   } else {
     for (int i = severity; i >= 0; --i)
       LogDestination::MaybeLogToLogfile(i, timestamp, message, len);
   }
 }
 
+inline bool LogDestination::LogToRing(LogSeverity severity,
+                                      const char* message,
+                                      size_t len) {
+  if (ring_log_file_ == NULL) {
+    ring_log_file_ = new RingLogFile;
+  }
+  return ring_log_file_->Write(severity, message, len);
+}
+
 inline void LogDestination::LogToSinks(LogSeverity severity,
                                        const char *full_filename,
                                        const char *base_filename,
@@ -800,6 +968,9 @@ inline void LogDestination::WaitForSinks(LogMessage::LogMessageData* data) {
       (*sinks_)[i]->WaitTillSent();
     }
   }
+  if (data == NULL) {
+    return;
+  }
   const bool send_to_sink =
       (data->send_method_ == &LogMessage::SendToSink) ||
       (data->send_method_ == &LogMessage::SendToSinkAndLog);
@@ -809,6 +980,8 @@ inline void LogDestination::WaitForSinks(LogMessage::LogMessageData* data) {
 }
 
 LogDestination* LogDestination::log_destinations_[NUM_SEVERITIES];
+BinaryLogFile* LogDestination::binary_log_file_ = NULL;
+RingLogFile* LogDestination::ring_log_file_ = NULL;
 
 inline LogDestination* LogDestination::log_destination(LogSeverity severity) {
   assert(severity >=0 && severity < NUM_SEVERITIES);
@@ -819,10 +992,33 @@ inline LogDestination* LogDestination::log_destination(LogSeverity severity) {
 }
 
 void LogDestination::DeleteLogDestinations() {
+  // A logger set with SetLogger() belongs to the logging module, and may
+  // wrap the fileobject_ of a destination: an AsyncLogger's writer thread
+  // keeps calling into it.  Delete all of them, which drains and stops an
+  // AsyncLogger, before any destination is freed.
+  for (int severity = 0; severity < NUM_SEVERITIES; ++severity) {
+    LogDestination* log = log_destinations_[severity];
+    if (log == NULL || log->logger_ == &log->fileobject_) {
+      continue;
+    }
+    base::Logger* logger = log->logger_;
+    // The same logger may have been set for several severities.
+    for (int i = severity; i < NUM_SEVERITIES; ++i) {
+      LogDestination* other = log_destinations_[i];
+      if (other != NULL && other->logger_ == logger) {
+        other->logger_ = &other->fileobject_;
+      }
+    }
+    delete logger;
+  }
   for (int severity = 0; severity < NUM_SEVERITIES; ++severity) {
     delete log_destinations_[severity];
     log_destinations_[severity] = NULL;
   }
+  delete binary_log_file_;
+  binary_log_file_ = NULL;
+  delete ring_log_file_;
+  ring_log_file_ = NULL;
   MutexLock l(&sink_mutex_);
   delete sinks_;
   sinks_ = NULL;
@@ -1127,6 +1323,481 @@ void LogFileObject::Write(bool force_flush,
   }
 }
 
+// Encoding of binary log records, see binary_logging.cc for the format.
+void PutVarint(string* out, uint64 value) {
+  while (value >= 0x80) {
+    out->push_back(static_cast<char>(value | 0x80));
+    value >>= 7;
+  }
+  out->push_back(static_cast<char>(value));
+}
+
+void PutSignedVarint(string* out, int64 value) {
+  PutVarint(out, (static_cast<uint64>(value) << 1) ^
+                 static_cast<uint64>(value >> 63));
+}
+
+void PutString(string* out, const char* s) {
+  if (s == NULL) {
+    PutVarint(out, 0);
+    return;
+  }
+  const size_t len = strlen(s);
+  PutVarint(out, len + 1);
+  out->append(s, len);
+}
+
+BinaryLogFile::BinaryLogFile()
+  : file_(NULL),
+    fork_generation_(0),
+    bytes_since_flush_(0),
+    file_length_(0),
+    rollover_attempt_(kRolloverAttemptFrequency-1),
+    next_flush_time_(0),
+    has_gmtoff_(false),
+    gmtoff_(0),
+    last_usec_(0) {
+  WatchForks();
+}
+
+BinaryLogFile::~BinaryLogFile() {
+  if (file_ != NULL) {
+    WriteBuffer();
+    fclose(file_);
+    file_ = NULL;
+  }
+}
+
+bool BinaryLogFile::WriteBuffer() {
+  // As in LogFileObject::Write, fwrite() reports a full disk through errno.
+  errno = 0;
+  fwrite(buffer_.data(), 1, buffer_.size(), file_);
+  buffer_.clear();
+  if (FLAGS_stop_logging_if_full_disk && errno == ENOSPC) {
+    stop_writing = true;
+    return false;
+  }
+  return true;
+}
+
+void BinaryLogFile::Flush() {
+  if (file_ != NULL) {
+    WriteBuffer();
+    fflush(file_);
+    bytes_since_flush_ = 0;
+  }
+  const int64 next = (FLAGS_logbufsecs
+                      * static_cast<int64>(1000000));  // in usec
+  next_flush_time_ = CycleClock_Now() + UsecToCycles(next);
+}
+
+bool BinaryLogFile::CreateLogfile(time_t timestamp) {
+  struct ::tm tm_time;
+  localtime_r(&timestamp, &tm_time);
+
+  // Named like the text logs, with BINARY in place of the severity:
+  // webserver.examplehost.root.log.BINARY.19990817-150000.4354
+  ostringstream filename_stream;
+  filename_stream.fill('0');
+  filename_stream << 1900+tm_time.tm_year
+                  << setw(2) << 1+tm_time.tm_mon
+                  << setw(2) << tm_time.tm_mday
+                  << '-'
+                  << setw(2) << tm_time.tm_hour
+                  << setw(2) << tm_time.tm_min
+                  << setw(2) << tm_time.tm_sec
+                  << '.'
+                  << getpid();
+  string hostname;
+  GetHostName(&hostname);
+  string uidname = MyUserName();
+  if (uidname.empty()) uidname = "invalid-user";
+  const string symlink_basename =
+      string(glog_internal_namespace_::ProgramInvocationShortName()) +
+      ".BINARY";
+  const string basename =
+      string(glog_internal_namespace_::ProgramInvocationShortName()) + '.' +
+      hostname + '.' + uidname + ".log.BINARY." + filename_stream.str();
+
+  const vector<string>& log_dirs = GetLoggingDirectories();
+  for (vector<string>::const_iterator dir = log_dirs.begin();
+       dir != log_dirs.end();
+       ++dir) {
+    const string filename = *dir + "/" + basename;
+    int fd = open(filename.c_str(), O_WRONLY | O_CREAT | O_EXCL,
+                  FLAGS_logfile_mode);
+    if (fd == -1) continue;
+#ifdef HAVE_FCNTL
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+#endif
+    file_ = fdopen(fd, "a");
+    if (file_ == NULL) {
+      close(fd);
+      unlink(filename.c_str());
+      continue;
+    }
+    // Records are buffered in buffer_ already.  Leaving nothing in stdio
+    // also means a forked child has nothing of its parent's to write.
+    setvbuf(file_, NULL, _IONBF, 0);
+
+#if defined(HAVE_UNISTD_H) && !defined(OS_WINDOWS)
+    // <program_name>.BINARY points at the latest file, as for text logs.
+    const string linkpath = *dir + "/" + symlink_basename;
+    unlink(linkpath.c_str());
+    if (symlink(basename.c_str(), linkpath.c_str()) != 0) {
+      // silently ignore failures
+    }
+#endif
+
+    buffer_.assign(kBinaryLogMagic, kBinaryLogMagicLen);
+    fork_generation_ = ForkGeneration();
+    file_length_ = bytes_since_flush_ = kBinaryLogMagicLen;
+    defined_sites_.clear();
+    has_gmtoff_ = false;
+    last_usec_ = 0;
+    return true;
+  }
+  perror("Could not create binary logging file");
+  fprintf(stderr, "COULD NOT CREATE A BINARY LOGGINGFILE %s!\n",
+          basename.c_str());
+  return false;
+}
+
+void BinaryLogFile::Write(bool force_flush,
+                          BinaryLogSite* site,
+                          time_t timestamp,
+                          int usecs,
+                          long gmtoff,
+                          pid_t tid,
+                          const BinaryLogArg* args,
+                          size_t nargs) {
+  static uint32 next_site_id = 1;
+
+  // After a fork the child starts a file of its own; what the parent had
+  // buffered is the parent's to write.
+  const bool forked = (file_ != NULL && fork_generation_ != ForkGeneration());
+  if (forked || static_cast<int>(file_length_ >> 20) >= MaxLogSize()) {
+    if (file_ != NULL) {
+      if (forked) {
+        buffer_.clear();
+      } else {
+        WriteBuffer();
+      }
+      fclose(file_);
+    }
+    file_ = NULL;
+    file_length_ = bytes_since_flush_ = 0;
+    rollover_attempt_ = kRolloverAttemptFrequency-1;
+  }
+
+  if (file_ == NULL) {
+    // As in LogFileObject::Write, only retry every 32 messages.
+    if (++rollover_attempt_ != kRolloverAttemptFrequency) return;
+    rollover_attempt_ = 0;
+    if (!CreateLogfile(timestamp)) return;
+  }
+
+  if (stop_writing) {
+    if (CycleClock_Now() >= next_flush_time_)
+      stop_writing = false;  // check to see if disk has free space.
+    return;
+  }
+
+  const size_t start = buffer_.size();
+  if (site->id == 0) {
+    site->id = next_site_id++;
+  }
+  if (site->id >= defined_sites_.size()) {
+    defined_sites_.resize(site->id + 1, false);
+  }
+  if (!defined_sites_[site->id]) {
+    buffer_.push_back(kBinaryLogSiteTag);
+    PutVarint(&buffer_, site->id);
+    PutVarint(&buffer_, site->severity);
+    PutSignedVarint(&buffer_, site->line);
+    PutString(&buffer_, site->file);
+    PutString(&buffer_, site->format);
+    defined_sites_[site->id] = true;
+  }
+  if (!has_gmtoff_ || gmtoff != gmtoff_) {
+    buffer_.push_back(kBinaryLogZoneTag);
+    PutSignedVarint(&buffer_, gmtoff);
+    has_gmtoff_ = true;
+    gmtoff_ = gmtoff;
+  }
+
+  const int64 usec = static_cast<int64>(timestamp) * 1000000 + usecs;
+  buffer_.push_back(kBinaryLogMessageTag);
+  PutVarint(&buffer_, site->id);
+  PutSignedVarint(&buffer_, usec - last_usec_);
+  PutVarint(&buffer_, static_cast<unsigned int>(tid));
+  PutVarint(&buffer_, nargs);
+  last_usec_ = usec;
+  for (size_t i = 0; i < nargs; ++i) {
+    const BinaryLogArg& arg = args[i];
+    buffer_.push_back(static_cast<char>(arg.type));
+    switch (arg.type) {
+      case BinaryLogArg::SIGNED:
+        PutSignedVarint(&buffer_, arg.i);
+        break;
+      case BinaryLogArg::UNSIGNED:
+        PutVarint(&buffer_, arg.u);
+        break;
+      case BinaryLogArg::DOUBLE: {
+        uint64 bits;
+        memcpy(&bits, &arg.d, sizeof(bits));
+        for (int b = 0; b < 8; ++b) {
+          buffer_.push_back(static_cast<char>(bits >> (8 * b)));
+        }
+        break;
+      }
+      case BinaryLogArg::STRING:
+        PutString(&buffer_, arg.s);
+        break;
+      case BinaryLogArg::POINTER:
+        PutVarint(&buffer_, reinterpret_cast<uintptr_t>(arg.p));
+        break;
+    }
+  }
+
+  file_length_ += buffer_.size() - start;
+  bytes_since_flush_ += buffer_.size() - start;
+  if (buffer_.size() >= kWriteSize && !WriteBuffer()) {
+    return;
+  }
+
+  if (force_flush ||
+      (bytes_since_flush_ >= 1000000) ||
+      (CycleClock_Now() >= next_flush_time_)) {
+    Flush();
+  }
+}
+
+RingLogFile::RingLogFile()
+  : opened_(false),
+    fd_(-1),
+    map_(NULL),
+    map_size_(0),
+    fork_generation_(0),
+    header_(NULL),
+    ring_(NULL),
+    data_size_(0),
+    first_offset_(0),
+    first_sequence_(1),
+    next_offset_(0),
+    next_sequence_(1) {
+}
+
+RingLogFile::~RingLogFile() {
+  Flush();
+  Close();
+}
+
+void RingLogFile::Flush() {
+#if !defined(OS_WINDOWS)
+  // The messages are in the page cache already; just have them written
+  // back without waiting for it.
+  if (map_ != NULL) {
+    msync(map_, map_size_, MS_ASYNC);
+  }
+#endif
+}
+
+void RingLogFile::Close() {
+#if !defined(OS_WINDOWS)
+  if (map_ != NULL) {
+    munmap(map_, map_size_);
+    map_ = NULL;
+    header_ = NULL;
+    ring_ = NULL;
+  }
+  if (fd_ != -1) {
+    close(fd_);
+    fd_ = -1;
+  }
+#endif
+}
+
+// Fills the file "fd" with "size" zero bytes, so that all its blocks are
+// allocated up front: a store to a hole of the mapping that the disk has
+// no room for would raise SIGBUS.
+static bool ZeroFill(int fd, uint64 size) {
+  static const char zeros[64 << 10] = { 0 };
+  while (size > 0) {
+    const size_t n = static_cast<size_t>(min<uint64>(size, sizeof(zeros)));
+    const ssize_t written = write(fd, zeros, n);
+    if (written <= 0) {
+      if (written < 0 && errno == EINTR) continue;
+      return false;
+    }
+    size -= written;
+  }
+  return true;
+}
+
+bool RingLogFile::Open() {
+  opened_ = true;
+#if defined(OS_WINDOWS) || !defined(HAVE_FCNTL)
+  return false;
+#else
+  WatchForks();
+  data_size_ =
+      static_cast<uint64>(FLAGS_log_ring_kb > 64 ? FLAGS_log_ring_kb : 64)
+      << 10;
+  const uint64 file_size = kRingLogHeaderSize + data_size_;
+
+  string hostname;
+  GetHostName(&hostname);
+  string uidname = MyUserName();
+  if (uidname.empty()) uidname = "invalid-user";
+  // A fixed name, so that a program that restarts uses the same ring:
+  // webserver.examplehost.root.log.RING
+  const string basename =
+      string(glog_internal_namespace_::ProgramInvocationShortName()) + '.' +
+      hostname + '.' + uidname + ".log.RING";
+
+  const vector<string>& log_dirs = GetLoggingDirectories();
+  for (vector<string>::const_iterator dir = log_dirs.begin();
+       dir != log_dirs.end();
+       ++dir) {
+    const string filename = *dir + "/" + basename;
+    int fd = open(filename.c_str(), O_RDWR | O_CREAT, FLAGS_logfile_mode);
+    if (fd == -1) continue;
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+    // Another process, most likely another instance of this program, may
+    // be using the ring.  It keeps it; this one logs to the usual files.
+    struct flock lock;
+    memset(&lock, 0, sizeof(lock));
+    lock.l_type = F_WRLCK;
+    lock.l_whence = SEEK_SET;
+    if (fcntl(fd, F_SETLK, &lock) == -1) {
+      close(fd);
+      return false;
+    }
+
+    // A ring of another size starts over.
+    struct stat statbuf;
+    const bool resized = (fstat(fd, &statbuf) != 0 ||
+                          static_cast<uint64>(statbuf.st_size) != file_size);
+    if (resized && (ftruncate(fd, 0) != 0 || !ZeroFill(fd, file_size))) {
+      close(fd);
+      continue;
+    }
+    void* map = mmap(NULL, file_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                     fd, 0);
+    if (map == MAP_FAILED) {
+      close(fd);
+      continue;
+    }
+    fd_ = fd;
+    map_ = static_cast<char*>(map);
+    map_size_ = file_size;
+    header_ = reinterpret_cast<RingLogHeader*>(map_);
+    ring_ = map_ + kRingLogHeaderSize;
+    fork_generation_ = ForkGeneration();
+
+    if (!resized && memcmp(header_->magic, kRingLogMagic,
+                           kRingLogMagicLen) == 0 &&
+        header_->data_size == data_size_) {
+      FindRingLogRecords(*header_, ring_,
+                         &first_offset_, &first_sequence_,
+                         &next_offset_, &next_sequence_);
+    } else {
+      if (!resized) {
+        memset(map_, 0, map_size_);
+      }
+      memcpy(header_->magic, kRingLogMagic, kRingLogMagicLen);
+      header_->data_size = data_size_;
+    }
+    UpdateHeader();
+    return true;
+  }
+  perror("Could not create ring logging file");
+  fprintf(stderr, "COULD NOT CREATE A RING LOGGINGFILE %s!\n",
+          basename.c_str());
+  return false;
+#endif
+}
+
+void RingLogFile::UpdateHeader() {
+  header_->first_offset = first_offset_;
+  header_->first_sequence = first_sequence_;
+  header_->next_offset = next_offset_;
+  header_->next_sequence = next_sequence_;
+  header_->checksum = RingLogHeaderChecksum(*header_);
+}
+
+void RingLogFile::DropRecords(uint64 begin, uint64 end) {
+  while (first_sequence_ < next_sequence_ &&
+         first_offset_ >= begin && first_offset_ < end) {
+    // These are records this object wrote or FindRingLogRecords() checked,
+    // so their checksums need not be checked again.
+    const RingLogRecord* record =
+        reinterpret_cast<const RingLogRecord*>(ring_ + first_offset_);
+    if (record->severity != kRingLogWrap) {
+      if (record->length > data_size_ - first_offset_ - sizeof(*record)) {
+        // Damaged after all; forget all the records.
+        first_sequence_ = next_sequence_;
+        first_offset_ = next_offset_;
+        return;
+      }
+      ++first_sequence_;
+    }
+    first_offset_ = RingLogNextOffset(*record, first_offset_, data_size_);
+  }
+}
+
+void RingLogFile::PutRecord(uint32 severity, const char* text,
+                            uint32 length) {
+  RingLogRecord* record = reinterpret_cast<RingLogRecord*>(ring_ + next_offset_);
+  record->sequence = (severity == kRingLogWrap) ? 0 : next_sequence_;
+  record->length = length;
+  record->severity = severity;
+  record->reserved = 0;
+  if (length > 0) {
+    memcpy(record + 1, text, length);
+  }
+  record->checksum = RingLogRecordChecksum(*record, text);
+  next_offset_ = RingLogNextOffset(*record, next_offset_, data_size_);
+  if (severity != kRingLogWrap) {
+    ++next_sequence_;
+  }
+}
+
+bool RingLogFile::Write(LogSeverity severity,
+                        const char* message,
+                        size_t len) {
+  if (!opened_) {
+    Open();
+  }
+  if (map_ == NULL) {
+    return false;
+  }
+  if (fork_generation_ != ForkGeneration()) {
+    // The child of a fork shares the mapping with its parent, which goes
+    // on using the ring.
+    Close();
+    return false;
+  }
+
+  // Keep one message from pushing out more than half of the others.
+  const uint64 max_length = data_size_ / 2 - sizeof(RingLogRecord);
+  const uint32 length = static_cast<uint32>(min<uint64>(len, max_length));
+  const uint64 size = RingLogRecordSize(length);
+  if (data_size_ - next_offset_ < size) {
+    DropRecords(next_offset_, data_size_);
+    PutRecord(kRingLogWrap, NULL, 0);
+  }
+  DropRecords(next_offset_, next_offset_ + size);
+  if (first_sequence_ == next_sequence_) {
+    first_offset_ = next_offset_;
+  }
+  PutRecord(severity, message, length);
+  UpdateHeader();
+  return true;
+}
+
 }  // namespace
 
 
@@ -1142,6 +1813,195 @@ static bool fatal_msg_exclusive = true;
 static LogMessage::LogMessageData fatal_msg_data_exclusive;
 static LogMessage::LogMessageData fatal_msg_data_shared;
 
+// LogMessageData embeds the 30KB message buffer, so allocating one for
+// every message costs a large malloc/free and touches fresh pages.  Each
+// thread instead keeps one buffer, allocated on first use and freed at
+// thread exit, and constructs its LogMessageData in place.  A message
+// logged while another is being built on the same thread (from an
+// operator<<, say), or during thread teardown, falls back to the heap.
+#if !defined(GLOG_NO_THREAD_LOCAL_STORAGE) && __cplusplus >= 201103L
+# define GLOG_THREAD_LOCAL_STORAGE thread_local
+#endif
+
+#ifdef GLOG_THREAD_LOCAL_STORAGE
+namespace {
+
+struct ThreadMessageStorage {
+  ~ThreadMessageStorage() {
+    free(buffer);
+    buffer = NULL;
+    exited = true;
+  }
+
+  void* buffer;
+  bool in_use;
+  bool exited;
+};
+
+// Zero-initialized: no buffer, not in use.
+static GLOG_THREAD_LOCAL_STORAGE ThreadMessageStorage thread_msg_storage;
+
+}  // namespace
+#endif
+
+namespace {
+
+#ifdef GLOG_THREAD_LOCAL_STORAGE
+// The broken-down local time of the last second this thread logged in, so
+// that localtime_r() runs at most once per second per thread.
+struct ThreadTimeCache {
+  time_t seconds;
+  struct ::tm tm_time;
+  bool valid;
+};
+
+static GLOG_THREAD_LOCAL_STORAGE ThreadTimeCache thread_time_cache;
+
+// This thread's GetTID(), which is a system call.  The thread that calls
+// fork() gets a new id in the child; ForkGeneration() tells.
+struct ThreadIdCache {
+  pid_t tid;
+  int fork_generation;
+  bool valid;
+};
+
+static GLOG_THREAD_LOCAL_STORAGE ThreadIdCache thread_id_cache;
+#endif
+
+void LocalTime(time_t seconds, struct ::tm* tm_time) {
+#ifdef GLOG_THREAD_LOCAL_STORAGE
+  ThreadTimeCache& cache = thread_time_cache;
+  if (!cache.valid || cache.seconds != seconds) {
+    localtime_r(&seconds, &cache.tm_time);
+    cache.seconds = seconds;
+    cache.valid = true;
+  }
+  *tm_time = cache.tm_time;
+#else
+  localtime_r(&seconds, tm_time);
+#endif
+}
+
+// GetTID(), remembered per thread.  Only valid once the binary log, which
+// counts forks, exists.
+pid_t CachedTID() {
+#ifdef GLOG_THREAD_LOCAL_STORAGE
+  ThreadIdCache& cache = thread_id_cache;
+  const int generation = ForkGeneration();
+  if (!cache.valid || cache.fork_generation != generation) {
+    cache.tid = GetTID();
+    cache.fork_generation = generation;
+    cache.valid = true;
+  }
+  return cache.tid;
+#else
+  return GetTID();
+#endif
+}
+
+// The time of a new log message, as seconds and microseconds.
+void LogMessageTime(time_t* seconds, int* usecs) {
+#ifdef CLOCK_REALTIME_COARSE
+  if (FLAGS_log_coarse_clock) {
+    struct timespec ts;
+    if (clock_gettime(CLOCK_REALTIME_COARSE, &ts) == 0) {
+      *seconds = ts.tv_sec;
+      *usecs = static_cast<int>(ts.tv_nsec / 1000);
+      return;
+    }
+  }
+#endif
+  WallTime now = WallTime_Now();
+  *seconds = static_cast<time_t>(now);
+  *usecs = static_cast<int>((now - *seconds) * 1000000);
+}
+
+const char kDigitPairs[] =
+    "0001020304050607080910111213141516171819"
+    "2021222324252627282930313233343536373839"
+    "4041424344454647484950515253545556575859"
+    "6061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+// Writes the two digits of 0 <= value < 100.
+inline char* WriteTwoDigits(char* p, int value) {
+  memcpy(p, kDigitPairs + 2 * value, 2);
+  return p + 2;
+}
+
+// Writes value right-aligned in a field of at least "width" characters
+// padded with "fill", like "ostream << setfill(fill) << setw(width)".
+char* WriteUnsigned(char* p, unsigned long value, int width, char fill) {
+  char digits[24];
+  char* const end = digits + sizeof(digits);
+  char* q = end;
+  while (value >= 100) {
+    q -= 2;
+    memcpy(q, kDigitPairs + 2 * (value % 100), 2);
+    value /= 100;
+  }
+  if (value >= 10) {
+    q -= 2;
+    memcpy(q, kDigitPairs + 2 * value, 2);
+  } else {
+    *--q = static_cast<char>('0' + value);
+  }
+  for (int n = static_cast<int>(end - q); n < width; ++n) {
+    *p++ = fill;
+  }
+  memcpy(p, q, end - q);
+  return p + (end - q);
+}
+
+}  // namespace
+
+namespace glog_internal_namespace_ {
+
+char* WriteLogPrefixHead(char* p, LogSeverity severity,
+                         const struct ::tm& tm_time, int usecs, pid_t tid) {
+  *p++ = LogSeverityNames[severity][0];
+  p = WriteUnsigned(p, 1 + tm_time.tm_mon, 2, '0');
+  p = WriteUnsigned(p, tm_time.tm_mday, 2, '0');
+  *p++ = ' ';
+  p = WriteUnsigned(p, tm_time.tm_hour, 2, '0');
+  *p++ = ':';
+  p = WriteUnsigned(p, tm_time.tm_min, 2, '0');
+  *p++ = ':';
+  p = WriteUnsigned(p, tm_time.tm_sec, 2, '0');
+  *p++ = '.';
+  p = WriteTwoDigits(p, usecs / 10000);
+  p = WriteTwoDigits(p, usecs / 100 % 100);
+  p = WriteTwoDigits(p, usecs % 100);
+  *p++ = ' ';
+  p = WriteUnsigned(p, static_cast<unsigned int>(tid), 5, ' ');
+  *p++ = ' ';
+  return p;
+}
+
+char* WriteLogPrefixLine(char* p, int line) {
+  *p++ = ':';
+  if (line < 0) {
+    *p++ = '-';
+  }
+  p = WriteUnsigned(p, line < 0 ? -static_cast<unsigned long>(line) : line,
+                    0, '0');
+  *p++ = ']';
+  *p++ = ' ';
+  return p;
+}
+
+void AppendLogPrefix(string* out, LogSeverity severity,
+                     const struct ::tm& tm_time, int usecs, pid_t tid,
+                     const char* basename, int line) {
+  char prefix[kMaxLogPrefixHeadLen];
+  out->append(prefix, WriteLogPrefixHead(prefix, severity, tm_time, usecs,
+                                         tid) - prefix);
+  out->append(basename);
+  out->append(prefix, WriteLogPrefixLine(prefix, line) - prefix);
+}
+
+}  // namespace glog_internal_namespace_
+
 LogMessage::LogMessageData::LogMessageData()
   : stream_(message_text_, LogMessage::kMaxLogMessageLen, 0) {
 }
@@ -1198,8 +2058,23 @@ void LogMessage::Init(const char* file,
                       void (LogMessage::*send_method)()) {
   allocated_ = NULL;
   if (severity != GLOG_FATAL || !exit_on_dfatal) {
-    allocated_ = new LogMessageData();
-    data_ = allocated_;
+    data_ = NULL;
+#ifdef GLOG_THREAD_LOCAL_STORAGE
+    ThreadMessageStorage& storage = thread_msg_storage;
+    if (!storage.in_use && !storage.exited) {
+      if (storage.buffer == NULL) {
+        storage.buffer = malloc(sizeof(LogMessageData));
+      }
+      if (storage.buffer != NULL) {
+        storage.in_use = true;
+        data_ = new (storage.buffer) LogMessageData();
+      }
+    }
+#endif
+    if (data_ == NULL) {
+      allocated_ = new LogMessageData();
+      data_ = allocated_;
+    }
     data_->first_fatal_ = false;
   } else {
     MutexLock l(&fatal_msg_lock);
@@ -1220,10 +2095,9 @@ void LogMessage::Init(const char* file,
   data_->send_method_ = send_method;
   data_->sink_ = NULL;
   data_->outvec_ = NULL;
-  WallTime now = WallTime_Now();
-  data_->timestamp_ = static_cast<time_t>(now);
-  localtime_r(&data_->timestamp_, &data_->tm_time_);
-  int usecs = static_cast<int>((now - data_->timestamp_) * 1000000);
+  int usecs;
+  LogMessageTime(&data_->timestamp_, &usecs);
+  LocalTime(data_->timestamp_, &data_->tm_time_);
   RawLog__SetLastTime(data_->tm_time_, usecs);
 
   data_->num_chars_to_log_ = 0;
@@ -1236,20 +2110,19 @@ void LogMessage::Init(const char* file,
   //    I1018 160715 f5d4fbb0 logging.cc:1153]
   //    (log level, GMT month, date, time, thread_id, file basename, line)
   // We exclude the thread_id for the default thread.
+  //
+  // The prefix is formatted by hand into a local buffer and written to the
+  // stream in a few pieces; it is byte for byte what
+  //    << severity << setw(2) << month << setw(2) << day << ' ' << ...
+  // with fill '0' (and ' ' for the thread id) used to produce.
   if (FLAGS_log_prefix && (line != kNoLogPrefix)) {
-    stream() << LogSeverityNames[severity][0]
-             << setw(2) << 1+data_->tm_time_.tm_mon
-             << setw(2) << data_->tm_time_.tm_mday
-             << ' '
-             << setw(2) << data_->tm_time_.tm_hour  << ':'
-             << setw(2) << data_->tm_time_.tm_min   << ':'
-             << setw(2) << data_->tm_time_.tm_sec   << "."
-             << setw(6) << usecs
-             << ' '
-             << setfill(' ') << setw(5)
-             << static_cast<unsigned int>(GetTID()) << setfill('0')
-             << ' '
-             << data_->basename_ << ':' << data_->line_ << "] ";
+    char prefix[kMaxLogPrefixHeadLen];
+    char* p = WriteLogPrefixHead(prefix, severity, data_->tm_time_, usecs,
+                                 GetTID());
+    stream().write(prefix, p - prefix);
+    stream().write(data_->basename_, strlen(data_->basename_));
+    p = WriteLogPrefixLine(prefix, line);
+    stream().write(prefix, p - prefix);
   }
   data_->num_prefix_chars_ = data_->stream_.pcount();
 
@@ -1268,6 +2141,13 @@ void LogMessage::Init(const char* file,
 
 LogMessage::~LogMessage() {
   Flush();
+#ifdef GLOG_THREAD_LOCAL_STORAGE
+  if (allocated_ == NULL && data_ == thread_msg_storage.buffer) {
+    data_->~LogMessageData();
+    thread_msg_storage.in_use = false;
+    return;
+  }
+#endif
   delete allocated_;
 }
 
@@ -1333,6 +2213,87 @@ void LogMessage::Flush() {
   data_->has_been_flushed_ = true;
 }
 
+void LogDestination::LogBinary(BinaryLogSite* site,
+                               const BinaryLogArg* args, size_t nargs) {
+  const LogSeverity severity = site->severity;
+  if (severity < FLAGS_minloglevel) {
+    return;
+  }
+
+  // Text path: format the message now and log it like LOG(severity).
+  // FATAL messages always take it, after flushing the binary log, so that
+  // they get the usual crash handling.
+  if (!FLAGS_log_binary || FLAGS_logtostderr || severity == GLOG_FATAL ||
+      !IsGoogleLoggingInitialized()) {
+    if (severity == GLOG_FATAL) {
+      MutexLock l(&log_mutex);
+      if (binary_log_file_ != NULL) {
+        binary_log_file_->Flush();
+      }
+    }
+    string message;
+    FormatBinaryLogMessage(site->format, args, nargs, &message);
+    LogMessage(site->file, site->line, severity).stream() << message;
+    return;
+  }
+
+  const int preserved_errno = errno;
+  time_t timestamp;
+  int usecs;
+  LogMessageTime(&timestamp, &usecs);
+  struct ::tm tm_time;
+  LocalTime(timestamp, &tm_time);
+  RawLog__SetLastTime(tm_time, usecs);
+
+  bool to_sinks;
+  {
+    ReaderMutexLock l(&sink_mutex_);
+    to_sinks = sinks_ != NULL && !sinks_->empty();
+  }
+  {
+    MutexLock l(&log_mutex);
+    if (binary_log_file_ == NULL) {
+      binary_log_file_ = new BinaryLogFile;
+    }
+    const pid_t tid = CachedTID();
+    binary_log_file_->Write(severity > FLAGS_logbuflevel, site,
+                            timestamp, usecs, tm_time.tm_gmtoff, tid,
+                            args, nargs);
+    ++LogMessage::num_messages_[static_cast<int>(severity)];
+
+    // Destinations that need text get the line LogMessage would have
+    // produced, formatted only now that it is known to be needed.
+    const bool to_stderr =
+        severity >= FLAGS_stderrthreshold || FLAGS_alsologtostderr;
+    const bool to_email = severity >= email_logging_severity_ ||
+                          severity >= FLAGS_logemaillevel;
+    if (to_stderr || to_email || to_sinks) {
+      const char* basename = const_basename(site->file);
+      string text;
+      if (FLAGS_log_prefix) {
+        AppendLogPrefix(&text, severity, tm_time, usecs, tid, basename,
+                        site->line);
+      }
+      const size_t prefix_len = text.size();
+      FormatBinaryLogMessage(site->format, args, nargs, &text);
+      if (text.size() == prefix_len || text[text.size() - 1] != '\n') {
+        text += '\n';
+      }
+      MaybeLogToStderr(severity, text.data(), text.size());
+      MaybeLogToEmail(severity, text.data(), text.size());
+      LogToSinks(severity, site->file, basename, site->line, &tm_time,
+                 text.data() + prefix_len, text.size() - prefix_len - 1);
+    }
+  }
+  if (to_sinks) {
+    WaitForSinks(NULL);
+  }
+
+  if (preserved_errno != 0) {
+    errno = preserved_errno;
+  }
+}
+
 // Copy of first FATAL log message so that we can print it out again
 // after all the stack traces.  To preserve legacy behavior, we don't
 // use fatal_msg_data_exclusive.
@@ -1586,6 +2547,89 @@ ostream& operator<<(ostream &os, const PRIVATE_Counter&) {
   return os;
 }
 
+int64 LogRateLimitNowUsec() {
+#ifdef CLOCK_MONOTONIC
+  struct timespec ts;
+  if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0) {
+    return static_cast<int64>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+  }
+#endif
+  return CycleClock_Now();
+}
+
+// Adds "n" to *value and returns the previous value.
+static int32 AddSuppressed(int32* value, int32 n) {
+  int32 old_value = *value;
+  for (;;) {
+    const int32 seen = sync_val_compare_and_swap(value, old_value,
+                                                 old_value + n);
+    if (seen == old_value) return old_value;
+    old_value = seen;
+  }
+}
+
+// Sets *value to 0 and returns what it was.
+static int32 TakeSuppressed(int32* value) {
+  int32 old_value = *value;
+  while (old_value != 0) {
+    const int32 seen = sync_val_compare_and_swap(value, old_value, 0);
+    if (seen == old_value) break;
+    old_value = seen;
+  }
+  return old_value;
+}
+
+void LogRateLimitMerge__(LogRateLimitSite* site, int32* suppressed_here) {
+  if (suppressed_here == NULL) {
+    AddSuppressed(&site->suppressed, 1);
+  } else if (*suppressed_here > 0) {
+    AddSuppressed(&site->suppressed, *suppressed_here);
+    *suppressed_here = 0;
+  }
+}
+
+// The bucket is kept as next_usec, the earliest time at which a token is
+// left (a "generic cell rate" check): taking one moves the time at which
+// the bucket would be empty, next_usec + (burst - 1) * interval_usec, one
+// interval later, and never starts it earlier than now.
+bool LogRateLimitAcquire__(LogRateLimitSite* site, int64 now_usec,
+                           int64 interval_usec, int32 burst,
+                           int32* suppressed_here) {
+  if (interval_usec < 0) interval_usec = 0;
+  if (burst < 1) burst = 1;
+  const int64 slack_usec = (burst - 1) * interval_usec;
+  int64 next_usec = site->next_usec;
+  for (;;) {
+    if (now_usec < next_usec) {
+      // Another thread took the last token.
+      if (suppressed_here != NULL) ++*suppressed_here;
+      LogRateLimitMerge__(site, suppressed_here);
+      return false;
+    }
+    const int64 empty_usec = std::max(next_usec + slack_usec, now_usec);
+    const int64 new_next_usec = empty_usec + interval_usec - slack_usec;
+    const int64 seen = sync_val_compare_and_swap(&site->next_usec, next_usec,
+                                                 new_next_usec);
+    if (seen == next_usec) break;
+    next_usec = seen;
+  }
+
+  // Threads that suppressed messages since the site last logged have been
+  // merging their counts while it could not; what they merge later is
+  // reported the next time.
+  int32 suppressed = 0;
+  if (suppressed_here != NULL) {
+    suppressed = *suppressed_here;
+    *suppressed_here = 0;
+  }
+  suppressed += TakeSuppressed(&site->suppressed);
+  if (suppressed > 0) {
+    LogMessage(site->file, site->line, site->severity).stream()
+        << "Suppressed " << suppressed << " messages from this site";
+  }
+  return true;
+}
+
 ErrnoLogMessage::ErrnoLogMessage(const char* file, int line,
                                  LogSeverity severity, int ctr,
                                  void (LogMessage::*send_method)())
@@ -1607,6 +2651,11 @@ void FlushLogFilesUnsafe(LogSeverity min_severity) {
   LogDestination::FlushLogFilesUnsafe(min_severity);
 }
 
+void LogBinaryMessage(BinaryLogSite* site,
+                      const BinaryLogArg* args, size_t nargs) {
+  LogDestination::LogBinary(site, args, nargs);
+}
+
 void SetLogDestination(LogSeverity severity, const char* base_filename) {
   LogDestination::SetLogDestination(severity, base_filename);
 }
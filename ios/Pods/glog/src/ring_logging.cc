@@ -0,0 +1,319 @@
+// Copyright (c) 2008, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Ring logging: see the comment in glog/ring_logging.h.
+//
+// A ring log file is a RingLogHeader, padded to kRingLogHeaderSize bytes,
+// followed by the ring: header.data_size bytes of records, each a
+// RingLogRecord and "length" bytes of text, starting at a multiple of
+// kRingLogAlignment.  Records have consecutive sequence numbers.  A record
+// that does not fit in what is left of the ring goes to its start; the
+// space it leaves behind begins with a wrap marker, a RingLogRecord with
+// severity kRingLogWrap and no text, unless it is too small to hold one.
+//
+// The writer (RingLogFile in logging.cc) overwrites the oldest records as
+// it goes, so the part of the ring between the newest record and the
+// oldest one holds the remains of overwritten records.  After each record
+// it updates the positions in the header.  Both carry checksums, so that a
+// reader can tell what is valid when the writer died at any point, or is
+// still running.
+
+#include "utilities.h"
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "glog/logging.h"
+#include "glog/ring_logging.h"
+
+using std::sort;
+using std::string;
+using std::vector;
+
+_START_GOOGLE_NAMESPACE_
+
+namespace {
+
+// Mixes data[0, n) into the checksum state "h", 8 bytes at a time; Finish()
+// turns the state into the checksum.  Cheap enough for every message, and
+// good enough to tell records from the remains of overwritten ones.
+uint64 Checksum(const char* data, size_t n, uint64 h) {
+  const uint64 kMul = 0x9e3779b97f4a7c15ULL;
+  uint64 word;
+  for (; n >= 8; data += 8, n -= 8) {
+    memcpy(&word, data, 8);
+    h = (h ^ word) * kMul;
+    h ^= h >> 32;
+  }
+  if (n > 0) {
+    word = 0;
+    memcpy(&word, data, n);
+    h = (h ^ word ^ (static_cast<uint64>(n) << 56)) * kMul;
+    h ^= h >> 32;
+  }
+  return h;
+}
+
+uint32 Finish(uint64 h) {
+  h = (h ^ (h >> 29)) * 0xbf58476d1ce4e5b9ULL;
+  return static_cast<uint32>(h ^ (h >> 32));
+}
+
+// The record at *offset, or the first one of the ring if there is a wrap
+// marker at *offset, in which case *offset becomes 0.
+const RingLogRecord* RecordFrom(const char* ring, uint64 data_size,
+                                uint64* offset) {
+  const RingLogRecord* record = RingLogRecordAt(ring, data_size, *offset);
+  if (record != NULL && record->severity == kRingLogWrap) {
+    *offset = 0;
+    record = RingLogRecordAt(ring, data_size, 0);
+  }
+  if (record != NULL && record->severity == kRingLogWrap) {
+    return NULL;
+  }
+  return record;
+}
+
+// Follows the records from "offset" as long as their sequence numbers
+// continue from "sequence", and returns where the chain ends.
+void FollowRecords(const char* ring, uint64 data_size,
+                   uint64* offset, uint64* sequence) {
+  for (;;) {
+    uint64 at = *offset;
+    const RingLogRecord* record = RecordFrom(ring, data_size, &at);
+    if (record == NULL || record->sequence != *sequence) {
+      return;
+    }
+    *offset = RingLogNextOffset(*record, at, data_size);
+    ++*sequence;
+  }
+}
+
+// A record found by ScanRecords.
+struct FoundRecord {
+  uint64 sequence;
+  uint64 offset;
+  uint64 next_offset;
+
+  bool operator<(const FoundRecord& other) const {
+    return sequence < other.sequence;
+  }
+};
+
+// FindRingLogRecords() for a ring whose header can't be trusted: looks at
+// every place a record could start, and takes the longest run of
+// consecutive sequence numbers that ends with the newest record.
+void ScanRecords(const char* ring, uint64 data_size,
+                 uint64* first_offset, uint64* first_sequence,
+                 uint64* next_offset, uint64* next_sequence) {
+  vector<FoundRecord> found;
+  for (uint64 offset = 0; data_size - offset >= sizeof(RingLogRecord); ) {
+    const RingLogRecord* record = RingLogRecordAt(ring, data_size, offset);
+    if (record == NULL || record->severity == kRingLogWrap) {
+      offset += kRingLogAlignment;
+      continue;
+    }
+    FoundRecord f;
+    f.sequence = record->sequence;
+    f.offset = offset;
+    f.next_offset = RingLogNextOffset(*record, offset, data_size);
+    found.push_back(f);
+    offset += RingLogRecordSize(record->length);
+  }
+  if (found.empty()) {
+    *first_offset = *next_offset = 0;
+    *first_sequence = *next_sequence = 1;
+    return;
+  }
+  sort(found.begin(), found.end());
+  size_t first = found.size() - 1;
+  while (first > 0 && found[first - 1].sequence + 1 == found[first].sequence) {
+    --first;
+  }
+  *first_offset = found[first].offset;
+  *first_sequence = found[first].sequence;
+  *next_offset = found.back().next_offset;
+  *next_sequence = found.back().sequence + 1;
+}
+
+}  // namespace
+
+namespace glog_internal_namespace_ {
+
+uint32 RingLogHeaderChecksum(const RingLogHeader& header) {
+  return Finish(Checksum(reinterpret_cast<const char*>(&header),
+                         offsetof(RingLogHeader, checksum), 0));
+}
+
+uint32 RingLogRecordChecksum(const RingLogRecord& record, const char* text) {
+  return Finish(Checksum(text, record.length,
+                         Checksum(reinterpret_cast<const char*>(&record),
+                                  offsetof(RingLogRecord, checksum), 0)));
+}
+
+const RingLogRecord* RingLogRecordAt(const char* ring, uint64 data_size,
+                                     uint64 offset) {
+  if (offset % kRingLogAlignment != 0 || offset > data_size ||
+      data_size - offset < sizeof(RingLogRecord)) {
+    return NULL;
+  }
+  const RingLogRecord* record =
+      reinterpret_cast<const RingLogRecord*>(ring + offset);
+  if (record->severity == kRingLogWrap) {
+    if (record->length != 0) {
+      return NULL;
+    }
+  } else if (record->severity >= static_cast<uint32>(NUM_SEVERITIES) ||
+             record->length > data_size - offset - sizeof(RingLogRecord)) {
+    return NULL;
+  }
+  const char* text = reinterpret_cast<const char*>(record + 1);
+  if (record->checksum != RingLogRecordChecksum(*record, text)) {
+    return NULL;
+  }
+  return record;
+}
+
+uint64 RingLogNextOffset(const RingLogRecord& record, uint64 offset,
+                         uint64 data_size) {
+  if (record.severity == kRingLogWrap) {
+    return 0;
+  }
+  const uint64 next = offset + RingLogRecordSize(record.length);
+  if (next > data_size || data_size - next < sizeof(RingLogRecord)) {
+    return 0;
+  }
+  return next;
+}
+
+void FindRingLogRecords(const RingLogHeader& header, const char* ring,
+                        uint64* first_offset, uint64* first_sequence,
+                        uint64* next_offset, uint64* next_sequence) {
+  const uint64 data_size = header.data_size;
+  if (header.checksum == RingLogHeaderChecksum(header) &&
+      header.first_sequence > 0 &&
+      header.first_sequence <= header.next_sequence) {
+    // The oldest record must still be there, and where the header says.
+    uint64 offset = header.first_offset;
+    uint64 sequence = header.first_sequence;
+    const RingLogRecord* first = RecordFrom(ring, data_size, &offset);
+    const bool empty = (header.first_sequence == header.next_sequence);
+    if (empty || (first != NULL && first->sequence == sequence)) {
+      *first_offset = empty ? header.next_offset : offset;
+      *first_sequence = header.first_sequence;
+      *next_offset = header.next_offset;
+      *next_sequence = header.next_sequence;
+      // Take the records written after the header was last updated.
+      FollowRecords(ring, data_size, next_offset, next_sequence);
+      return;
+    }
+  }
+  ScanRecords(ring, data_size,
+              first_offset, first_sequence, next_offset, next_sequence);
+}
+
+}  // namespace glog_internal_namespace_
+
+RingLogReader::RingLogReader()
+  : data_size_(0),
+    offset_(0),
+    sequence_(1),
+    first_sequence_(1),
+    next_sequence_(1) {
+}
+
+bool RingLogReader::Open(const char* path, string* error) {
+  file_.clear();
+  data_size_ = offset_ = 0;
+  sequence_ = first_sequence_ = next_sequence_ = 1;
+
+  FILE* file = fopen(path, "rb");
+  if (file == NULL) {
+    *error = string(path) + ": " + strerror(errno);
+    return false;
+  }
+  char buffer[1 << 16];
+  size_t n;
+  while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+    file_.insert(file_.end(), buffer, buffer + n);
+  }
+  const bool read_error = ferror(file);
+  fclose(file);
+  if (read_error) {
+    *error = string(path) + ": read error";
+    return false;
+  }
+
+  RingLogHeader header;
+  if (file_.size() < kRingLogHeaderSize ||
+      memcmp(&file_[0], kRingLogMagic, kRingLogMagicLen) != 0) {
+    *error = string(path) + ": not a ring log file";
+    return false;
+  }
+  memcpy(&header, &file_[0], sizeof(header));
+  if (header.data_size != file_.size() - kRingLogHeaderSize) {
+    *error = string(path) + ": not a ring log file, or truncated";
+    return false;
+  }
+  data_size_ = header.data_size;
+  uint64 next_offset;
+  FindRingLogRecords(header, &file_[kRingLogHeaderSize],
+                     &offset_, &first_sequence_, &next_offset,
+                     &next_sequence_);
+  sequence_ = first_sequence_;
+  return true;
+}
+
+bool RingLogReader::Next(LogSeverity* severity, uint64* sequence,
+                         string* text) {
+  if (sequence_ >= next_sequence_) {
+    return false;
+  }
+  const char* ring = &file_[kRingLogHeaderSize];
+  uint64 offset = offset_;
+  const RingLogRecord* record = RecordFrom(ring, data_size_, &offset);
+  if (record == NULL || record->sequence != sequence_) {
+    // FindRingLogRecords() followed the same chain.
+    sequence_ = next_sequence_;
+    return false;
+  }
+  *severity = static_cast<LogSeverity>(record->severity);
+  *sequence = record->sequence;
+  text->assign(reinterpret_cast<const char*>(record + 1), record->length);
+  offset_ = RingLogNextOffset(*record, offset, data_size_);
+  ++sequence_;
+  return true;
+}
+
+_END_GOOGLE_NAMESPACE_
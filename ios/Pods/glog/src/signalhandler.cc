@@ -363,6 +363,8 @@ void InstallFailureSignalHandler() {
   for (size_t i = 0; i < ARRAYSIZE(kFailureSignals); ++i) {
     CHECK_ERR(sigaction(kFailureSignals[i].number, &sig_action, NULL));
   }
+  // Have the symbols ready by the time a crash dump needs them.
+  LoadSymbolIndexInBackground();
 #endif  // HAVE_SIGACTION
 }
 
@@ -57,6 +57,8 @@
 #if defined(HAVE_SYMBOLIZE)
 
 #include <limits>
+#include <sched.h>
+#include <string.h>
 
 #include "symbolize.h"
 #include "demangle.h"
@@ -103,6 +105,71 @@ static ATTRIBUTE_NOINLINE void DemangleInplace(char *out, int out_size) {
   }
 }
 
+// A cache of demangled names, so that the frames a stack trace shares with
+// the previous ones are not demangled again.  Entries are keyed by the
+// symbol's start address and evicted least recently used first.  It lives
+// in static storage and is only ever try-locked, so it is safe to use from
+// a signal handler: a caller that finds it busy, because another thread
+// holds it or because the signal interrupted its holder, goes without.
+struct DemangleCacheEntry {
+  uint64 symbol_address;  // 0 for an unused entry
+  uint64 last_use;
+  bool demangled;         // whether Demangle() succeeded
+  char name[256];         // the demangled name, if so
+};
+
+static const int kDemangleCacheSize = 64;
+static DemangleCacheEntry g_demangle_cache[kDemangleCacheSize];
+static uint64 g_demangle_cache_clock = 0;
+static int g_demangle_cache_lock = 0;
+
+// DemangleInplace(), for the symbol that starts at symbol_address.
+static ATTRIBUTE_NOINLINE void DemangleInplaceCached(uint64 symbol_address,
+                                                     char *out,
+                                                     int out_size) {
+  if (sync_val_compare_and_swap(&g_demangle_cache_lock, 0, 1) != 0) {
+    DemangleInplace(out, out_size);
+    return;
+  }
+  DemangleCacheEntry* entry = NULL;
+  DemangleCacheEntry* victim = &g_demangle_cache[0];
+  for (int i = 0; i < kDemangleCacheSize; ++i) {
+    DemangleCacheEntry* e = &g_demangle_cache[i];
+    if (e->symbol_address == symbol_address) {
+      entry = e;
+      break;
+    }
+    if (e->last_use < victim->last_use) {
+      victim = e;
+    }
+  }
+  if (entry == NULL) {
+    entry = victim;
+    entry->symbol_address = symbol_address;
+    entry->demangled = Demangle(out, entry->name, sizeof(entry->name));
+  }
+  entry->last_use = ++g_demangle_cache_clock;
+  if (entry->demangled) {
+    // Copy to out if the space allows, as DemangleInplace() does.
+    size_t len = strlen(entry->name);
+    if (len + 1 <= (size_t)out_size) {
+      memmove(out, entry->name, len + 1);
+    }
+  }
+  sync_val_compare_and_swap(&g_demangle_cache_lock, 1, 0);
+}
+
+// Forgets all cached names, for when code may have been unmapped and other
+// code mapped at the same addresses.  Unlike the lookups this waits for the
+// lock, so it must not be called from a signal handler.
+static void ClearDemangleCache() {
+  while (sync_val_compare_and_swap(&g_demangle_cache_lock, 0, 1) != 0) {
+    sched_yield();
+  }
+  memset(g_demangle_cache, 0, sizeof(g_demangle_cache));
+  sync_val_compare_and_swap(&g_demangle_cache_lock, 1, 0);
+}
+
 _END_GOOGLE_NAMESPACE_
 
 #if defined(__ELF__)
@@ -124,6 +191,8 @@ _END_GOOGLE_NAMESPACE_
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
+#include <algorithm>
+#include <vector>
 
 #include "symbolize.h"
 #include "config.h"
@@ -321,19 +390,13 @@ FindSymbol(uint64_t pc, const int fd, char *out, int out_size,
   return false;
 }
 
-// Get the symbol name of "pc" from the file pointed by "fd".  Process
-// both regular and dynamic symbol tables if necessary.  On success,
-// write the symbol name to "out" and return true.  Otherwise, return
+// Get what to add to the symbol values of the object file pointed by
+// "fd", whose ELF header is "elf_header", to get addresses in memory.  On
+// success, store it in "symbol_offset_out" and return true.  Otherwise, return
 // false.
-static bool GetSymbolFromObjectFile(const int fd, uint64_t pc,
-                                    char *out, int out_size,
-                                    uint64_t map_base_address) {
-  // Read the ELF header.
-  ElfW(Ehdr) elf_header;
-  if (!ReadFromOffsetExact(fd, &elf_header, sizeof(elf_header), 0)) {
-    return false;
-  }
-
+static bool GetSymbolOffset(const int fd, const ElfW(Ehdr)& elf_header,
+                            uint64_t map_base_address,
+                            uint64_t *symbol_offset_out) {
   uint64_t symbol_offset = 0;
   if (elf_header.e_type == ET_DYN) {  // DSO needs offset adjustment.
     ElfW(Phdr) phdr;
@@ -359,6 +422,27 @@ static bool GetSymbolFromObjectFile(const int fd, uint64_t pc,
     if (symbol_offset == 0)
       return false;
   }
+  *symbol_offset_out = symbol_offset;
+  return true;
+}
+
+// Get the symbol name of "pc" from the file pointed by "fd".  Process
+// both regular and dynamic symbol tables if necessary.  On success,
+// write the symbol name to "out" and return true.  Otherwise, return
+// false.
+static bool GetSymbolFromObjectFile(const int fd, uint64_t pc,
+                                    char *out, int out_size,
+                                    uint64_t map_base_address) {
+  // Read the ELF header.
+  ElfW(Ehdr) elf_header;
+  if (!ReadFromOffsetExact(fd, &elf_header, sizeof(elf_header), 0)) {
+    return false;
+  }
+
+  uint64_t symbol_offset;
+  if (!GetSymbolOffset(fd, elf_header, map_base_address, &symbol_offset)) {
+    return false;
+  }
 
   ElfW(Shdr) symtab, strtab;
 
@@ -648,6 +732,290 @@ OpenObjectFileContainingPcAndGetStartAddress(uint64_t pc,
   }
 }
 
+// The symbol index.
+//
+// LoadSymbolIndex() reads /proc/self/maps and the symbol tables of the
+// object files mapped executable once, and keeps the symbols of each
+// mapping sorted by address.  Symbolize() then finds a symbol with two
+// binary searches, without system calls.  The index is published with a
+// single atomic store and never changed or freed afterwards, so reading it
+// is async-signal-safe.  Code mapped after the index was built (dlopen())
+// is symbolized the slow way.  The index is not told about dlclose(): a
+// library later mapped where an unloaded one was would get the unloaded
+// one's names, so ReloadSymbolIndex() has to be called after either.  It
+// replaces the index; the old one is leaked, as a signal handler may still
+// be reading it.
+
+namespace {
+
+struct IndexedSymbol {
+  uint64_t start_address;
+  uint64_t end_address;
+  const char *name;  // mangled
+};
+
+// An executable mapping of an object file.
+struct IndexedMapping {
+  uint64_t start_address;
+  uint64_t end_address;
+  // The symbols within the mapping, sorted by start address.  Symbols can
+  // nest, so the one containing a pc may precede the last one starting
+  // before it, by at most max_symbol_size.
+  const IndexedSymbol *symbols;
+  size_t num_symbols;
+  uint64_t max_symbol_size;
+};
+
+struct SymbolIndex {
+  const IndexedMapping *mappings;  // sorted by start address
+  size_t num_mappings;
+};
+
+// An IndexedSymbol while the index is being built.
+struct SymbolToIndex {
+  uint64_t start_address;
+  uint64_t end_address;
+  size_t name_offset;  // in the names read so far
+};
+
+bool SymbolStartsBefore(const SymbolToIndex &a, const SymbolToIndex &b) {
+  return a.start_address < b.start_address;
+}
+
+bool MappingStartsBefore(const IndexedMapping &a, const IndexedMapping &b) {
+  return a.start_address < b.start_address;
+}
+
+}  // namespace
+
+static SymbolIndex *g_symbol_index = NULL;
+static int g_symbol_index_loading = 0;  // set by the first load or reload
+static int g_symbol_index_building = 0;
+
+// Appends the symbols of symbol table "symtab" in the object file "fd"
+// that lie within [start_address, end_address) to "symbols", with their
+// names in "names".
+static void ReadIndexedSymbols(const int fd, const ElfW(Shdr) &symtab,
+                               const ElfW(Shdr) &strtab,
+                               uint64_t symbol_offset,
+                               uint64_t start_address, uint64_t end_address,
+                               std::vector<SymbolToIndex> *symbols,
+                               std::vector<char> *names) {
+  if (symtab.sh_entsize != sizeof(ElfW(Sym)) || strtab.sh_size == 0) {
+    return;
+  }
+  std::vector<ElfW(Sym)> syms(symtab.sh_size / sizeof(ElfW(Sym)));
+  std::vector<char> strings(strtab.sh_size + 1);
+  if (syms.empty() ||
+      !ReadFromOffsetExact(fd, &syms[0], syms.size() * sizeof(ElfW(Sym)),
+                           symtab.sh_offset) ||
+      !ReadFromOffsetExact(fd, &strings[0], strtab.sh_size,
+                           strtab.sh_offset)) {
+    return;
+  }
+  strings.back() = '\0';
+  for (size_t i = 0; i < syms.size(); ++i) {
+    const ElfW(Sym) &symbol = syms[i];
+    // The same symbols FindSymbol() would consider.
+    if (symbol.st_value == 0 || symbol.st_shndx == 0 ||
+        symbol.st_size == 0 || symbol.st_name >= strtab.sh_size) {
+      continue;
+    }
+    SymbolToIndex indexed;
+    indexed.start_address = symbol.st_value + symbol_offset;
+    indexed.end_address = indexed.start_address + symbol.st_size;
+    if (indexed.end_address <= start_address ||
+        indexed.start_address >= end_address) {
+      continue;
+    }
+    const char *name = &strings[symbol.st_name];
+    indexed.name_offset = names->size();
+    names->insert(names->end(), name, name + strlen(name) + 1);
+    symbols->push_back(indexed);
+  }
+}
+
+// Builds the index entry for the mapping [start_address, end_address) of
+// the object file "fd".  Returns false if it has no symbols.
+static bool IndexMapping(const int fd, uint64_t start_address,
+                         uint64_t end_address, uint64_t base_address,
+                         IndexedMapping *mapping) {
+  ElfW(Ehdr) elf_header;
+  uint64_t symbol_offset;
+  if (!ReadFromOffsetExact(fd, &elf_header, sizeof(elf_header), 0) ||
+      memcmp(elf_header.e_ident, ELFMAG, SELFMAG) != 0 ||
+      !GetSymbolOffset(fd, elf_header, base_address, &symbol_offset)) {
+    return false;
+  }
+
+  // The regular symbol table comes first, as in GetSymbolFromObjectFile(),
+  // so that it wins when both have a symbol at the same address.
+  std::vector<SymbolToIndex> symbols;
+  std::vector<char> names;
+  const uint32_t kTypes[] = { SHT_SYMTAB, SHT_DYNSYM };
+  for (size_t i = 0; i < ARRAYSIZE(kTypes); ++i) {
+    ElfW(Shdr) symtab, strtab;
+    if (GetSectionHeaderByType(fd, elf_header.e_shnum, elf_header.e_shoff,
+                               kTypes[i], &symtab) &&
+        ReadFromOffsetExact(fd, &strtab, sizeof(strtab),
+                            elf_header.e_shoff +
+                            symtab.sh_link * sizeof(symtab))) {
+      ReadIndexedSymbols(fd, symtab, strtab, symbol_offset,
+                         start_address, end_address, &symbols, &names);
+    }
+  }
+  if (symbols.empty()) {
+    return false;
+  }
+  std::stable_sort(symbols.begin(), symbols.end(), SymbolStartsBefore);
+
+  // Keep the first of the symbols that start at the same address, and make
+  // the names point into storage of their own.
+  char *name_storage = new char[names.size()];
+  memcpy(name_storage, &names[0], names.size());
+  IndexedSymbol *indexed = new IndexedSymbol[symbols.size()];
+  size_t n = 0;
+  uint64_t max_symbol_size = 0;
+  for (size_t i = 0; i < symbols.size(); ++i) {
+    if (n > 0 && indexed[n - 1].start_address == symbols[i].start_address) {
+      continue;
+    }
+    indexed[n].start_address = symbols[i].start_address;
+    indexed[n].end_address = symbols[i].end_address;
+    indexed[n].name = name_storage + symbols[i].name_offset;
+    max_symbol_size = std::max(max_symbol_size,
+                               indexed[n].end_address -
+                               indexed[n].start_address);
+    ++n;
+  }
+  mapping->start_address = start_address;
+  mapping->end_address = end_address;
+  mapping->symbols = indexed;
+  mapping->num_symbols = n;
+  mapping->max_symbol_size = max_symbol_size;
+  return true;
+}
+
+static SymbolIndex *BuildSymbolIndex() {
+  FILE *maps = fopen("/proc/self/maps", "r");
+  if (maps == NULL) {
+    return NULL;
+  }
+  std::vector<IndexedMapping> mappings;
+  char line[1024];
+  for (int num_maps = 1; fgets(line, sizeof(line), maps) != NULL;
+       ++num_maps) {
+    // See OpenObjectFileContainingPcAndGetStartAddress() for the format.
+    unsigned long long start_address, end_address, file_offset;
+    char flags[8];
+    int file_name_pos = 0;
+    if (sscanf(line, "%llx-%llx %7s %llx %*s %*s %n", &start_address,
+               &end_address, flags, &file_offset, &file_name_pos) < 4 ||
+        file_name_pos == 0 || line[file_name_pos] != '/' ||
+        strlen(flags) < 4 || flags[0] != 'r' || flags[2] != 'x') {
+      continue;
+    }
+    char *file_name = line + file_name_pos;
+    file_name[strcspn(file_name, "\n")] = '\0';
+    const uint64_t base_address =
+        ((num_maps == 1) ? 0U : start_address) - file_offset;
+
+    int fd;
+    NO_INTR(fd = open(file_name, O_RDONLY));
+    FileDescriptor wrapped_fd(fd);
+    IndexedMapping mapping;
+    if (wrapped_fd.get() >= 0 &&
+        IndexMapping(wrapped_fd.get(), start_address, end_address,
+                     base_address, &mapping)) {
+      mappings.push_back(mapping);
+    }
+  }
+  fclose(maps);
+
+  std::sort(mappings.begin(), mappings.end(), MappingStartsBefore);
+  SymbolIndex *index = new SymbolIndex;
+  index->num_mappings = mappings.size();
+  IndexedMapping *indexed = new IndexedMapping[mappings.size() + 1];
+  std::copy(mappings.begin(), mappings.end(), indexed);
+  index->mappings = indexed;
+  return index;
+}
+
+// Looks "pc" up in "index".  Returns -1 if the index doesn't cover it,
+// else whether a symbol was found, and writes its name to "out".
+static int SymbolizeFromIndex(const SymbolIndex *index, uint64_t pc,
+                              char *out, int out_size,
+                              uint64 *symbol_address) {
+  // The last mapping that starts at or before pc.
+  size_t lo = 0, hi = index->num_mappings;
+  while (lo < hi) {
+    const size_t mid = lo + (hi - lo) / 2;
+    if (index->mappings[mid].start_address <= pc) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  if (lo == 0 || pc >= index->mappings[lo - 1].end_address) {
+    return -1;
+  }
+  const IndexedMapping &mapping = index->mappings[lo - 1];
+
+  // The last symbol that starts at or before pc, then back from there.
+  lo = 0;
+  hi = mapping.num_symbols;
+  while (lo < hi) {
+    const size_t mid = lo + (hi - lo) / 2;
+    if (mapping.symbols[mid].start_address <= pc) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  for (size_t i = lo; i > 0; --i) {
+    const IndexedSymbol &symbol = mapping.symbols[i - 1];
+    if (pc - symbol.start_address >= mapping.max_symbol_size) {
+      break;
+    }
+    if (pc < symbol.end_address) {
+      const size_t len = strlen(symbol.name);
+      if (len + 1 > (size_t)out_size) {
+        return 0;
+      }
+      memcpy(out, symbol.name, len + 1);
+      *symbol_address = symbol.start_address;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+// Builds an index and publishes it, in place of any previous one.  Builds
+// are serialized, so that an older index can't replace a newer one.
+static void PublishSymbolIndex() {
+  while (sync_val_compare_and_swap(&g_symbol_index_building, 0, 1) != 0) {
+    sched_yield();
+  }
+  // NULL on failure, which makes Symbolize() take the slow path again
+  // rather than keep using an outdated index.
+  SymbolIndex *index = BuildSymbolIndex();
+  __atomic_store_n(&g_symbol_index, index, __ATOMIC_RELEASE);
+  sync_val_compare_and_swap(&g_symbol_index_building, 1, 0);
+}
+
+void LoadSymbolIndex() {
+  if (sync_val_compare_and_swap(&g_symbol_index_loading, 0, 1) != 0) {
+    return;
+  }
+  PublishSymbolIndex();
+}
+
+void ReloadSymbolIndex() {
+  __atomic_store_n(&g_symbol_index_loading, 1, __ATOMIC_RELAXED);
+  PublishSymbolIndex();
+  ClearDemangleCache();
+}
+
 // POSIX doesn't define any async-signal safe function for converting
 // an integer to ASCII. We'll have to define our own version.
 // itoa_r() converts a (signed) integer to ASCII. It returns "buf", if the
@@ -754,6 +1122,24 @@ static ATTRIBUTE_NOINLINE bool SymbolizeAndDemangle(void *pc, char *out,
   if (out_size < 1) {
     return false;
   }
+
+  // The callbacks need the object file, so they bypass the index.
+  const SymbolIndex *index =
+      __atomic_load_n(&g_symbol_index, __ATOMIC_ACQUIRE);
+  if (index != NULL && g_symbolize_callback == NULL &&
+      g_symbolize_open_object_file_callback == NULL) {
+    uint64 symbol_address;
+    const int found = SymbolizeFromIndex(index, pc0, out, out_size,
+                                         &symbol_address);
+    if (found >= 0) {
+      if (found == 0) {
+        return false;
+      }
+      DemangleInplaceCached(symbol_address, out, out_size);
+      return true;
+    }
+  }
+
   out[0] = '\0';
   SafeAppendString("(", out, out_size);
 
@@ -824,17 +1210,31 @@ _START_GOOGLE_NAMESPACE_
 static ATTRIBUTE_NOINLINE bool SymbolizeAndDemangle(void *pc, char *out,
                                                     int out_size) {
   Dl_info info;
-  if (dladdr(pc, &info)) {
+  if (dladdr(pc, &info) && info.dli_sname != NULL) {
     if ((int)strlen(info.dli_sname) < out_size) {
       strcpy(out, info.dli_sname);
       // Symbolization succeeded.  Now we try to demangle the symbol.
-      DemangleInplace(out, out_size);
+      if (info.dli_saddr != NULL) {
+        DemangleInplaceCached(reinterpret_cast<uintptr_t>(info.dli_saddr),
+                              out, out_size);
+      } else {
+        DemangleInplace(out, out_size);
+      }
       return true;
     }
   }
   return false;
 }
 
+// dladdr() has an index of its own.
+void LoadSymbolIndex() {
+}
+
+// dladdr() keeps up with dlclose() by itself, the demangled names don't.
+void ReloadSymbolIndex() {
+  ClearDemangleCache();
+}
+
 _END_GOOGLE_NAMESPACE_
 
 #else
@@ -848,6 +1248,24 @@ bool Symbolize(void *pc, char *out, int out_size) {
   return SymbolizeAndDemangle(pc, out, out_size);
 }
 
+#ifdef HAVE_PTHREAD
+static void *LoadSymbolIndexThread(void *) {
+  LoadSymbolIndex();
+  return NULL;
+}
+#endif
+
+void LoadSymbolIndexInBackground() {
+#ifdef HAVE_PTHREAD
+  pthread_t thread;
+  if (pthread_create(&thread, NULL, &LoadSymbolIndexThread, NULL) == 0) {
+    pthread_detach(thread);
+    return;
+  }
+#endif
+  LoadSymbolIndex();
+}
+
 _END_GOOGLE_NAMESPACE_
 
 #else  /* HAVE_SYMBOLIZE */
@@ -864,6 +1282,15 @@ bool Symbolize(void *pc, char *out, int out_size) {
   return false;
 }
 
+void LoadSymbolIndex() {
+}
+
+void ReloadSymbolIndex() {
+}
+
+void LoadSymbolIndexInBackground() {
+}
+
 _END_GOOGLE_NAMESPACE_
 
 #endif
@@ -150,6 +150,22 @@ _START_GOOGLE_NAMESPACE_
 // returns false.
 bool Symbolize(void *pc, char *out, int out_size);
 
+// Builds an index of the symbols of the object files mapped so far, which
+// Symbolize() then searches instead of reading /proc/self/maps and the
+// object file for every call; see symbolize.cc.  Only the first call does
+// anything.  Unlike Symbolize(), this allocates memory and is not
+// async-signal-safe: call it at startup, or use
+// LoadSymbolIndexInBackground(), which calls it on a thread of its own.
+void LoadSymbolIndex();
+void LoadSymbolIndexInBackground();
+
+// The index describes the libraries loaded when it was built.  After a
+// dlopen() or dlclose(), call ReloadSymbolIndex() to rebuild it and forget
+// the names cached for the old libraries; otherwise a library mapped where
+// an unloaded one was is symbolized with the unloaded one's names.  Like
+// LoadSymbolIndex(), it is not async-signal-safe.
+void ReloadSymbolIndex();
+
 _END_GOOGLE_NAMESPACE_
 
 #endif  // BASE_SYMBOLIZE_H_
@@ -0,0 +1,111 @@
+// Copyright (c) 2008, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// glog-decode: prints the text lines of binary log files written with
+// --log_binary (see glog/binary_logging.h).
+//
+//   glog-decode [--min_severity=INFO|WARNING|ERROR|FATAL] [--nolog_prefix]
+//               FILE...
+//
+// With --min_severity=WARNING the output holds the messages the WARNING
+// text log would have, and so on; the default prints them all, as in the
+// INFO log.
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+#include "glog/binary_logging.h"
+#include "glog/logging.h"
+
+using std::string;
+
+static void Usage(const char* argv0) {
+  fprintf(stderr,
+          "usage: %s [--min_severity=INFO|WARNING|ERROR|FATAL] "
+          "[--nolog_prefix] FILE...\n", argv0);
+}
+
+int main(int argc, char** argv) {
+  google::LogSeverity min_severity = google::GLOG_INFO;
+  bool log_prefix = true;
+  int first_file = 1;
+  for (; first_file < argc && strncmp(argv[first_file], "--", 2) == 0;
+       ++first_file) {
+    const char* arg = argv[first_file];
+    if (strcmp(arg, "--") == 0) {
+      ++first_file;
+      break;
+    } else if (strncmp(arg, "--min_severity=", 15) == 0) {
+      int s = 0;
+      while (s < google::NUM_SEVERITIES &&
+             strcmp(arg + 15, google::GetLogSeverityName(s)) != 0) {
+        ++s;
+      }
+      if (s == google::NUM_SEVERITIES) {
+        Usage(argv[0]);
+        return 2;
+      }
+      min_severity = s;
+    } else if (strcmp(arg, "--nolog_prefix") == 0) {
+      log_prefix = false;
+    } else {
+      Usage(argv[0]);
+      return 2;
+    }
+  }
+  if (first_file >= argc) {
+    Usage(argv[0]);
+    return 2;
+  }
+
+  int status = 0;
+  google::BinaryLogReader reader;
+  reader.set_log_prefix(log_prefix);
+  for (int i = first_file; i < argc; ++i) {
+    string error;
+    if (!reader.Open(argv[i], &error)) {
+      fprintf(stderr, "%s\n", error.c_str());
+      status = 1;
+      continue;
+    }
+    google::LogSeverity severity;
+    string line;
+    while (reader.Next(&severity, &line, &error)) {
+      if (severity >= min_severity) {
+        fwrite(line.data(), 1, line.size(), stdout);
+      }
+    }
+    if (!error.empty()) {
+      fprintf(stderr, "%s: %s\n", argv[i], error.c_str());
+      status = 1;
+    }
+  }
+  return status;
+}
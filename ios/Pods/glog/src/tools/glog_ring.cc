@@ -0,0 +1,111 @@
+// Copyright (c) 2008, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// glog-ring: prints the messages of ring log files written with
+// --log_ring_kb (see glog/ring_logging.h), oldest first.
+//
+//   glog-ring [--min_severity=INFO|WARNING|ERROR|FATAL] [--sequence] FILE...
+//
+// --sequence puts each message's sequence number in front of it, which
+// lines up the output of successive runs against the ring of a program
+// that is still logging.
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+#include "glog/logging.h"
+#include "glog/ring_logging.h"
+
+using std::string;
+
+static void Usage(const char* argv0) {
+  fprintf(stderr,
+          "usage: %s [--min_severity=INFO|WARNING|ERROR|FATAL] "
+          "[--sequence] FILE...\n", argv0);
+}
+
+int main(int argc, char** argv) {
+  google::LogSeverity min_severity = google::GLOG_INFO;
+  bool print_sequence = false;
+  int first_file = 1;
+  for (; first_file < argc && strncmp(argv[first_file], "--", 2) == 0;
+       ++first_file) {
+    const char* arg = argv[first_file];
+    if (strcmp(arg, "--") == 0) {
+      ++first_file;
+      break;
+    } else if (strncmp(arg, "--min_severity=", 15) == 0) {
+      int s = 0;
+      while (s < google::NUM_SEVERITIES &&
+             strcmp(arg + 15, google::GetLogSeverityName(s)) != 0) {
+        ++s;
+      }
+      if (s == google::NUM_SEVERITIES) {
+        Usage(argv[0]);
+        return 2;
+      }
+      min_severity = s;
+    } else if (strcmp(arg, "--sequence") == 0) {
+      print_sequence = true;
+    } else {
+      Usage(argv[0]);
+      return 2;
+    }
+  }
+  if (first_file >= argc) {
+    Usage(argv[0]);
+    return 2;
+  }
+
+  int status = 0;
+  google::RingLogReader reader;
+  for (int i = first_file; i < argc; ++i) {
+    string error;
+    if (!reader.Open(argv[i], &error)) {
+      fprintf(stderr, "%s\n", error.c_str());
+      status = 1;
+      continue;
+    }
+    google::LogSeverity severity;
+    google::uint64 sequence;
+    string text;
+    while (reader.Next(&severity, &sequence, &text)) {
+      if (severity < min_severity) {
+        continue;
+      }
+      if (print_sequence) {
+        printf("%" PRIu64 " ", static_cast<uint64_t>(sequence));
+      }
+      fwrite(text.data(), 1, text.size(), stdout);
+    }
+  }
+  return status;
+}
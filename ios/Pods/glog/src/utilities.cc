@@ -304,6 +304,12 @@ REGISTER_MODULE_INITIALIZER(utilities, MyUserNameInitializer());
 
 #ifdef HAVE_STACKTRACE
 void DumpStackTraceToString(string* stacktrace) {
+#ifdef HAVE_SYMBOLIZE
+  // Not a signal handler: the index can be built here if need be.
+  if (FLAGS_symbolize_stacktrace) {
+    LoadSymbolIndex();
+  }
+#endif
   DumpStackTrace(1, DebugWriteToString, stacktrace);
 }
 #endif
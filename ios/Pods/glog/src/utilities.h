@@ -169,6 +169,87 @@ const std::string& MyUserName();
 // (Doesn't modify filepath, contrary to basename() in libgen.h.)
 const char* const_basename(const char* filepath);
 
+// The prefix LogMessage puts in front of each line,
+//    I1018 16:07:15.123456  1234 logging.cc:1153]
+// is written in two parts around the file basename.  WriteLogPrefixHead()
+// writes at most kMaxLogPrefixHeadLen chars, up to the basename, and
+// WriteLogPrefixLine() the ":line] " after it; both return the end of what
+// they wrote.  AppendLogPrefix() appends the whole prefix to *out.
+const size_t kMaxLogPrefixHeadLen = 64;
+char* WriteLogPrefixHead(char* p, LogSeverity severity,
+                         const struct ::tm& tm_time, int usecs, pid_t tid);
+char* WriteLogPrefixLine(char* p, int line);
+void AppendLogPrefix(std::string* out, LogSeverity severity,
+                     const struct ::tm& tm_time, int usecs, pid_t tid,
+                     const char* basename, int line);
+
+// Binary log files, see binary_logging.cc, start with kBinaryLogMagic and
+// continue with records that each begin with one of these tags.
+const char kBinaryLogMagic[] = "GLOGBIN1";
+const size_t kBinaryLogMagicLen = sizeof(kBinaryLogMagic) - 1;
+const char kBinaryLogSiteTag = 'S';
+const char kBinaryLogZoneTag = 'Z';
+const char kBinaryLogMessageTag = 'M';
+
+// Ring log files, see ring_logging.cc: a RingLogHeader in the first
+// kRingLogHeaderSize bytes, then the ring of records.  Both are in the
+// byte order of the machine that wrote them.
+const char kRingLogMagic[] = "GLOGRNG1";
+const size_t kRingLogMagicLen = sizeof(kRingLogMagic) - 1;
+const size_t kRingLogHeaderSize = 4096;
+const uint32 kRingLogWrap = 0xffffffff;   // RingLogRecord::severity
+
+struct RingLogHeader {
+  char magic[kRingLogMagicLen];
+  uint64 data_size;           // of the ring, which follows the header
+  // Where the oldest record is, and where the next one goes.
+  uint64 first_offset;
+  uint64 first_sequence;
+  uint64 next_offset;
+  uint64 next_sequence;
+  uint32 checksum;            // of the fields above
+  uint32 reserved;
+};
+
+struct RingLogRecord {
+  uint64 sequence;
+  uint32 length;              // of the text that follows
+  uint32 severity;            // or kRingLogWrap
+  uint32 checksum;            // of the fields above and the text
+  uint32 reserved;
+};
+
+// Records start at multiples of kRingLogAlignment in the ring.
+const size_t kRingLogAlignment = 8;
+
+// The space a record with "length" bytes of text takes in the ring.
+inline uint64 RingLogRecordSize(uint64 length) {
+  return (sizeof(RingLogRecord) + length + kRingLogAlignment - 1) &
+         ~static_cast<uint64>(kRingLogAlignment - 1);
+}
+
+uint32 RingLogHeaderChecksum(const RingLogHeader& header);
+uint32 RingLogRecordChecksum(const RingLogRecord& record, const char* text);
+
+// The record at "offset" in "ring" if it is a valid record or wrap
+// marker, else NULL.
+const RingLogRecord* RingLogRecordAt(const char* ring, uint64 data_size,
+                                     uint64 offset);
+
+// Where the record after "record", which is at "offset", starts: 0 after
+// a wrap marker, or when too little room for a record is left.
+uint64 RingLogNextOffset(const RingLogRecord& record, uint64 offset,
+                         uint64 data_size);
+
+// Finds the records of the ring whose header is "header": the oldest one
+// and where the next one goes, with their sequence numbers.  The header
+// is trusted only if its checksum and its first record check out;
+// otherwise, after a crash while it was being updated, the ring is
+// scanned.  Records written after the header was last updated count.
+void FindRingLogRecords(const RingLogHeader& header, const char* ring,
+                        uint64* first_offset, uint64* first_sequence,
+                        uint64* next_offset, uint64* next_sequence);
+
 // Wrapper of __sync_val_compare_and_swap. If the GCC extension isn't
 // defined, we try the CPU specific logics (we only support x86 and
 // x86_64 for now) first, then use a naive implementation, which has a
@@ -101,6 +101,26 @@ using glog_internal_namespace_::SafeFNMatch_;
 
 int32 kLogSiteUninitialized = 1000;
 
+// Loads and stores of the state shared with threads that do not hold
+// vmodule_lock.
+template <typename T>
+static inline T AtomicLoad(const T* ptr) {
+#if defined(__GNUC__)
+  return __atomic_load_n(ptr, __ATOMIC_SEQ_CST);
+#else
+  return *static_cast<const volatile T*>(ptr);
+#endif
+}
+
+template <typename T>
+static inline void AtomicStore(T* ptr, T value) {
+#if defined(__GNUC__)
+  __atomic_store_n(ptr, value, __ATOMIC_SEQ_CST);
+#else
+  *static_cast<volatile T*>(ptr) = value;
+#endif
+}
+
 // List of per-module log levels from FLAGS_vmodule.
 // Once created each element is never deleted/modified
 // except for the vlog_level: other threads will read VModuleInfo blobs
@@ -108,6 +128,8 @@ int32 kLogSiteUninitialized = 1000;
 // that will never go away.
 // We can't use an STL struct here as we wouldn't know
 // when it's safe to delete/update it: other threads need to use it w/o locks.
+// SetVModule replaces the list as a whole; the old elements stay allocated
+// for the same reasons.
 struct VModuleInfo {
   string module_pattern;
   mutable int32 vlog_level;  // Conceptually this is an AtomicWord, but it's
@@ -116,24 +138,28 @@ struct VModuleInfo {
   const VModuleInfo* next;
 };
 
-// This protects the following global variables.
+// This protects the following global variables against concurrent
+// updates.  VLOG_IS_ON sites read vmodule_list, vlog_sites and
+// vmodule_generation without it.
 static Mutex vmodule_lock;
 // Pointer to head of the VModuleInfo list.
 // It's a map from module pattern to logging level for those module(s).
-static VModuleInfo* vmodule_list = 0;
+static const VModuleInfo* vmodule_list = 0;
 // Boolean initialization flag.
 static bool inited_vmodule = false;
+// Incremented after each change to the list or to a level in it.
+static int32 vmodule_generation = 0;
+// The registry: all sites that have called InitVLOGSite__, linked through
+// VLogSite::next.  Sites are pushed with a compare-and-swap and never
+// removed.
+static VLogSite* vlog_sites = 0;
 
-// L >= vmodule_lock.
-static void VLOG2Initializer() {
-  vmodule_lock.AssertHeld();
-  // Can now parse --vmodule flag and initialize mapping of module-specific
-  // logging levels.
-  inited_vmodule = false;
-  const char* vmodule = FLAGS_vmodule.c_str();
+// Parses a --vmodule value into a new list; sets *tail to its last element,
+// or NULL if the list is empty.
+static VModuleInfo* ParseVModule(const char* vmodule, VModuleInfo** tail) {
   const char* sep;
   VModuleInfo* head = NULL;
-  VModuleInfo* tail = NULL;
+  *tail = NULL;
   while ((sep = strchr(vmodule, '=')) != NULL) {
     string pattern(vmodule, sep - vmodule);
     int module_level;
@@ -141,20 +167,103 @@ static void VLOG2Initializer() {
       VModuleInfo* info = new VModuleInfo;
       info->module_pattern = pattern;
       info->vlog_level = module_level;
-      if (head)  tail->next = info;
+      info->next = NULL;
+      if (head)  (*tail)->next = info;
       else  head = info;
-      tail = info;
+      *tail = info;
     }
     // Skip past this entry
     vmodule = strchr(sep, ',');
     if (vmodule == NULL) break;
     vmodule++;  // Skip past ","
   }
+  return head;
+}
+
+// The part of fname --vmodule patterns are matched against: the base name
+// up to the first '.', without a trailing "-inl".
+static void ModuleName(const char* fname, const char** base,
+                       size_t* base_length) {
+  const char* b = strrchr(fname, '/');
+  b = b ? (b+1) : fname;
+  const char* base_end = strchr(b, '.');
+  size_t length = base_end ? size_t(base_end - b) : strlen(b);
+
+  // Trim out trailing "-inl" if any
+  if (length >= 4 && (memcmp(b+length-4, "-inl", 4) == 0)) {
+    length -= 4;
+  }
+
+  // TODO: Trim out _unittest suffix?  Perhaps it is better to have
+  // the extra control and just leave it there.
+  *base = b;
+  *base_length = length;
+}
+
+// The first element of "modules" that matches fname, or NULL.
+static const VModuleInfo* FindVModuleInfo(const VModuleInfo* modules,
+                                          const char* fname) {
+  const char* base;
+  size_t base_length;
+  ModuleName(fname, &base, &base_length);
+  for (const VModuleInfo* info = modules; info != NULL; info = info->next) {
+    if (SafeFNMatch_(info->module_pattern.c_str(), info->module_pattern.size(),
+                     base, base_length)) {
+      return info;
+    }
+  }
+  return NULL;
+}
+
+// The VLogSite::level for a site in fname.
+static int32 VLogSiteLevel(const VModuleInfo* modules, const char* fname) {
+  const VModuleInfo* info = FindVModuleInfo(modules, fname);
+  if (info == NULL) {
+    return kVLogSiteUsesFlagV;
+  }
+  int32 level = AtomicLoad(&info->vlog_level);
+  // Keep clear of the special values.
+  if (level >= kVLogSiteUninitialized) level = kVLogSiteUninitialized - 1;
+  if (level == kVLogSiteUsesFlagV) level += 1;
+  return level;
+}
+
+// Makes "modules" the current list, or records that a level in it changed,
+// and re-evaluates every registered site in one pass.
+// L >= vmodule_lock.
+static void PublishVModuleList(const VModuleInfo* modules) {
+  vmodule_lock.AssertHeld();
+  AtomicStore(&vmodule_list, modules);
+  AtomicStore(&vmodule_generation, AtomicLoad(&vmodule_generation) + 1);
+  for (VLogSite* site = AtomicLoad(&vlog_sites);
+       site != NULL; site = site->next) {
+    AtomicStore(&site->level, VLogSiteLevel(modules, site->file));
+  }
+}
+
+// L >= vmodule_lock.
+static void VLOG2Initializer() {
+  vmodule_lock.AssertHeld();
+  // Can now parse --vmodule flag and initialize mapping of module-specific
+  // logging levels.
+  VModuleInfo* tail;
+  VModuleInfo* head = ParseVModule(FLAGS_vmodule.c_str(), &tail);
   if (head) {  // Put them into the list at the head:
     tail->next = vmodule_list;
-    vmodule_list = head;
+    PublishVModuleList(head);
   }
-  inited_vmodule = true;
+  AtomicStore(&inited_vmodule, true);
+}
+
+// The current list, parsing --vmodule the first time.
+static const VModuleInfo* VModuleList() {
+  if (!AtomicLoad(&inited_vmodule)) {
+    MutexLock l(&vmodule_lock);
+    if (!inited_vmodule) {
+      VLOG2Initializer();
+    }
+  }
+  return AtomicLoad(&vmodule_list);
 }
 
 // This can be called very early, so we use SpinLock and RAW_VLOG here.
@@ -171,7 +280,7 @@ int SetVLOGLevel(const char* module_pattern, int log_level) {
           result = info->vlog_level;
           found = true;
         }
-        info->vlog_level = log_level;
+        AtomicStore(&info->vlog_level, static_cast<int32>(log_level));
       } else if (!found  &&
                  SafeFNMatch_(info->module_pattern.c_str(),
                               info->module_pattern.size(),
@@ -185,13 +294,60 @@ int SetVLOGLevel(const char* module_pattern, int log_level) {
       info->module_pattern = module_pattern;
       info->vlog_level = log_level;
       info->next = vmodule_list;
-      vmodule_list = info;
+      PublishVModuleList(info);
+    } else {
+      PublishVModuleList(vmodule_list);
     }
   }
   RAW_VLOG(1, "Set VLOG level for \"%s\" to %d", module_pattern, log_level);
   return result;
 }
 
+void SetVModule(const char* vmodule) {
+  {
+    MutexLock l(&vmodule_lock);
+    VModuleInfo* tail;
+    FLAGS_vmodule = vmodule;
+    AtomicStore(&inited_vmodule, true);
+    PublishVModuleList(ParseVModule(vmodule, &tail));
+  }
+  RAW_VLOG(1, "Set --vmodule to \"%s\"", vmodule);
+}
+
+// NOTE: This function must not allocate memory or require any locks
+// once --vmodule has been parsed.
+bool InitVLOGSite__(VLogSite* site, int32 verbose_level) {
+  // protect the errno global in case someone writes:
+  // VLOG(..) << "The last error was " << strerror(errno)
+  int old_errno = errno;
+
+  // Register the site so that later changes reach it, unless another
+  // thread that hit it at the same time already did.
+  if (sync_val_compare_and_swap(&site->registered, 0, 1) == 0) {
+    VLogSite* head;
+    do {
+      head = AtomicLoad(&vlog_sites);
+      site->next = head;
+    } while (sync_val_compare_and_swap(&vlog_sites, head, site) != head);
+  }
+
+  // Resolve the level.  If the list changed meanwhile, the store may have
+  // overwritten the newer level PublishVModuleList gave the site; try
+  // again until the level is known to be current.
+  int32 level;
+  for (;;) {
+    const int32 generation = AtomicLoad(&vmodule_generation);
+    level = VLogSiteLevel(VModuleList(), site->file);
+    AtomicStore(&site->level, level);
+    if (AtomicLoad(&vmodule_generation) == generation) break;
+  }
+
+  // restore the errno in case something recoverable went wrong during
+  // the initialization of the VLOG mechanism (see above note "protect the..")
+  errno = old_errno;
+  return (level == kVLogSiteUsesFlagV ? FLAGS_v : level) >= verbose_level;
+}
+
 // NOTE: Individual VLOG statements cache the integer log level pointers.
 // NOTE: This function must not allocate memory or require any locks.
 bool InitVLOG3__(int32** site_flag, int32* site_default,
@@ -209,31 +365,13 @@ bool InitVLOG3__(int32** site_flag, int32* site_default,
   // site_default normally points to FLAGS_v
   int32* site_flag_value = site_default;
 
-  // Get basename for file
-  const char* base = strrchr(fname, '/');
-  base = base ? (base+1) : fname;
-  const char* base_end = strchr(base, '.');
-  size_t base_length = base_end ? size_t(base_end - base) : strlen(base);
-
-  // Trim out trailing "-inl" if any
-  if (base_length >= 4 && (memcmp(base+base_length-4, "-inl", 4) == 0)) {
-    base_length -= 4;
-  }
-
-  // TODO: Trim out _unittest suffix?  Perhaps it is better to have
-  // the extra control and just leave it there.
-
   // find target in vector of modules, replace site_flag_value with
   // a module-specific verbose level, if any.
-  for (const VModuleInfo* info = vmodule_list;
-       info != NULL; info = info->next) {
-    if (SafeFNMatch_(info->module_pattern.c_str(), info->module_pattern.size(),
-                     base, base_length)) {
-      site_flag_value = &info->vlog_level;
-        // value at info->vlog_level is now what controls
-        // the VLOG at the caller site forever
-      break;
-    }
+  const VModuleInfo* info = FindVModuleInfo(vmodule_list, fname);
+  if (info != NULL) {
+    site_flag_value = &info->vlog_level;
+      // value at info->vlog_level is now what controls
+      // the VLOG at the caller site forever
   }
 
   // Cache the vlog value pointer if --vmodule flag has been parsed.